@@ -21,68 +21,247 @@
 #include "stdafx.h"
 #include "connpool.h"
 #include "../db/commands.h"
+#include "../util/background.h"
 
 namespace mongo {
 
     DBConnectionPool pool;
+
+    DBConnectionPool::Stripe& DBConnectionPool::stripe( const string& host ) {
+        unsigned h = 0;
+        for ( const char *p = host.c_str(); *p; p++ )
+            h = h * 31 + *p;
+        return _stripes[ h % Stripes ];
+    }
+
+    DBConnectionPool::ThreadCache::~ThreadCache() {
+        for ( map<string,PoolForHost::StoredConnection>::iterator i = conns.begin(); i != conns.end(); i++ )
+            pool->releaseShared( i->first, i->second );
+    }
+
+    DBClientBase* DBConnectionPool::create(const string& host) {
+        string errmsg;
+        DBClientBase *c;
+        if( host.find(',') == string::npos ) {
+            DBClientConnection *cc = new DBClientConnection(true);
+            log(2) << "creating new connection for pool to:" << host << endl;
+            if ( !cc->connect(host.c_str(), errmsg) ) {
+                delete cc;
+                uassert( 11002 ,  (string)"dbconnectionpool: connect failed " + host , false);
+                return 0;
+            }
+            c = cc;
+            onCreate( c );
+        }
+        else { 
+            DBClientPaired *p = new DBClientPaired();
+            if( !p->connect(host) ) { 
+                delete p;
+                uassert( 11003 ,  (string)"dbconnectionpool: connect failed [2] " + host , false);
+                return 0;
+            }
+            c = p;
+        }
+        _created++;
+        return c;
+    }
     
     DBClientBase* DBConnectionPool::get(const string& host) {
-        boostlock L(poolMutex);
-        
-        PoolForHost *&p = pools[host];
-        if ( p == 0 )
-            p = new PoolForHost();
-        if ( p->pool.empty() ) {
-            string errmsg;
-            DBClientBase *c;
-            if( host.find(',') == string::npos ) {
-                DBClientConnection *cc = new DBClientConnection(true);
-                log(2) << "creating new connection for pool to:" << host << endl;
-                if ( !cc->connect(host.c_str(), errmsg) ) {
-                    delete cc;
-                    uassert( 11002 ,  (string)"dbconnectionpool: connect failed " + host , false);
-                    return 0;
+        if ( !_maintaining )
+            startMaintaining();
+
+        ThreadCache *tc = _threadCache.get();
+        if ( tc ) {
+            map<string,PoolForHost::StoredConnection>::iterator i = tc->conns.find(host);
+            if ( i != tc->conns.end() ) {
+                PoolForHost::StoredConnection sc = i->second;
+                tc->conns.erase(i);
+                // maintain() doesn't look in threads' caches
+                if ( sc.conn->isFailed() ) {
+                    delete sc.conn;
+                    _closedBad++;
+                }
+                else if ( time(0) - sc.when > _maxIdleSecs ) {
+                    delete sc.conn;
+                    _closedIdle++;
+                }
+                else {
+                    _threadCacheHits++;
+                    onHandedOut( sc.conn );
+                    return sc.conn;
                 }
-                c = cc;
-                onCreate( c );
             }
-            else { 
-                DBClientPaired *p = new DBClientPaired();
-                if( !p->connect(host) ) { 
-                    delete p;
-                    uassert( 11003 ,  (string)"dbconnectionpool: connect failed [2] " + host , false);
-                    return 0;
+        }
+
+        DBClientBase *c = 0;
+        vector<DBClientBase*> bad;
+        {
+            Stripe& s = stripe(host);
+            boostlock L(s.m);
+            PoolForHost *&p = s.pools[host];
+            if ( p == 0 )
+                p = new PoolForHost();
+            while ( c == 0 && !p->pool.empty() ) {
+                c = p->pool.back().conn;
+                p->pool.pop_back();
+                if ( c->isFailed() ) {
+                    bad.push_back( c );
+                    c = 0;
                 }
-                c = p;
             }
-            return c;
         }
-        DBClientBase *c = p->pool.top();
-        p->pool.pop();
+        for ( unsigned i = 0; i < bad.size(); i++ ) {
+            delete bad[i];
+            _closedBad++;
+        }
+
+        if ( c == 0 ) {
+            // connecting can be slow, so it's done without a lock
+            _misses++;
+            return create( host );
+        }
+        _hits++;
         onHandedOut( c );
         return c;
     }
 
+    void DBConnectionPool::release(const string& host, DBClientBase *c) {
+        if ( c->isFailed() ) {
+            delete c;
+            _closedBad++;
+            return;
+        }
+        ThreadCache *tc = _threadCache.get();
+        if ( tc == 0 ) {
+            tc = new ThreadCache( this );
+            _threadCache.reset( tc );
+        }
+        map<string,PoolForHost::StoredConnection>::iterator i = tc->conns.find(host);
+        if ( i == tc->conns.end() ) {
+            tc->conns.insert( make_pair( host , PoolForHost::StoredConnection( c ) ) );
+            return;
+        }
+        releaseShared( host, PoolForHost::StoredConnection( c ) );
+    }
+
+    void DBConnectionPool::releaseShared( const string& host, const PoolForHost::StoredConnection& sc ) {
+        Stripe& s = stripe(host);
+        boostlock L(s.m);
+        PoolForHost *&p = s.pools[host];
+        if ( p == 0 )
+            p = new PoolForHost();
+        p->pool.push_back( sc );
+    }
+
     void DBConnectionPool::flush(){
-        boostlock L(poolMutex);
-        for ( map<string,PoolForHost*>::iterator i = pools.begin(); i != pools.end(); i++ ){
-            PoolForHost* p = i->second;
-
-            vector<DBClientBase*> all;
-            while ( ! p->pool.empty() ){
-                DBClientBase * c = p->pool.top();
-                p->pool.pop();
-                all.push_back( c );
-                bool res;
-                c->isMaster( res );
+        for ( int j = 0; j < Stripes; j++ ) {
+            boostlock L(_stripes[j].m);
+            map<string,PoolForHost*>& pools = _stripes[j].pools;
+            for ( map<string,PoolForHost*>::iterator i = pools.begin(); i != pools.end(); i++ ){
+                PoolForHost* p = i->second;
+                for ( unsigned k = 0; k < p->pool.size(); k++ ) {
+                    bool res;
+                    p->pool[k].conn->isMaster( res );
+                }
             }
-            
-            for ( vector<DBClientBase*>::iterator i=all.begin(); i != all.end(); i++ ){
-                p->pool.push( *i );
+        }
+    }
+
+    class PoolMaintainer : public BackgroundJob {
+    public:
+        PoolMaintainer( DBConnectionPool *p ) : _pool(p) { deleteSelf = true; }
+        void run() {
+            while ( 1 ) {
+                sleepsecs( DBConnectionPool::ValidateIdleSecs );
+                try {
+                    _pool->maintain();
+                }
+                catch ( std::exception& e ) {
+                    log() << "connection pool maintenance: " << e.what() << endl;
+                }
+            }
+        }
+    private:
+        DBConnectionPool *_pool;
+    };
+
+    void DBConnectionPool::startMaintaining() {
+        boostlock L(_maintainMutex);
+        if ( _maintaining )
+            return;
+        _maintaining = true;
+        (new PoolMaintainer( this ))->go();
+    }
+
+    void DBConnectionPool::maintain() {
+        for ( int j = 0; j < Stripes; j++ ) {
+            vector<DBClientBase*> idle;
+            vector< pair<string,PoolForHost::StoredConnection> > check;
+            {
+                boostlock L(_stripes[j].m);
+                time_t now = time(0);
+                map<string,PoolForHost*>& pools = _stripes[j].pools;
+                for ( map<string,PoolForHost*>::iterator i = pools.begin(); i != pools.end(); i++ ){
+                    std::deque<PoolForHost::StoredConnection> keep;
+                    std::deque<PoolForHost::StoredConnection>& q = i->second->pool;
+                    for ( unsigned k = 0; k < q.size(); k++ ) {
+                        if ( now - q[k].when > _maxIdleSecs )
+                            idle.push_back( q[k].conn );
+                        else if ( now - q[k].when >= ValidateIdleSecs )
+                            check.push_back( make_pair( i->first, q[k] ) );
+                        else
+                            keep.push_back( q[k] );
+                    }
+                    q.swap( keep );
+                }
+            }
+
+            // the network round trips happen with the connections out of the pool and no lock held
+            for ( unsigned k = 0; k < idle.size(); k++ ) {
+                delete idle[k];
+                _closedIdle++;
+            }
+            for ( unsigned k = 0; k < check.size(); k++ ) {
+                DBClientBase *c = check[k].second.conn;
+                bool ok = false;
+                try {
+                    bool res;
+                    c->isMaster( res );
+                    ok = !c->isFailed();
+                }
+                catch ( DBException& ) {
+                }
+                if ( !ok ) {
+                    log(1) << "connection pool: closing dead connection to " << check[k].first << endl;
+                    delete c;
+                    _closedBad++;
+                    continue;
+                }
+                // it keeps its idle time: still the longest idle, so to the front
+                boostlock L(_stripes[j].m);
+                _stripes[j].pools[check[k].first]->pool.push_front( check[k].second );
             }
         }
     }
 
+    void DBConnectionPool::appendStats( BSONObjBuilder& b ) {
+        b.append( "threadCacheHits" , (long long) _threadCacheHits );
+        b.append( "hits" , (long long) _hits );
+        b.append( "misses" , (long long) _misses );
+        b.append( "created" , (long long) _created );
+        b.append( "closedIdle" , (long long) _closedIdle );
+        b.append( "closedBad" , (long long) _closedBad );
+
+        BSONObjBuilder hosts;
+        for ( int j = 0; j < Stripes; j++ ) {
+            boostlock L(_stripes[j].m);
+            map<string,PoolForHost*>& pools = _stripes[j].pools;
+            for ( map<string,PoolForHost*>::iterator i = pools.begin(); i != pools.end(); i++ )
+                hosts.append( i->first.c_str() , (int) i->second->pool.size() );
+        }
+        b.append( "idleShared" , hosts.obj() );
+    }
+
     void DBConnectionPool::addHook( DBConnectionHook * hook ){
         _hooks.push_back( hook );
     }
@@ -119,4 +298,21 @@ namespace mongo {
 
     } poolFlushCmd;
 
+    class PoolStats : public Command {
+    public:
+        PoolStats() : Command( "connPoolStats" ){}
+        virtual void help( stringstream &help ) const {
+            help << "stats for connections this process has open to other servers";
+        }
+        virtual bool run(const char*, mongo::BSONObj&, std::string&, mongo::BSONObjBuilder& result, bool){
+            pool.appendStats( result );
+            result << "ok" << 1;
+            return true;
+        }
+        virtual bool slaveOk(){
+            return true;
+        }
+
+    } poolStatsCmd;
+
 } // namespace mongo
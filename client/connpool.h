@@ -17,13 +17,21 @@
 
 #pragma once
 
-#include <stack>
+#include <deque>
 #include "dbclient.h"
+#include "../util/atomic_int.h"
 
 namespace mongo {
 
+    /* the idle connections to one host.  released to and taken from the back, so the front has
+       been idle longest. */
     struct PoolForHost {
-        std::stack<DBClientBase*> pool;
+        struct StoredConnection {
+            StoredConnection(DBClientBase *c) : conn(c), when(time(0)) { }
+            DBClientBase *conn;
+            time_t when; // when it was released
+        };
+        std::deque<StoredConnection> pool;
     };
     
     class DBConnectionHook {
@@ -43,6 +51,12 @@ namespace mongo {
         Support for authenticated connections requires some adjustements: please 
         request...
 
+        Each thread keeps the last connection it released to each host, so a thread that goes
+        back to the same hosts over and over takes no lock.  Others go to a shared pool per host;
+        hosts are spread over a few separately locked stripes.  A background thread closes shared
+        connections idle longer than maxIdleSeconds and checks that the others still work, so
+        dead ones are found before a request is sent on them.
+
         Usage:
         
         {
@@ -51,22 +65,60 @@ namespace mongo {
         }
     */
     class DBConnectionPool {
-        boost::mutex poolMutex;
-        map<string,PoolForHost*> pools; // servername -> pool
-        list<DBConnectionHook*> _hooks;
-        
-        void onCreate( DBClientBase * conn );
-        void onHandedOut( DBClientBase * conn );
     public:
+        enum { Stripes = 16, ValidateIdleSecs = 30 };
+
+        DBConnectionPool() : _maxIdleSecs(300), _maintaining(false) { }
+
         void flush();
         DBClientBase *get(const string& host);
-        void release(const string& host, DBClientBase *c) {
-            if ( c->isFailed() )
-                return;
-            boostlock L(poolMutex);
-            pools[host]->pool.push(c);
-        }
+        void release(const string& host, DBClientBase *c);
         void addHook( DBConnectionHook * hook );
+
+        /* shared connections idle this long are closed.  default 5 minutes. */
+        void setMaxIdleSeconds( int secs ) { _maxIdleSecs = secs; }
+
+        /* close connections idle past maxIdleSeconds, and check that those idle ValidateIdleSecs
+           or more still work.  the background thread calls this every ValidateIdleSecs. */
+        void maintain();
+
+        /* hits, misses, creates etc., and the idle connections per host */
+        void appendStats( BSONObjBuilder& b );
+
+    private:
+        struct Stripe {
+            boost::mutex m;
+            map<string,PoolForHost*> pools; // servername -> pool
+        };
+        Stripe& stripe( const string& host );
+
+        /* the connections a thread released last, one per host */
+        struct ThreadCache {
+            ThreadCache( DBConnectionPool *p ) : pool(p) { }
+            ~ThreadCache(); // hands them to the shared pool
+            DBConnectionPool *pool;
+            map<string,PoolForHost::StoredConnection> conns;
+        };
+
+        DBClientBase* create( const string& host );
+        void releaseShared( const string& host, const PoolForHost::StoredConnection& sc );
+        void startMaintaining();
+        void onCreate( DBClientBase * conn );
+        void onHandedOut( DBClientBase * conn );
+
+        Stripe _stripes[Stripes];
+        boost::thread_specific_ptr<ThreadCache> _threadCache;
+        list<DBConnectionHook*> _hooks;
+        int _maxIdleSecs;
+        boost::mutex _maintainMutex;
+        volatile bool _maintaining;
+
+        AtomicUInt _threadCacheHits; // handed out from the thread's own cache
+        AtomicUInt _hits;            // from the shared pool
+        AtomicUInt _misses;          // nothing idle, so a connect was tried
+        AtomicUInt _created;
+        AtomicUInt _closedIdle;      // idle past maxIdleSeconds
+        AtomicUInt _closedBad;       // failed, or failed validation
     };
 
     extern DBConnectionPool pool;
@@ -462,6 +462,27 @@ namespace mongo {
             failed = true;
             return false;
         }
+        if ( cmdLine.wireCompression )
+            startCompression();
+        return true;
+    }
+
+    bool DBClientConnection::startCompression() {
+        if ( port().compressing() )
+            return true;
+        BSONObj info;
+        bool im;
+        try {
+            if ( !isMaster( im, &info ) || strcmp( info.getStringField( "wireCompression" ), "lz" ) != 0 )
+                return false;
+            port().startCompressing();
+            // compressed whatever its size, so the server's port starts compressing its replies
+            isMaster( im );
+        }
+        catch ( DBException& e ) {
+            log() << "couldn't start wire compression to " << serverAddress << ": " << e.what() << endl;
+            return false;
+        }
         return true;
     }
 
@@ -836,6 +857,112 @@ namespace mongo {
         );
     }
 
+    /* --- class DBClientAsyncConnection --- */
+
+    bool DBClientAsyncConnection::Response::wait() {
+        return _conn->wait(*this);
+    }
+
+    int DBClientAsyncConnection::Response::nReturned() {
+        QueryResult *qr = (QueryResult *) reply().data;
+        return qr->nReturned;
+    }
+
+    BSONObj DBClientAsyncConnection::Response::firstObj() {
+        if ( nReturned() == 0 )
+            return BSONObj();
+        QueryResult *qr = (QueryResult *) reply().data;
+        return BSONObj( qr->data() );
+    }
+
+    shared_ptr<DBClientAsyncConnection::Response> DBClientAsyncConnection::call(Message& toSend) {
+        shared_ptr<Response> r( new Response(this) );
+        toSend.data->id = nextMessageId();
+        toSend.data->responseTo = -1;
+        {
+            boostlock lk(_lock);
+            if ( _failed ) {
+                r->_done = true;
+                return r;
+            }
+            // in the map before it is sent, so whoever reads the reply can find it
+            _pending[toSend.data->id] = r;
+        }
+        try {
+            boostlock lk(_sendLock);
+            _conn.port().send(toSend);
+        }
+        catch ( SocketException& ) {
+            boostlock lk(_lock);
+            fail();
+        }
+        return r;
+    }
+
+    shared_ptr<DBClientAsyncConnection::Response> DBClientAsyncConnection::query(const string &ns, Query query, int nToReturn, int nToSkip,
+                                                                                 const BSONObj *fieldsToReturn, int queryOptions) {
+        Message toSend;
+        assembleRequest( ns, query.obj, nToReturn, nToSkip, fieldsToReturn, queryOptions, toSend );
+        return call( toSend );
+    }
+
+    void DBClientAsyncConnection::say(Message& toSend) {
+        try {
+            boostlock lk(_sendLock);
+            _conn.port().say(toSend);
+        }
+        catch ( SocketException& ) {
+            boostlock lk(_lock);
+            fail();
+            throw;
+        }
+    }
+
+    bool DBClientAsyncConnection::wait(Response& r) {
+        boostlock lk(_lock);
+        while ( !r._done ) {
+            if ( _reading ) {
+                // someone else is reading; they'll wake us when they hand a reply over
+                _replied.wait(lk);
+                continue;
+            }
+
+            _reading = true;
+            lk.unlock();
+            Message m;
+            bool ok = _conn.port().recv(m);
+            lk.lock();
+            _reading = false;
+
+            if ( !ok ) {
+                fail();
+                break;
+            }
+            map< MSGID, shared_ptr<Response> >::iterator i = _pending.find( m.data->responseTo );
+            if ( i == _pending.end() ) {
+                log() << "DBClientAsyncConnection got a reply to no request, responseTo:" << (unsigned) m.data->responseTo << ' ' << toString() << endl;
+            }
+            else {
+                Response& d = *i->second;
+                d._reply = m;
+                d._ok = true;
+                d._done = true;
+                _pending.erase(i);
+            }
+            _replied.notify_all();
+        }
+        return r._ok;
+    }
+
+    /* _lock held.  every request still outstanding fails. */
+    void DBClientAsyncConnection::fail() {
+        _failed = true;
+        for ( map< MSGID, shared_ptr<Response> >::iterator i = _pending.begin(); i != _pending.end(); i++ )
+            i->second->_done = true;
+        _pending.clear();
+        _replied.notify_all();
+    }
+
     /* --- class dbclientpaired --- */
 
     string DBClientPaired::toString() {
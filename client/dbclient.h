@@ -754,6 +754,12 @@ namespace mongo {
 
         virtual bool auth(const string &dbname, const string &username, const string &pwd, string& errmsg, bool digestPassword = true);
 
+        /** compress large messages both ways, if the server can.  done by connect() when
+            --wireCompression is set.
+            @return true if compressing
+        */
+        bool startCompression();
+
         virtual auto_ptr<DBClientCursor> query(const string &ns, Query query, int nToReturn = 0, int nToSkip = 0,
                                                const BSONObj *fieldsToReturn = 0, int queryOptions = 0) {
             checkConnection();
@@ -795,6 +801,110 @@ namespace mongo {
         virtual void checkResponse( const char *data, int nReturned );
     };
 
+    /** A connection that carries many requests at once on its one socket.  Requests are sent as
+        they are submitted and each gets a Response back right away; replies are matched to their
+        requests by responseTo.
+
+        There is no reader thread.  Whichever caller is waiting reads replies off the socket and
+        hands the ones that aren't its own to their Responses, so a Response only completes while
+        someone wait()s.  May be used from any number of threads.
+
+        The connection must outlive its Responses' wait() calls.
+
+        Example:
+          DBClientAsyncConnection c;
+          c.connect("localhost", errmsg);
+          shared_ptr<DBClientAsyncConnection::Response> a = c.findOne("test.foo", QUERY("x" << 1));
+          shared_ptr<DBClientAsyncConnection::Response> b = c.runCommand("test", BSON("count" << "foo"));
+          if ( a->wait() ) cout << a->firstObj() << endl;
+          if ( b->wait() ) cout << b->firstObj() << endl;
+    */
+    class DBClientAsyncConnection : boost::noncopyable {
+    public:
+        class Response : boost::noncopyable {
+        public:
+            /** blocks until the reply is here.  @return false if the connection failed first */
+            bool wait();
+
+            bool isDone() const { return _done; }
+
+            /** the reply.  only valid after wait() returned true. */
+            Message& reply() {
+                assert( _done && _ok );
+                return _reply;
+            }
+
+            /** # of documents in a query reply */
+            int nReturned();
+
+            /** the first document of a query reply -- the result, for a command.  empty if there
+                are none.  points into reply(), so is only valid while this Response is.
+            */
+            BSONObj firstObj();
+
+        private:
+            Response(DBClientAsyncConnection *c) : _conn(c), _done(false), _ok(false) { }
+            DBClientAsyncConnection *_conn;
+            volatile bool _done;
+            bool _ok;
+            Message _reply;
+            friend class DBClientAsyncConnection;
+        };
+
+        DBClientAsyncConnection() : _failed(false), _reading(false) { }
+
+        /** @see DBClientConnection::connect() */
+        bool connect(const string &serverHostname, string& errmsg) {
+            return _conn.connect(serverHostname, errmsg);
+        }
+
+        /** must be done before the first request */
+        bool auth(const string &dbname, const string &username, const string &pwd, string& errmsg) {
+            assert( _pending.empty() );
+            return _conn.auth(dbname, username, pwd, errmsg);
+        }
+
+        /** send toSend (a dbQuery or dbGetMore) without waiting for the reply */
+        shared_ptr<Response> call(Message& toSend);
+
+        shared_ptr<Response> query(const string &ns, Query query, int nToReturn = 0, int nToSkip = 0,
+                                   const BSONObj *fieldsToReturn = 0, int queryOptions = 0);
+
+        shared_ptr<Response> findOne(const string &ns, Query query, const BSONObj *fieldsToReturn = 0, int queryOptions = 0) {
+            return this->query(ns, query, -1, 0, fieldsToReturn, queryOptions);
+        }
+
+        shared_ptr<Response> runCommand(const string &dbname, const BSONObj& cmd, int options = 0) {
+            return findOne(dbname + ".$cmd", cmd, 0, options);
+        }
+
+        /** send a message that has no reply (insert, update, remove) */
+        void say(Message& toSend);
+
+        /** # of requests sent whose replies haven't been read */
+        int inFlight() {
+            boostlock lk(_lock);
+            return _pending.size();
+        }
+
+        bool isFailed() const { return _failed; }
+
+        string toString() { return _conn.toString(); }
+
+    private:
+        /* reads replies until r's is in */
+        bool wait(Response& r);
+        void fail();
+
+        DBClientConnection _conn;
+        boost::mutex _lock;             // _pending, _reading, _failed, and the Responses' _done
+        boost::condition _replied;
+        boost::mutex _sendLock;
+        map< MSGID, shared_ptr<Response> > _pending;
+        bool _failed;
+        bool _reading;                  // a waiter is reading from the socket
+    };
+
     /** Use this class to connect to a replica pair of servers.  The class will manage
        checking for which server in a replica pair is master, and do failover automatically.
 
@@ -210,5 +210,32 @@ int main( int argc, const char **argv ) {
         }
     }
 
+    { // many requests in flight on one async connection
+        const char * ans = "test.async1";
+        conn.dropCollection( ans );
+        for ( int i = 0; i < 50; i++ )
+            conn.insert( ans , BSON( "_id" << i << "x" << i * 2 ) );
+        conn.getLastError();
+
+        DBClientAsyncConnection ac;
+        assert( ac.connect( string( "127.0.0.1:" ) + port , errmsg ) );
+
+        vector< shared_ptr<DBClientAsyncConnection::Response> > v;
+        for ( int i = 0; i < 50; i++ )
+            v.push_back( ac.findOne( ans , QUERY( "_id" << i ) ) );
+        shared_ptr<DBClientAsyncConnection::Response> count = ac.runCommand( "test" , BSON( "count" << "async1" ) );
+        assert( ac.inFlight() > 0 );
+
+        // wait in reverse order: earlier replies are handed over while reading for later ones
+        assert( count->wait() );
+        assert( count->firstObj()["n"].number() == 50 );
+        for ( int i = 49; i >= 0; i-- ) {
+            assert( v[i]->wait() );
+            assert( v[i]->firstObj()["x"].number() == i * 2 );
+        }
+        assert( ac.inFlight() == 0 );
+        assert( ac.findOne( ans , QUERY( "_id" << 1000 ) )->wait() );
+    }
+
     cout << "client test finished!" << endl;
 }
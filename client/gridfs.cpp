@@ -20,6 +20,8 @@
 #include <utility>
 
 #include "gridfs.h"
+#include "../util/background.h"
+#include "../util/md5.hpp"
 #include <boost/smart_ptr.hpp>
 
 #if defined(_WIN32)
@@ -34,6 +36,12 @@ namespace mongo {
 
     const unsigned DEFAULT_CHUNK_SIZE = 256 * 1024;
 
+    /* chunks are sent to the server in insert messages of about this size */
+    const int CHUNK_BATCH_BYTES = 4 * 1024 * 1024;
+
+    /* how many chunks a reader may fetch ahead of the ones written out */
+    const unsigned CHUNK_PREFETCH = 8;
+
     Chunk::Chunk( BSONObj o ){
         _data = o;
     }
@@ -47,6 +55,161 @@ namespace mongo {
     }
 
 
+    /* collects the chunks of a file being stored and sends them a batch at a time.  inserts
+       don't wait for a reply, so batching is what saves us a message per chunk.  the md5 is
+       computed as the data goes by so we don't need a filemd5 pass over the stored chunks.
+    */
+    class GridFSChunkWriter : boost::noncopyable {
+    public:
+        GridFSChunkWriter( DBClientBase& client , const string& ns , const BSONObj& idObj )
+            : _client( client ) , _ns( ns ) , _idObj( idObj ) , _n( 0 ) , _length( 0 ) , _batchBytes( 0 ){
+            md5_init( &_md5 );
+        }
+
+        void append( const char * data , int len ){
+            Chunk c( _idObj , _n++ , data , len );
+            md5_append( &_md5 , (const md5_byte_t*) data , len );
+            _length += len;
+
+            _batch.push_back( c._data );
+            _batchBytes += c._data.objsize();
+            if ( _batchBytes >= CHUNK_BATCH_BYTES )
+                flush();
+        }
+
+        /* sends what is left and checks the server got every chunk.  returns the md5 */
+        string finish(){
+            flush();
+
+            string err = _client.getLastError();
+            uassert( 13011 , (string)"error storing chunks: " + err , err.empty() );
+            BSONObjBuilder q;
+            q.appendAs( _idObj["_id"] , "files_id" );
+            uassert( 13012 , "chunks missing after store" , _client.count( _ns , q.obj() ) == (unsigned long long) _n );
+
+            md5digest d;
+            md5_finish( &_md5 , d );
+            return digestToString( d );
+        }
+
+        gridfs_offset length() const { return _length; }
+
+    private:
+        void flush(){
+            if ( _batch.empty() )
+                return;
+            _client.insert( _ns , _batch );
+            _batch.clear();
+            _batchBytes = 0;
+        }
+
+        DBClientBase& _client;
+        string _ns;
+        BSONObj _idObj;
+        int _n;
+        gridfs_offset _length;
+        md5_state_t _md5;
+        vector<BSONObj> _batch;
+        int _batchBytes;
+    };
+
+    /* reads chunks [first, last] of a file, in order, through one sorted cursor.  over a real
+       connection the cursor is drained by a background thread so the next chunks are already on
+       their way while the caller writes out the current one.  the caller must not use the
+       connection until the fetcher is destroyed.
+    */
+    class ChunkFetcher : public BackgroundJob {
+    public:
+        ChunkFetcher( DBClientBase& client , const string& ns , BSONElement id , int first , int last )
+            : _client( client ) , _ns( ns ) , _done( false ) , _stop( false ){
+            BSONObjBuilder b;
+            b.appendAs( id , "files_id" );
+            b.append( "n" , BSON( "$gte" << first << "$lte" << last ) );
+            _query = Query( b.obj() ).sort( BSON( "files_id" << 1 << "n" << 1 ) );
+
+            _background = dynamic_cast< DBClientConnection* >( &client ) != 0;
+            if ( _background )
+                go();
+            else
+                _cursor = _client.query( _ns , _query );
+        }
+
+        ~ChunkFetcher(){
+            if ( ! _background )
+                return;
+            {
+                boostlock lk( _m );
+                _stop = true;
+                _cond.notify_all();
+            }
+            wait();
+        }
+
+        /* @return the next chunk, or an empty object at the end.
+           the object is only good until the next call.
+        */
+        BSONObj next(){
+            if ( ! _background ){
+                uassert( 13009 , "error reading chunks: query failed" , _cursor.get() );
+                return _cursor->more() ? _cursor->nextSafe() : BSONObj();
+            }
+
+            boostlock lk( _m );
+            while ( _queue.empty() && ! _done )
+                _cond.wait( lk );
+            if ( _queue.empty() ){
+                uassert( 13021 , (string)"error reading chunks: " + _err , _err.empty() );
+                return BSONObj();
+            }
+            BSONObj o = _queue.front();
+            _queue.pop_front();
+            _cond.notify_all();
+            return o;
+        }
+
+    protected:
+        void run(){
+            string err;
+            try {
+                auto_ptr<DBClientCursor> c = _client.query( _ns , _query );
+                uassert( 13022 , "query failed" , c.get() );
+                while ( c->more() ){
+                    // the cursor's buffer goes away with its next batch
+                    BSONObj o = c->nextSafe().getOwned();
+                    boostlock lk( _m );
+                    while ( _queue.size() >= CHUNK_PREFETCH && ! _stop )
+                        _cond.wait( lk );
+                    if ( _stop )
+                        break;
+                    _queue.push_back( o );
+                    _cond.notify_all();
+                }
+            }
+            catch ( std::exception& e ){
+                err = e.what();
+            }
+
+            boostlock lk( _m );
+            _err = err;
+            _done = true;
+            _cond.notify_all();
+        }
+
+    private:
+        DBClientBase& _client;
+        string _ns;
+        Query _query;
+        bool _background;
+        auto_ptr<DBClientCursor> _cursor;  // when not in the background
+
+        boost::mutex _m;
+        boost::condition _cond;
+        deque<BSONObj> _queue;
+        bool _done;
+        bool _stop;
+        string _err;
+    };
+
     GridFS::GridFS( DBClientBase& client , const string& dbName , const string& prefix ) : _client( client ) , _dbName( dbName ) , _prefix( prefix ){
         _filesNS = dbName + "." + prefix + ".files";
         _chunksNS = dbName + "." + prefix + ".chunks";
@@ -68,17 +231,15 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
-        int chunkNumber = 0;
+        GridFSChunkWriter chunks( _client , _chunksNS , idObj );
         while (data < end){
             int chunkLen = MIN(DEFAULT_CHUNK_SIZE, (unsigned)(end-data));
-            Chunk c(idObj, chunkNumber, data, chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
-
-            chunkNumber++;
+            chunks.append( data , chunkLen );
             data += chunkLen;
         }
+        string md5 = chunks.finish();
 
-        return insertFile(remoteName, id, length, contentType);
+        return insertFile(remoteName, id, length, md5, contentType);
     }
 
 
@@ -96,10 +257,9 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
-        int chunkNumber = 0;
-        gridfs_offset length = 0;
+        GridFSChunkWriter chunks( _client , _chunksNS , idObj );
+        boost::scoped_array<char>buf (new char[DEFAULT_CHUNK_SIZE]);
         while (!feof(fd)){
-            boost::scoped_array<char>buf (new char[DEFAULT_CHUNK_SIZE]);
             char* bufPos = buf.get();
             unsigned int chunkLen = 0; // how much in the chunk now
             while(chunkLen != DEFAULT_CHUNK_SIZE && !feof(fd)){
@@ -110,26 +270,20 @@ namespace mongo {
                 assert(chunkLen <= DEFAULT_CHUNK_SIZE);
             }
 
-            Chunk c(idObj, chunkNumber, buf.get(), chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
-
-            length += chunkLen;
-            chunkNumber++;
+            chunks.append( buf.get() , chunkLen );
         }
 
         if (fd != stdin)
             fclose( fd );
         
+        gridfs_offset length = chunks.length();
         massert( 10280 , "large files not yet implemented", length <= 0xffffffff);
+        string md5 = chunks.finish();
 
-        return insertFile((remoteName.empty() ? fileName : remoteName), id, length, contentType);
+        return insertFile((remoteName.empty() ? fileName : remoteName), id, length, md5, contentType);
     }
 
-    BSONObj GridFS::insertFile(const string& name, const OID& id, unsigned length, const string& contentType){
-
-        BSONObj res;
-        if ( ! _client.runCommand( _dbName.c_str() , BSON( "filemd5" << id << "root" << _prefix ) , res ) )
-            throw UserException( 9008 , "filemd5 failed" );
+    BSONObj GridFS::insertFile(const string& name, const OID& id, unsigned length, const string& md5, const string& contentType){
 
         BSONObjBuilder file;
         file << "_id" << id
@@ -137,7 +291,7 @@ namespace mongo {
              << "length" << (unsigned) length
              << "chunkSize" << DEFAULT_CHUNK_SIZE
              << "uploadDate" << DATENOW
-             << "md5" << res["md5"]
+             << "md5" << md5
              ;
 
         if (!contentType.empty())
@@ -203,18 +357,39 @@ namespace mongo {
 
     gridfs_offset GridFile::write( ostream & out ){
         _exists();
+        return write( out , 0 , getContentLength() );
+    }
+
+    gridfs_offset GridFile::write( ostream & out , gridfs_offset offset , gridfs_offset length ){
+        _exists();
+
+        const gridfs_offset total = getContentLength();
+        if ( offset >= total || length == 0 )
+            return 0;
+        if ( length > total - offset )
+            length = total - offset;
+        const gridfs_offset end = offset + length;
 
-        const int num = getNumChunks();
+        const int chunkSize = getChunkSize();
+        const int first = (int)( offset / chunkSize );
+        const int last = (int)( ( end - 1 ) / chunkSize );
 
-        for ( int i=0; i<num; i++ ){
-            Chunk c = getChunk( i );
+        ChunkFetcher chunks( _grid->_client , _grid->_chunksNS , _obj["_id"] , first , last );
+        for ( int n = first; n <= last; n++ ){
+            BSONObj o = chunks.next();
+            uassert( 13020 ,  "chunk is empty!" , ! o.isEmpty() && o["n"].numberInt() == n );
+            Chunk c( o );
 
             int len;
             const char * data = c.data( len );
-            out.write( data , len );
+            const gridfs_offset pos = (gridfs_offset) n * chunkSize;
+            gridfs_offset from = offset > pos ? offset - pos : 0;
+            gridfs_offset to = MIN( end - pos , (gridfs_offset) len );
+            if ( to > from )
+                out.write( data + from , to - from );
         }
 
-        return getContentLength();
+        return length;
     }
 
     gridfs_offset GridFile::write( const string& where ){
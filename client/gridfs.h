@@ -25,6 +25,7 @@ namespace mongo {
 
     class GridFS;
     class GridFile;
+    class GridFSChunkWriter;
 
     class Chunk {
     public:
@@ -51,6 +52,7 @@ namespace mongo {
     private:
         BSONObj _data;
         friend class GridFS;
+        friend class GridFSChunkWriter;
     };
 
 
@@ -124,7 +126,7 @@ namespace mongo {
         string _chunksNS;
 
         // insert fileobject. All chunks must be in DB.
-        BSONObj insertFile(const string& name, const OID& id, unsigned length, const string& contentType);
+        BSONObj insertFile(const string& name, const OID& id, unsigned length, const string& md5, const string& contentType);
 
         friend class GridFile;
     };
@@ -183,6 +185,13 @@ namespace mongo {
          */
         gridfs_offset write( ostream & out );
 
+        /**
+           write length bytes starting at offset to the output stream.
+           only the chunks holding that range are fetched from the server.
+           @return number of bytes written, less than length if the file ends first
+         */
+        gridfs_offset write( ostream & out , gridfs_offset offset , gridfs_offset length );
+
         /**
            write the file to this filename
          */
@@ -73,13 +73,13 @@ namespace mongo {
     int bt_fv=0;
     int bt_dmp=0;
 
-    void BucketBasics::dumpTree(DiskLoc thisLoc, const BSONObj &order) {
+    void BucketBasics::dumpTree(DiskLoc thisLoc, const Ordering &order) {
         bt_dmp=1;
         fullValidate(thisLoc, order);
         bt_dmp=0;
     }
 
-    int BucketBasics::fullValidate(const DiskLoc& thisLoc, const BSONObj &order) {
+    int BucketBasics::fullValidate(const DiskLoc& thisLoc, const Ordering &order) {
         {
             bool f = false;
             assert( f = true );
@@ -115,13 +115,15 @@ namespace mongo {
             wassert( b->parent == thisLoc );
             kc += b->fullValidate(nextChild, order);
         }
+        if ( isCounted() )
+            wassert( kc == _subtreeKeys );
 
         return kc;
     }
 
     int nDumped = 0;
 
-    void BucketBasics::assertValid(const BSONObj &order, bool force) {
+    void BucketBasics::assertValid(const Ordering &order, bool force) {
         if ( !debug && !force )
             return;
         wassert( n >= 0 && n < Size() );
@@ -189,7 +191,7 @@ namespace mongo {
         n = 0;
         emptySize = totalDataSize();
         topSize = 0;
-        reserved = 0;
+        _subtreeKeys = 0;
     }
 
     /* see _alloc */
@@ -242,7 +244,7 @@ namespace mongo {
     }
 
     /* add a key.  must be > all existing.  be careful to set next ptr right. */
-    bool BucketBasics::_pushBack(const DiskLoc& recordLoc, BSONObj& key, const BSONObj &order, DiskLoc prevChild) {
+    bool BucketBasics::_pushBack(const DiskLoc& recordLoc, BSONObj& key, const Ordering &order, DiskLoc prevChild) {
         int bytesNeeded = key.objsize() + sizeof(_KeyNode);
         if ( bytesNeeded > emptySize )
             return false;
@@ -257,13 +259,13 @@ namespace mongo {
         memcpy(p, key.objdata(), key.objsize());
         return true;
     }
-    /*void BucketBasics::pushBack(const DiskLoc& recordLoc, BSONObj& key, const BSONObj &order, DiskLoc prevChild, DiskLoc nextChild) { 
+    /*void BucketBasics::pushBack(const DiskLoc& recordLoc, BSONObj& key, const Ordering &order, DiskLoc prevChild, DiskLoc nextChild) { 
         pushBack(recordLoc, key, order, prevChild);
         childForPos(n) = nextChild;
     }*/
 
     /* insert a key in a bucket with no complexity -- no splits required */
-    bool BucketBasics::basicInsert(const DiskLoc& thisLoc, int keypos, const DiskLoc& recordLoc, const BSONObj& key, const BSONObj &order) {
+    bool BucketBasics::basicInsert(const DiskLoc& thisLoc, int keypos, const DiskLoc& recordLoc, const BSONObj& key, const Ordering &order) {
         modified(thisLoc);
         assert( keypos >= 0 && keypos <= n );
         int bytesNeeded = key.objsize() + sizeof(_KeyNode);
@@ -288,7 +290,7 @@ namespace mongo {
     /* when we delete things we just leave empty space until the node is
        full and then we repack it.
     */
-    void BucketBasics::pack( const BSONObj &order ) {
+    void BucketBasics::pack( const Ordering &order ) {
         if ( flags & Packed )
             return;
 
@@ -313,7 +315,7 @@ namespace mongo {
         assertValid( order );
     }
 
-    inline void BucketBasics::truncateTo(int N, const BSONObj &order) {
+    inline void BucketBasics::truncateTo(int N, const Ordering &order) {
         n = N;
         setNotPacked();
         pack( order );
@@ -339,7 +341,7 @@ namespace mongo {
         }
     }
 
-    bool BtreeBucket::exists(const IndexDetails& idx, DiskLoc thisLoc, const BSONObj& key, BSONObj order) { 
+    bool BtreeBucket::exists(const IndexDetails& idx, DiskLoc thisLoc, const BSONObj& key, const Ordering& order) { 
         int pos;
         bool found;
         DiskLoc b = locate(idx, thisLoc, key, order, pos, found, minDiskLoc);
@@ -362,7 +364,7 @@ namespace mongo {
     */
     bool BtreeBucket::wouldCreateDup(
         const IndexDetails& idx, DiskLoc thisLoc, 
-        const BSONObj& key, BSONObj order,
+        const BSONObj& key, const Ordering& order,
         DiskLoc self) 
     { 
         int pos;
@@ -406,7 +408,7 @@ namespace mongo {
        note result might be an Unused location!
     */
 	char foo;
-    bool BtreeBucket::find(const IndexDetails& idx, const BSONObj& key, DiskLoc recordLoc, const BSONObj &order, int& pos, bool assertIfDup) {
+    bool BtreeBucket::find(const IndexDetails& idx, const BSONObj& key, DiskLoc recordLoc, const Ordering &order, int& pos, bool assertIfDup) {
 #if defined(_EXPERIMENT1)
 		{
 			char *z = (char *) this;
@@ -431,7 +433,11 @@ namespace mongo {
             KeyNode M = keyNode(m);
             int x = key.woCompare(M.key, order);
             if ( x == 0 ) { 
-                if( assertIfDup ) {
+                if( assertIfDup && M.recordLoc == recordLoc ) {
+                    // this very record is already indexed under the key: not a duplicate.  falls
+                    // through to "found" below (see wouldCreateDup()'s self)
+                }
+                else if( assertIfDup ) {
                     if( k(m).isUnused() ) { 
                         // ok that key is there if unused.  but we need to check that there aren't other 
                         // entries for the key then.  as it is very rare that we get here, we don't put any 
@@ -475,7 +481,7 @@ namespace mongo {
     }
 
     void BtreeBucket::delBucket(const DiskLoc& thisLoc, IndexDetails& id) {
-        ClientCursor::informAboutToDeleteBucket(thisLoc);
+        ClientCursor::informAboutToDeleteBucket(id.parentNS(), thisLoc);
         assert( !isHead() );
 
         BtreeBucket *p = parent.btreemod();
@@ -525,6 +531,9 @@ found:
         assert(n>0);
         DiskLoc left = childForPos(p);
 
+        if ( isCounted() && k(p).isUsed() )
+            adjustSubtreeKeys(thisLoc, -1);
+
         if ( n == 1 ) {
             if ( left.isNull() && nextChild.isNull() ) {
                 if ( isHead() )
@@ -554,7 +563,7 @@ found:
 
         int pos;
         bool found;
-        DiskLoc loc = locate(id, thisLoc, key, id.keyPattern(), pos, found, recordLoc, 1);
+        DiskLoc loc = locate(id, thisLoc, key, Ordering::make(id.keyPattern()), pos, found, recordLoc, 1);
         if ( found ) {
             loc.btree()->delKeyAtPos(loc, id, pos);
             return true;
@@ -562,6 +571,39 @@ found:
         return false;
     }
 
+    bool BtreeBucket::repoint(const DiskLoc& thisLoc, IndexDetails& id, const BSONObj& key, const DiskLoc& oldLoc, const DiskLoc& newLoc) {
+        if ( key.objsize() > KeyMax )
+            return false;
+
+        Ordering order = Ordering::make(id.keyPattern());
+        int pos;
+        bool found;
+        DiskLoc loc = locate(id, thisLoc, key, order, pos, found, oldLoc, 1);
+        if ( !found )
+            return false;
+        BtreeBucket *b = loc.btree();
+        if ( b->k(pos).isUnused() )
+            return false;
+
+        for ( int direction = -1; direction <= 1; direction += 2 ) {
+            int p = pos;
+            DiskLoc l = b->advance(loc, p, direction, "BtreeBucket::repoint");
+            if ( l.isNull() )
+                continue;
+            KeyNode kn = l.btree()->keyNode(p);
+            if ( key.woCompare(kn.key, order) != 0 )
+                continue;
+            DiskLoc neighbour = kn.recordLoc;
+            neighbour.GETOFS() &= ~1;
+            int c = newLoc.compare(neighbour);
+            if ( direction < 0 ? c <= 0 : c >= 0 )
+                return false; // newLoc would sort on the other side of an equal key
+        }
+
+        loc.btreemod()->k(pos).recordLoc = newLoc;
+        return true;
+    }
+
     BtreeBucket* BtreeBucket::allocTemp() {
         BtreeBucket *b = (BtreeBucket*) malloc(BucketSize);
         b->init();
@@ -588,7 +630,7 @@ found:
        keypos - where to insert the key i3n range 0..n.  0=make leftmost, n=make rightmost.
     */
     void BtreeBucket::insertHere(DiskLoc thisLoc, int keypos,
-                                 DiskLoc recordLoc, const BSONObj& key, const BSONObj& order,
+                                 DiskLoc recordLoc, const BSONObj& key, const Ordering& order,
                                  DiskLoc lchild, DiskLoc rchild, IndexDetails& idx)
     {
         modified(thisLoc);
@@ -671,6 +713,18 @@ found:
         r = 0;
         rLoc.btree()->fixParentPtrs(rLoc);
 
+        if ( isCounted() ) {
+            /* our count already includes the key being inserted.  work out the counts of both
+               halves now: if promoting the middle key splits our parent, it recounts from ours.
+            */
+            long long rKeys = keysIn(mid+1, n+1);
+            if ( keypos > mid )
+                rKeys += ( ( recordLoc.getOfs() & 1 ) ? 0 : 1 ) + subtreeKeys(rchild);
+            long long total = _subtreeKeys;
+            rLoc.btreemod()->_subtreeKeys = (int) rKeys;
+            _subtreeKeys = (int) ( total - rKeys - ( k(mid).isUsed() ? 1 : 0 ) );
+        }
+
         {
             KeyNode middle = keyNode(mid);
             nextChild = middle.prevChildBucket; // middle key gets promoted, its children will be thisLoc (l) and rLoc (r)
@@ -685,6 +739,8 @@ found:
                 BtreeBucket *p = L.btreemod();
                 p->pushBack(middle.recordLoc, middle.key, order, thisLoc);
                 p->nextChild = rLoc;
+                if ( p->isCounted() )
+                    p->_subtreeKeys = _subtreeKeys + subtreeKeys(rLoc) + ( k(mid).isUsed() ? 1 : 0 );
                 p->assertValid( order );
                 parent = idx.head = L;
                 if ( split_debug )
@@ -726,6 +782,8 @@ found:
         DiskLoc loc = btreeStore->insert(id.indexNamespace().c_str(), 0, BucketSize, true);
         BtreeBucket *b = loc.btreemod();
         b->init();
+        if ( id.info.obj()["counted"].trueValue() )
+            b->flags |= Counted;
         return loc;
     }
 
@@ -789,7 +847,7 @@ found:
         return DiskLoc();
     }
 
-    DiskLoc BtreeBucket::locate(const IndexDetails& idx, const DiskLoc& thisLoc, const BSONObj& key, const BSONObj &order, int& pos, bool& found, DiskLoc recordLoc, int direction) {
+    DiskLoc BtreeBucket::locate(const IndexDetails& idx, const DiskLoc& thisLoc, const BSONObj& key, const Ordering &order, int& pos, bool& found, DiskLoc recordLoc, int direction) {
         int p;
         found = find(idx, key, recordLoc, order, p, /*assertIfDup*/ false);
         if ( found ) {
@@ -815,7 +873,7 @@ found:
     /* @thisLoc disk location of *this
     */
     int BtreeBucket::_insert(DiskLoc thisLoc, DiskLoc recordLoc,
-                             const BSONObj& key, const BSONObj &order, bool dupsAllowed,
+                             const BSONObj& key, const Ordering &order, bool dupsAllowed,
                              DiskLoc lChild, DiskLoc rChild, IndexDetails& idx) {
         if ( key.objsize() > KeyMax ) {
             problem() << "ERROR: key too large len:" << key.objsize() << " max:" << KeyMax << ' ' << key.objsize() << ' ' << idx.indexNamespace() << endl;
@@ -835,10 +893,12 @@ found:
         if ( found ) {
             _KeyNode& kn = k(pos);
             if ( kn.isUnused() ) {
-                log(4) << "btree _insert: reusing unused key" << endl;
+                log(4 , LogIndex) << "btree _insert: reusing unused key" << endl;
                 massert( 10285 , "_insert: reuse key but lchild is not null", lChild.isNull());
                 massert( 10286 , "_insert: reuse key but rchild is not null", rChild.isNull());
                 kn.setUsed();
+                if ( isCounted() )
+                    adjustSubtreeKeys(thisLoc, 1);
                 return 0;
             }
 
@@ -859,6 +919,8 @@ found:
         if ( insert_debug )
             out() << "    getChild(" << pos << "): " << child.toString() << endl;
         if ( child.isNull() || !rChild.isNull() /* means an 'internal' insert */ ) {
+            if ( isCounted() && rChild.isNull() )
+                adjustSubtreeKeys(thisLoc, 1); // a new key.  before insertHere() so splits see it.
             insertHere(thisLoc, pos, recordLoc, key, order, lChild, rChild, idx);
             return 0;
         }
@@ -882,7 +944,7 @@ found:
 
     /* todo: meaning of return code unclear clean up */
     int BtreeBucket::bt_insert(DiskLoc thisLoc, DiskLoc recordLoc,
-                            const BSONObj& key, const BSONObj &order, bool dupsAllowed,
+                            const BSONObj& key, const Ordering &order, bool dupsAllowed,
                             IndexDetails& idx, bool toplevel)
     {
         if ( toplevel ) {
@@ -905,7 +967,7 @@ found:
     DiskLoc BtreeBucket::findSingle( const IndexDetails& indexdetails , const DiskLoc& thisLoc, const BSONObj& key ){
         int pos;
         bool found;
-        DiskLoc bucket = locate( indexdetails , indexdetails.head , key , BSONObj() , pos , found , minDiskLoc );
+        DiskLoc bucket = locate( indexdetails , indexdetails.head , key , Ordering() , pos , found , minDiskLoc );
         if ( bucket.isNull() )
             return bucket;
 
@@ -925,6 +987,86 @@ found:
         return kn.recordLoc;
     }
 
+    /* --- counted indexes --- */
+
+    void BtreeBucket::adjustSubtreeKeys(const DiskLoc& thisLoc, int delta) {
+        for ( DiskLoc loc = thisLoc; !loc.isNull(); ) {
+            BtreeBucket *b = loc.btreemod();
+            b->_subtreeKeys += delta;
+            loc = b->parent;
+        }
+    }
+
+    long long BtreeBucket::keysIn(int from, int to) {
+        long long c = 0;
+        for ( int i = from; i < to; i++ ) {
+            if ( i == n ) {
+                c += subtreeKeys(nextChild);
+                break;
+            }
+            c += k(i).isUsed() + subtreeKeys(k(i).prevChildBucket);
+        }
+        return c;
+    }
+
+    long long BtreeBucket::keysBefore(const IndexDetails& idx, const DiskLoc& thisLoc, const BSONObj& key, const Ordering &order, const DiskLoc& recordLoc) {
+        long long before = 0;
+        DiskLoc loc = thisLoc;
+        while ( !loc.isNull() ) {
+            BtreeBucket *b = loc.btree();
+            int pos;
+            bool found = b->find(idx, key, recordLoc, order, pos, false);
+            // add up whichever side of pos has fewer children to look at
+            if ( pos <= b->n / 2 )
+                before += b->keysIn(0, pos);
+            else
+                before += b->_subtreeKeys - b->keysIn(pos, b->n+1);
+            if ( found )
+                return before + subtreeKeys(b->childForPos(pos));
+            loc = b->childForPos(pos);
+        }
+        return before;
+    }
+
+    DiskLoc BtreeBucket::keyAtRank(const DiskLoc& thisLoc, long long rank, int& pos) {
+        if ( rank < 0 || rank >= subtreeKeys(thisLoc) )
+            return DiskLoc();
+        DiskLoc loc = thisLoc;
+        while ( 1 ) {
+            BtreeBucket *b = loc.btree();
+            int i = 0;
+            for ( ; i < b->n; i++ ) {
+                long long c = subtreeKeys(b->k(i).prevChildBucket);
+                if ( rank < c )
+                    break;
+                rank -= c;
+                if ( b->k(i).isUsed() ) {
+                    if ( rank == 0 ) {
+                        pos = i;
+                        return loc;
+                    }
+                    rank--;
+                }
+            }
+            loc = b->childForPos(i);
+            massert( 13005 , "counted btree: subtree counts are inconsistent, reIndex", !loc.isNull() );
+        }
+    }
+
+    long long BtreeBucket::recountSubtree(const DiskLoc& thisLoc) {
+        BtreeBucket *b = thisLoc.btreemod();
+        long long c = 0;
+        for ( int i = 0; i < b->n; i++ ) {
+            c += b->k(i).isUsed();
+            if ( !b->k(i).prevChildBucket.isNull() )
+                c += recountSubtree(b->k(i).prevChildBucket);
+        }
+        if ( !b->nextChild.isNull() )
+            c += recountSubtree(b->nextChild);
+        b->_subtreeKeys = (int) c;
+        return c;
+    }
+
 } // namespace mongo
 
 #include "db.h"
@@ -942,7 +1084,7 @@ namespace mongo {
 
         DiskLoc rl;
         BSONObj key = fromjson("{x:9}");
-        BSONObj order = fromjson("{}");
+        Ordering order = Ordering::make(BSONObj());
 
         b->bt_insert(id.head, A, key, order, true, id);
         A.GETOFS() += 2;
@@ -983,8 +1125,40 @@ namespace mongo {
     {
         first = cur = BtreeBucket::addBucket(idx);
         b = cur.btreemod();
-        order = idx.keyPattern();
+        order = Ordering::make(idx.keyPattern());
         committed = false;
+        hintSequential();
+    }
+
+    /* the builder writes its buckets, and commit() reads them back, in the order they were
+       allocated, which is file order within the index's new extents: have those read ahead
+       sequentially while it runs rather than with the data files' usual random policy.
+    */
+    void BtreeBuilder::hintSequential() {
+#if !defined(_RECSTORE)
+        NamespaceDetails *d = nsdetails(idx.indexNamespace().c_str());
+        if ( d == 0 || d->lastExtent == hinted )
+            return;
+        DiskLoc e = hinted.isNull() ? d->firstExtent : hinted.ext()->xnext;
+        for ( ; !e.isNull(); e = e.ext()->xnext ) {
+            DataFileMgr::adviseExtent(e, MemoryMappedFile::Sequential);
+            hinted = e;
+        }
+#endif
+    }
+
+    void BtreeBuilder::unhint() {
+#if !defined(_RECSTORE)
+        if ( hinted.isNull() )
+            return;
+        NamespaceDetails *d = nsdetails(idx.indexNamespace().c_str());
+        for ( DiskLoc e = d ? d->firstExtent : DiskLoc(); !e.isNull(); e = e.ext()->xnext ) {
+            DataFileMgr::adviseExtent(e, MemoryMappedFile::Default);
+            if ( e == hinted )
+                break;
+        }
+        hinted = DiskLoc();
+#endif
     }
 
     void BtreeBuilder::newBucket() { 
@@ -992,6 +1166,7 @@ namespace mongo {
         b->tempNext() = L;
         cur = L;
         b = cur.btreemod();
+        hintSequential();
     }
 
     void BtreeBuilder::addKey(BSONObj& key, DiskLoc loc) { 
@@ -1068,18 +1243,27 @@ namespace mongo {
         }
 
         if( levels > 1 )
-            log(2) << "btree levels: " << levels << endl;
+            log(2 , LogIndex) << "btree levels: " << levels << endl;
     }
 
     /* when all addKeys are done, we then build the higher levels of the tree */
     void BtreeBuilder::commit() { 
         buildNextLevel(first);
+        if ( idx.head.btree()->isCounted() )
+            BtreeBucket::recountSubtree(idx.head);
         committed = true;
+        unhint();
     }
 
     BtreeBuilder::~BtreeBuilder() { 
+        try {
+            unhint();
+        }
+        catch ( ... ) { 
+            // only a hint; don't let it get in the way of the rollback
+        }
         if( !committed ) { 
-            log(2) << "Rolling back partially built index space" << endl;
+            log(2 , LogIndex) << "Rolling back partially built index space" << endl;
             DiskLoc x = first;
             while( !x.isNull() ) { 
                 DiskLoc next = x.btree()->tempNext();
@@ -1087,7 +1271,7 @@ namespace mongo {
                 x = next;
             }
             assert( idx.head.isNull() );
-            log(2) << "done rollback" << endl;
+            log(2 , LogIndex) << "done rollback" << endl;
         }
     }
 
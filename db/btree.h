@@ -81,10 +81,11 @@ namespace mongo {
         friend class BtreeBuilder;
         friend class KeyNode;
     public:
-        void dumpTree(DiskLoc thisLoc, const BSONObj &order);
+        void dumpTree(DiskLoc thisLoc, const Ordering &order);
         bool isHead() { return parent.isNull(); }
-        void assertValid(const BSONObj &order, bool force = false);
-        int fullValidate(const DiskLoc& thisLoc, const BSONObj &order); /* traverses everything */
+        bool isCounted() const { return ( flags & Counted ) != 0; }
+        void assertValid(const Ordering &order, bool force = false);
+        int fullValidate(const DiskLoc& thisLoc, const Ordering &order); /* traverses everything */
     protected:
         void modified(const DiskLoc& thisLoc);
         KeyNode keyNode(int i) const {
@@ -103,13 +104,13 @@ namespace mongo {
         /* returns false if node is full and must be split
            keypos is where to insert -- inserted after that key #.  so keypos=0 is the leftmost one.
         */
-        bool basicInsert(const DiskLoc& thisLoc, int keypos, const DiskLoc& recordLoc, const BSONObj& key, const BSONObj &order);
+        bool basicInsert(const DiskLoc& thisLoc, int keypos, const DiskLoc& recordLoc, const BSONObj& key, const Ordering &order);
         
         /**
          * @return true if works, false if not enough space
          */
-        bool _pushBack(const DiskLoc& recordLoc, BSONObj& key, const BSONObj &order, DiskLoc prevChild);
-        void pushBack(const DiskLoc& recordLoc, BSONObj& key, const BSONObj &order, DiskLoc prevChild){
+        bool _pushBack(const DiskLoc& recordLoc, BSONObj& key, const Ordering &order, DiskLoc prevChild);
+        void pushBack(const DiskLoc& recordLoc, BSONObj& key, const Ordering &order, DiskLoc prevChild){
             bool ok = _pushBack( recordLoc , key , order , prevChild );
             assert(ok);
         }
@@ -120,19 +121,19 @@ namespace mongo {
            We "repack" when we run out of space before considering the node
            to be full.
            */
-        enum Flags { Packed=1 };
+        enum Flags { Packed=1, Counted=2 };
 
         DiskLoc& childForPos(int p) {
             return p == n ? nextChild : k(p).prevChildBucket;
         }
 
         int totalDataSize() const;
-        void pack( const BSONObj &order );
+        void pack( const Ordering &order );
         void setNotPacked();
         void setPacked();
         int _alloc(int bytes);
         void _unalloc(int bytes);
-        void truncateTo(int N, const BSONObj &order);
+        void truncateTo(int N, const Ordering &order);
         void markUnused(int keypos);
 
         /* BtreeBuilder uses the parent var as a temp place to maintain a linked list chain. 
@@ -163,7 +164,7 @@ namespace mongo {
         int emptySize; // size of the empty region
         int topSize; // size of the data at the top of the bucket (keys are at the beginning or 'bottom')
         int n; // # of keys so far.
-        int reserved;
+        int _subtreeKeys; // counted indexes: # of used keys in this bucket and all below it.  otherwise 0.
         const _KeyNode& k(int i) const {
             return ((_KeyNode*)data)[i];
         }
@@ -180,15 +181,15 @@ namespace mongo {
 
         /* @return true if key exists in index 
 
-           order - indicates order of keys in the index.  this is basically the index's key pattern, e.g.:
-             BSONObj order = ((IndexDetails&)idx).keyPattern();
+           order - indicates order of keys in the index.  this is the index's key pattern, precomputed:
+             Ordering order = Ordering::make( ((IndexDetails&)idx).keyPattern() );
            likewise below in bt_insert() etc.
         */
-        bool exists(const IndexDetails& idx, DiskLoc thisLoc, const BSONObj& key, BSONObj order);
+        bool exists(const IndexDetails& idx, DiskLoc thisLoc, const BSONObj& key, const Ordering& order);
 
         bool wouldCreateDup(
             const IndexDetails& idx, DiskLoc thisLoc, 
-            const BSONObj& key, BSONObj order,
+            const BSONObj& key, const Ordering& order,
             DiskLoc self); 
 
         static DiskLoc addBucket(IndexDetails&); /* start a new index off, empty */
@@ -196,19 +197,29 @@ namespace mongo {
         
         static void renameIndexNamespace(const char *oldNs, const char *newNs);
 
+        /* dupsAllowed - if false, a used entry for key under another record uasserts
+                         ASSERT_ID_DUPKEY.  the check is made on the way down the same descent that
+                         inserts, and nothing has been modified when it fires.
+        */
         int bt_insert(DiskLoc thisLoc, DiskLoc recordLoc,
-                   const BSONObj& key, const BSONObj &order, bool dupsAllowed,
+                   const BSONObj& key, const Ordering &order, bool dupsAllowed,
                    IndexDetails& idx, bool toplevel = true);
 
         bool unindex(const DiskLoc& thisLoc, IndexDetails& id, BSONObj& key, const DiskLoc& recordLoc);
 
+        /* a record moved: point the used entry for key:oldLoc at newLoc where it sits.  equal keys
+           are ordered by recordLoc, so returns false (changing nothing) unless newLoc falls between
+           the entry's neighbours; the caller then unindexes and reinserts instead.
+        */
+        bool repoint(const DiskLoc& thisLoc, IndexDetails& id, const BSONObj& key, const DiskLoc& oldLoc, const DiskLoc& newLoc);
+
         /* locate may return an "unused" key that is just a marker.  so be careful.
              looks for a key:recordloc pair.
 
            found - returns true if exact match found.  note you can get back a position 
                    result even if found is false.
         */
-        DiskLoc locate(const IndexDetails& , const DiskLoc& thisLoc, const BSONObj& key, const BSONObj &order, 
+        DiskLoc locate(const IndexDetails& , const DiskLoc& thisLoc, const BSONObj& key, const Ordering &order, 
                        int& pos, bool& found, DiskLoc recordLoc, int direction=1);
         
         /**
@@ -225,23 +236,44 @@ namespace mongo {
         /* get tree shape */
         void shape(stringstream&);
 
+        /* counted indexes ({counted:true} in the index spec) keep a count of used keys in each
+           bucket's subtree, so ranks can be found in one descent instead of a scan.
+           the following are only valid when isCounted().
+        */
+        static long long subtreeKeys(const DiskLoc& loc) {
+            return loc.isNull() ? 0 : loc.btree()->_subtreeKeys;
+        }
+        /* # of used keys ordered before key:recordLoc.  pass minDiskLoc to count the keys < key,
+           maxDiskLoc for the keys <= key. */
+        long long keysBefore(const IndexDetails&, const DiskLoc& thisLoc, const BSONObj& key, const Ordering &order, const DiskLoc& recordLoc);
+        /* find the used key with keysBefore() == rank.  returns a null DiskLoc if there are not
+           that many keys. */
+        DiskLoc keyAtRank(const DiskLoc& thisLoc, long long rank, int& pos);
+        /* recompute the counts for an entire subtree, bottom up.  @return the subtree's count */
+        static long long recountSubtree(const DiskLoc& thisLoc);
+
+        BSONObj keyAt(int keyOfs) {
+            return keyOfs >= n ? BSONObj() : keyNode(keyOfs).key;
+        }
+
         static void a_test(IndexDetails&);
 
     private:
         void fixParentPtrs(const DiskLoc& thisLoc);
         void delBucket(const DiskLoc& thisLoc, IndexDetails&);
         void delKeyAtPos(const DiskLoc& thisLoc, IndexDetails& id, int p);
-        BSONObj keyAt(int keyOfs) {
-            return keyOfs >= n ? BSONObj() : keyNode(keyOfs).key;
-        }
+        /* add delta to the counts of this bucket and all of its ancestors */
+        static void adjustSubtreeKeys(const DiskLoc& thisLoc, int delta);
+        /* used keys and subtrees at positions [from, to).  to may be n+1 to include nextChild. */
+        long long keysIn(int from, int to);
         static BtreeBucket* allocTemp(); /* caller must release with free() */
         void insertHere(DiskLoc thisLoc, int keypos,
-                        DiskLoc recordLoc, const BSONObj& key, const BSONObj &order,
+                        DiskLoc recordLoc, const BSONObj& key, const Ordering &order,
                         DiskLoc lchild, DiskLoc rchild, IndexDetails&);
         int _insert(DiskLoc thisLoc, DiskLoc recordLoc,
-                    const BSONObj& key, const BSONObj &order, bool dupsAllowed,
+                    const BSONObj& key, const Ordering &order, bool dupsAllowed,
                     DiskLoc lChild, DiskLoc rChild, IndexDetails&);
-        bool find(const IndexDetails& idx, const BSONObj& key, DiskLoc recordLoc, const BSONObj &order, int& pos, bool assertIfDup);
+        bool find(const IndexDetails& idx, const BSONObj& key, DiskLoc recordLoc, const Ordering &order, int& pos, bool assertIfDup);
         static void findLargestKey(const DiskLoc& thisLoc, DiskLoc& largestLoc, int& largestKey);
     public:
         // simply builds and returns a dup key error message string
@@ -334,6 +366,23 @@ namespace mongo {
         }
         
         void forgetEndKey() { endKey = BSONObj(); }
+
+        /* skip scan: reposition on the first key past every key whose leading field equals that
+           of the current key.  lets distinct visit about one entry per distinct value.
+        */
+        void skipPastLeadingField();
+
+        /* counted indexes: reposition n keys further along in one descent rather than n advances.
+           only used when every key in range is a match (single interval, not multikey).
+           @return # of keys skipped (0 if this cursor can't skip) */
+        long long skipKeys( long long n );
+
+        /* counted indexes: # of entries equal to key */
+        long long nEqual( const BSONObj& key );
+
+        bool counted() const {
+            return indexDetails.head.btree()->isCounted();
+        }
         
     private:
         /* Our btrees may (rarely) have "unused" keys when items are deleted.
@@ -363,6 +412,7 @@ namespace mongo {
 
         const IndexDetails& indexDetails;
         BSONObj order;
+        Ordering ordering; // of order
         DiskLoc bucket;
         int keyOfs;
         int direction; // 1=fwd,-1=reverse
@@ -375,10 +425,10 @@ namespace mongo {
 #pragma pack()
 
     inline bool IndexDetails::hasKey(const BSONObj& key) { 
-        return head.btree()->exists(*this, head, key, keyPattern());
+        return head.btree()->exists(*this, head, key, Ordering::make(keyPattern()));
     }
     inline bool IndexDetails::wouldCreateDup(const BSONObj& key, DiskLoc self) { 
-        return head.btree()->wouldCreateDup(*this, head, key, keyPattern(), self);
+        return head.btree()->wouldCreateDup(*this, head, key, Ordering::make(keyPattern()), self);
     }
 
     /* build btree from the bottom up */
@@ -388,14 +438,17 @@ namespace mongo {
         IndexDetails& idx;
         unsigned long long n;
         BSONObj keyLast;
-        BSONObj order;
+        Ordering order;
         bool committed;
 
         DiskLoc cur, first;
         BtreeBucket *b;
+        DiskLoc hinted; // last of the index's extents hinted sequential
 
         void newBucket();
         void buildNextLevel(DiskLoc);
+        void hintSequential();
+        void unhint();
 
     public:
         ~BtreeBuilder();
@@ -35,6 +35,7 @@ namespace mongo {
             multikey( d->isMultikey( idxNo ) ),
             indexDetails( _id ),
             order( _id.keyPattern() ),
+            ordering( Ordering::make( order ) ),
             direction( _direction ),
             boundIndex_()
     {
@@ -49,6 +50,7 @@ namespace mongo {
             multikey( d->isMultikey( idxNo ) ),
             indexDetails( _id ),
             order( _id.keyPattern() ),
+            ordering( Ordering::make( order ) ),
             direction( _direction ),
             bounds_( _bounds ),
             boundIndex_()
@@ -64,7 +66,7 @@ namespace mongo {
         if ( otherTraceLevel >= 12 ) {
             if ( otherTraceLevel >= 200 ) {
                 out() << "::BtreeCursor() qtl>200.  validating entire index." << endl;
-                indexDetails.head.btree()->fullValidate(indexDetails.head, order);
+                indexDetails.head.btree()->fullValidate(indexDetails.head, ordering);
             }
             else {
                 out() << "BTreeCursor(). dumping head bucket" << endl;
@@ -76,7 +78,7 @@ namespace mongo {
     void BtreeCursor::init() {
         bool found;
         bucket = indexDetails.head.btree()->
-        locate(indexDetails, indexDetails.head, startKey, order, keyOfs, found, direction > 0 ? minDiskLoc : maxDiskLoc, direction);
+        locate(indexDetails, indexDetails.head, startKey, ordering, keyOfs, found, direction > 0 ? minDiskLoc : maxDiskLoc, direction);
         skipUnusedKeys();
         checkEnd();        
     }
@@ -118,7 +120,7 @@ namespace mongo {
         if ( bucket.isNull() )
             return;
         if ( !endKey.isEmpty() ) {
-            int cmp = sgn( endKey.woCompare( currKey(), order ) );
+            int cmp = sgn( endKey.woCompare( currKey(), ordering ) );
             if ( ( cmp != 0 && cmp != direction ) ||
                 ( cmp == 0 && !endKeyInclusive_ ) )
                 bucket = DiskLoc();
@@ -137,6 +139,61 @@ namespace mongo {
         return !bucket.isNull();
     }
 
+    void BtreeCursor::skipPastLeadingField() {
+        if ( bucket.isNull() )
+            return;
+
+        /* build { <leading value>, <bound>, ... } where each trailing bound sorts after every
+           real value in our scan direction, then locate just past it.
+        */
+        BSONObjBuilder b;
+        BSONObjIterator k( currKey() );
+        BSONObjIterator o( order );
+        b.appendAs( k.next(), "" );
+        o.next();
+        while ( o.more() ) {
+            BSONElement e = o.next();
+            if ( e.eoo() )
+                break;
+            int fieldDirection = e.number() < 0 ? -1 : 1;
+            if ( fieldDirection == direction )
+                b.appendMaxKey( "" );
+            else
+                b.appendMinKey( "" );
+        }
+
+        bool found;
+        bucket = indexDetails.head.btree()->
+        locate(indexDetails, indexDetails.head, b.obj(), ordering, keyOfs, found, direction > 0 ? maxDiskLoc : minDiskLoc, direction);
+        skipUnusedKeys();
+        checkEnd();
+        if( !ok() && ++boundIndex_ < bounds_.size() )
+            initInterval();
+    }
+
+    long long BtreeCursor::skipKeys( long long n ) {
+        if ( n <= 0 || bucket.isNull() || multikey || bounds_.size() > 1 || !counted() )
+            return 0;
+
+        const DiskLoc& head = indexDetails.head;
+        KeyNode kn = currKeyNode();
+        long long rank = head.btree()->keysBefore( indexDetails, head, kn.key, ordering, kn.recordLoc );
+        rank += direction > 0 ? n : -n;
+        if ( rank < 0 )
+            bucket = DiskLoc();
+        else
+            bucket = head.btree()->keyAtRank( head, rank, keyOfs );
+        checkEnd();
+        return n;
+    }
+
+    long long BtreeCursor::nEqual( const BSONObj& key ) {
+        const DiskLoc& head = indexDetails.head;
+        BtreeBucket *b = head.btree();
+        return b->keysBefore( indexDetails, head, key, ordering, maxDiskLoc ) -
+            b->keysBefore( indexDetails, head, key, ordering, minDiskLoc );
+    }
+
     void BtreeCursor::noteLocation() {
         if ( !eof() ) {
             BSONObj o = bucket.btree()->keyAt(keyOfs).copy();
@@ -186,7 +243,7 @@ namespace mongo {
         bool found;
 
         /* TODO: Switch to keep indexdetails and do idx.head! */
-        bucket = indexDetails.head.btree()->locate(indexDetails, indexDetails.head, keyAtKeyOfs, order, keyOfs, found, locAtKeyOfs, direction);
+        bucket = indexDetails.head.btree()->locate(indexDetails, indexDetails.head, keyAtKeyOfs, ordering, keyOfs, found, locAtKeyOfs, direction);
         RARELY log() << "  key seems to have moved in the index, refinding. found:" << found << endl;
         if ( ! bucket.isNull() )
             skipUnusedKeys();
@@ -205,6 +205,11 @@ namespace mongo {
         if( haveQuery() ) {
             b.append("query", query());
         }
+        if( _message[0] ) {
+            b.append("msg", _message);
+            if ( _progressTotal > 0 )
+                b.append("progress", BSON( "done" << _progressDone << "total" << _progressTotal ));
+        }
         // b.append("inLock",  ??
         stringstream clientStr;
         clientStr << inet_ntoa( _remote.sin_addr ) << ":" << ntohs( _remote.sin_port );
@@ -31,19 +31,29 @@
 
 namespace mongo {
 
-    CCById ClientCursor::clientCursorsById;
-    CCByLoc ClientCursor::byLoc;
-    boost::recursive_mutex ClientCursor::ccmutex;
+    ClientCursor::Partition ClientCursor::partitions[ClientCursor::NPartitions];
+
+    ClientCursor::Partition& ClientCursor::partitionFor(const string& ns) {
+        unsigned h = 0;
+        for ( const char *p = ns.c_str(); *p; p++ )
+            h = h * 131 + *p;
+        return partitions[ ( h ^ ( h >> 16 ) ) & ( NPartitions - 1 ) ];
+    }
 
     unsigned ClientCursor::byLocSize() { 
-        recursive_boostlock lock(ccmutex);
-        return byLoc.size();
+        unsigned n = 0;
+        for ( int i = 0; i < NPartitions; i++ ) {
+            recursive_boostlock lock(partitions[i].mutex);
+            n += partitions[i].byLoc.size();
+        }
+        return n;
     }
 
     void ClientCursor::setLastLoc_inlock(DiskLoc L) {
         if ( L == _lastLoc )
             return;
 
+        CCByLoc& byLoc = _partition->byLoc;
         if ( !_lastLoc.isNull() ) {
             CCByLoc::iterator i = kv_find(byLoc, _lastLoc, this);
             if ( i != byLoc.end() )
@@ -67,18 +77,19 @@ namespace mongo {
     		 drop "foo", currently, this will kill cursors for "foobar".
     */
     void ClientCursor::invalidate(const char *nsPrefix) {
-        vector<ClientCursor*> toDelete;
-
         int len = strlen(nsPrefix);
         assert( len > 0 && strchr(nsPrefix, '.') );
 
-        {
-            recursive_boostlock lock(ccmutex);
+        for ( int p = 0; p < NPartitions; p++ ) {
+            Partition& part = partitions[p];
+            vector<ClientCursor*> toDelete;
+
+            recursive_boostlock lock(part.mutex);
 
-            for ( CCByLoc::iterator i = byLoc.begin(); i != byLoc.end(); ++i ) {
-                ClientCursor *cc = i->second;
-                if ( strncmp(nsPrefix, cc->ns.c_str(), len) == 0 )
-                    toDelete.push_back(i->second);
+            for ( CCByNs::iterator i = part.byNs.lower_bound(nsPrefix); i != part.byNs.end(); ++i ) {
+                if ( strncmp(nsPrefix, i->first.c_str(), len) != 0 )
+                    break;
+                toDelete.insert(toDelete.end(), i->second.begin(), i->second.end());
             }
 
             for ( vector<ClientCursor*>::iterator i = toDelete.begin(); i != toDelete.end(); ++i )
@@ -88,50 +99,51 @@ namespace mongo {
 
     /* called every 4 seconds.  millis is amount of idle time passed since the last call -- could be zero */
     void ClientCursor::idleTimeReport(unsigned millis) {
-        recursive_boostlock lock(ccmutex);
-        for ( CCByLoc::iterator i = byLoc.begin(); i != byLoc.end();  ) {
-            CCByLoc::iterator j = i;
-            i++;
-            if( j->second->shouldTimeout( millis ) ){
-                log(1) << "killing old cursor " << j->second->cursorid << ' ' << j->second->ns 
-                       << " idle:" << j->second->idleTime() << "ms\n";
-                delete j->second;
+        for ( int p = 0; p < NPartitions; p++ ) {
+            CCByLoc& byLoc = partitions[p].byLoc;
+            recursive_boostlock lock(partitions[p].mutex);
+            for ( CCByLoc::iterator i = byLoc.begin(); i != byLoc.end();  ) {
+                CCByLoc::iterator j = i;
+                i++;
+                if( j->second->shouldTimeout( millis ) ){
+                    log(1) << "killing old cursor " << j->second->cursorid << ' ' << j->second->ns 
+                           << " idle:" << j->second->idleTime() << "ms\n";
+                    delete j->second;
+                }
             }
         }
     }
 
     /* must call when a btree bucket going away.
-       note this is potentially slow
+       only the cursors open on the index's collection can be positioned in the bucket.
     */
-    void ClientCursor::informAboutToDeleteBucket(const DiskLoc& b) {
-        recursive_boostlock lock(ccmutex);
-        RARELY if ( byLoc.size() > 70 ) {
-            log() << "perf warning: byLoc.size=" << byLoc.size() << " in aboutToDeleteBucket\n";
-        }
-        for ( CCByLoc::iterator i = byLoc.begin(); i != byLoc.end(); i++ )
-            i->second->c->aboutToDeleteBucket(b);
-    }
-    void aboutToDeleteBucket(const DiskLoc& b) {
-        ClientCursor::informAboutToDeleteBucket(b); 
+    void ClientCursor::informAboutToDeleteBucket(const string& ns, const DiskLoc& b) {
+        Partition& part = partitionFor(ns);
+        recursive_boostlock lock(part.mutex);
+        CCByNs::iterator i = part.byNs.find(ns);
+        if ( i == part.byNs.end() )
+            return;
+        for ( set<ClientCursor*>::iterator j = i->second.begin(); j != i->second.end(); ++j )
+            (*j)->c->aboutToDeleteBucket(b);
     }
 
     /* must call this on a delete so we clean up the cursors. */
-    void ClientCursor::aboutToDelete(const DiskLoc& dl) {
-        recursive_boostlock lock(ccmutex);
+    void ClientCursor::aboutToDelete(const string& ns, const DiskLoc& dl) {
+        Partition& part = partitionFor(ns);
+        recursive_boostlock lock(part.mutex);
 
-        CCByLoc::iterator j = byLoc.lower_bound(dl);
-        CCByLoc::iterator stop = byLoc.upper_bound(dl);
+        CCByLoc::iterator j = part.byLoc.lower_bound(dl);
+        CCByLoc::iterator stop = part.byLoc.upper_bound(dl);
         if ( j == stop )
             return;
 
         vector<ClientCursor*> toAdvance;
 
-        while ( 1 ) {
-            toAdvance.push_back(j->second);
+        for ( ; j != stop; ++j ) {
             WIN assert( j->first == dl );
-            ++j;
-            if ( j == stop )
-                break;
+            // another database can have a record at the same DiskLoc
+            if ( j->second->ns == ns )
+                toAdvance.push_back(j->second);
         }
 
         wassert( toAdvance.size() < 5000 );
@@ -164,15 +176,19 @@ namespace mongo {
             }
         }
     }
-    void aboutToDelete(const DiskLoc& dl) { ClientCursor::aboutToDelete(dl); }
 
     ClientCursor::~ClientCursor() {
         assert( pos != -2 );
 
         {
-            recursive_boostlock lock(ccmutex);
+            recursive_boostlock lock(_partition->mutex);
             setLastLoc_inlock( DiskLoc() ); // removes us from bylocation multimap
-            clientCursorsById.erase(cursorid);
+            _partition->byId.erase(cursorid);
+            CCByNs::iterator i = _partition->byNs.find(ns);
+            assert( i != _partition->byNs.end() );
+            i->second.erase(this);
+            if ( i->second.empty() )
+                _partition->byNs.erase(i);
 
             // defensive:
             (CursorId&) cursorid = -1;
@@ -193,7 +209,7 @@ namespace mongo {
             return;
         }
         {
-            recursive_boostlock lock(ccmutex);
+            recursive_boostlock lock(_partition->mutex);
             setLastLoc_inlock(cl);
             c->noteLocation();
         }
@@ -243,17 +259,17 @@ namespace mongo {
         return true;
     }
 
-    int ctmLast = 0; // so we don't have to do find() which is a little slow very often.
-    long long ClientCursor::allocCursorId_inlock() {
+    /* the low bits of the id are the partition number, see partitionFor(CursorId) */
+    long long ClientCursor::allocCursorId_inlock(Partition& p) {
         long long x;
-        int ctm = (int) curTimeMillis();
+        unsigned low = ( (unsigned) curTimeMillis() & ~( NPartitions - 1 ) ) | 0x80000000 | unsigned( &p - partitions ); // 0x80000000 to make sure not zero
         while ( 1 ) {
             x = (((long long)rand()) << 32);
-            x = x | ctm | 0x80000000; // OR to make sure not zero
-            if ( ctm != ctmLast || ClientCursor::find_inlock(x, false) == 0 )
+            x = x | low;
+            if ( low != p.lastIdLow || ClientCursor::find_inlock(x, false) == 0 )
                 break;
         }
-        ctmLast = ctm;
+        p.lastIdLow = low;
         DEV out() << "  alloccursorid " << x << endl;
         return x;
     }
@@ -268,9 +284,18 @@ namespace mongo {
             help << " example: { cursorInfo : 1 }";
         }
         bool run(const char *dbname, BSONObj& jsobj, string& errmsg, BSONObjBuilder& result, bool fromRepl ){
-            recursive_boostlock lock(ClientCursor::ccmutex);
-            result.append("byLocation_size", unsigned( ClientCursor::byLoc.size() ) );
-            result.append("clientCursors_size", unsigned( ClientCursor::clientCursorsById.size() ) );
+            unsigned byLoc = 0, byId = 0, namespaces = 0;
+            for ( int i = 0; i < ClientCursor::NPartitions; i++ ) {
+                ClientCursor::Partition& p = ClientCursor::partitions[i];
+                recursive_boostlock lock(p.mutex);
+                byLoc += p.byLoc.size();
+                byId += p.byId.size();
+                namespaces += p.byNs.size();
+            }
+            result.append("byLocation_size", byLoc );
+            result.append("clientCursors_size", byId );
+            result.append("namespaces", namespaces );
+            result.append("partitions", (int) ClientCursor::NPartitions );
             return true;
         }
     } cmdCursorInfo;
@@ -44,6 +44,8 @@ namespace mongo {
 
     typedef multimap<DiskLoc, ClientCursor*> CCByLoc;
 
+    typedef map<string, set<ClientCursor*> > CCByNs;
+
     extern BSONObj id_obj;
 
     class ClientCursor {
@@ -59,11 +61,29 @@ namespace mongo {
 
         bool _doingDeletes;
 
-        static CCById clientCursorsById;
-        static CCByLoc byLoc;
-        static boost::recursive_mutex ccmutex;   // must use this for all statics above!
-        
-        static CursorId allocCursorId_inlock();
+        /* open cursors are registered in one of NPartitions partitions, chosen by namespace, each
+           with its own mutex.  the partition number is kept in the low bits of the cursorid so a
+           getMore finds its partition without a search.  byNs lets a delete or a btree bucket free
+           visit only the cursors of the collection involved rather than every open cursor.
+           never hold more than one partition's mutex at a time.
+        */
+        enum { NPartitions = 16 };
+        struct Partition {
+            CCById byId;
+            CCByLoc byLoc;
+            CCByNs byNs;
+            unsigned lastIdLow;              // so we don't have to do find() which is a little slow very often
+            boost::recursive_mutex mutex;    // must use this for all of the above!
+            Partition() : lastIdLow(0) { }
+        };
+        static Partition partitions[NPartitions];
+        static Partition& partitionFor(const string& ns);
+        static Partition& partitionFor(CursorId id) {
+            return partitions[ id & ( NPartitions - 1 ) ];
+        }
+        Partition *_partition;
+
+        static CursorId allocCursorId_inlock(Partition& p);
 
     public:
         /* use this to assure we don't in the background time out cursor while it is under use.
@@ -83,7 +103,7 @@ namespace mongo {
                 _c = 0;
             }
             Pointer(long long cursorid) {
-                recursive_boostlock lock(ccmutex);
+                recursive_boostlock lock(partitionFor(cursorid).mutex);
                 _c = ClientCursor::find_inlock(cursorid, true);
                 if( _c ) {
                     if( _c->_pinValue >= 100 ) {
@@ -113,9 +133,11 @@ namespace mongo {
         {
             if( !okToTimeout )
                 noTimeout();
-            recursive_boostlock lock(ccmutex);
-            cursorid = allocCursorId_inlock();
-            clientCursorsById.insert( make_pair(cursorid, this) );
+            _partition = &partitionFor(ns);
+            recursive_boostlock lock(_partition->mutex);
+            cursorid = allocCursorId_inlock(*_partition);
+            _partition->byId.insert( make_pair(cursorid, this) );
+            _partition->byNs[ns].insert(this);
         }
         ~ClientCursor();
 
@@ -145,8 +167,9 @@ namespace mongo {
         void setLastLoc_inlock(DiskLoc);
 
         static ClientCursor* find_inlock(CursorId id, bool warn = true) {
-            CCById::iterator it = clientCursorsById.find(id);
-            if ( it == clientCursorsById.end() ) {
+            CCById& byId = partitionFor(id).byId;
+            CCById::iterator it = byId.find(id);
+            if ( it == byId.end() ) {
                 if ( warn )
                     OCCASIONALLY out() << "ClientCursor::find(): cursor not found in map " << id << " (ok after a drop)\n";
                 return 0;
@@ -155,7 +178,7 @@ namespace mongo {
         }
     public:
         static ClientCursor* find(CursorId id, bool warn = true) { 
-            recursive_boostlock lock(ccmutex);
+            recursive_boostlock lock(partitionFor(id).mutex);
             ClientCursor *c = find_inlock(id, warn);
 			// if this asserts, your code was not thread safe - you either need to set no timeout 
 			// for the cursor or keep a ClientCursor::Pointer in scope for it.
@@ -164,7 +187,7 @@ namespace mongo {
         }
 
         static bool erase(CursorId id) {
-            recursive_boostlock lock(ccmutex);
+            recursive_boostlock lock(partitionFor(id).mutex);
             ClientCursor *cc = find_inlock(id);
             if ( cc ) {
                 assert( cc->_pinValue < 100 ); // you can't still have an active ClientCursor::Pointer
@@ -216,8 +239,9 @@ public:
 
         static unsigned byLocSize();        // just for diagnostics
 
-        static void informAboutToDeleteBucket(const DiskLoc& b);
-        static void aboutToDelete(const DiskLoc& dl);
+        /* ns is the collection the bucket's index / the record belongs to */
+        static void informAboutToDeleteBucket(const string& ns, const DiskLoc& b);
+        static void aboutToDelete(const string& ns, const DiskLoc& dl);
     };
 
     
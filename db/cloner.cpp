@@ -26,6 +26,7 @@
 #include "db.h"
 #include "instance.h"
 #include "repl.h"
+#include "../util/queue.h"
 
 namespace mongo {
 
@@ -33,11 +34,141 @@ namespace mongo {
 
     bool replAuthenticate(DBClientConnection *);
 
+    extern BSONObj id_obj; // { _id : 1 }
+
+    /* connections Cloner::go uses to copy collections in parallel from a remote host (--cloneConnections).
+       1 copies one collection at a time over a single connection. */
+    int cloneConnections = 4;
+
+    /* a collection, or one _id range of a large collection, for the parallel cloner */
+    struct CloneTask {
+        string from;
+        string to;
+        Query query;
+    };
+
+    struct CloneBatch {
+        CloneBatch( int t ) : task( t ), last( false ) { }
+        int task;
+        vector<BSONObj> objs;
+        bool last;     // no more batches for this task
+        string err;    // set if the fetch failed
+    };
+
+    /* runs one task's query on a connection of its own in a thread of its own.  the fetcher stays
+       at most MaxAhead batches in front of the inserts, so the getMore for the next batch overlaps
+       the inserts for this one without buffering a whole collection in memory.
+       wait() joins the thread, so once it returns the fetcher may be destroyed.
+    */
+    class CloneFetcher : boost::noncopyable {
+    public:
+        enum { MaxAhead = 2, BatchBytes = 1024 * 1024 };
+
+        CloneFetcher( int task, shared_ptr<DBClientConnection> conn, const CloneTask& t, int options, BlockingQueue<CloneBatch*>& out ) :
+            _task( task ), _conn( conn ), _ns( t.from ), _query( t.query ), _options( options ), _out( out ), _ahead( 0 ), _stop( false ) {
+        }
+
+        /* if parallelCopy is unwinding past us, don't leave the thread running on a dead fetcher */
+        ~CloneFetcher() {
+            stop();
+            wait();
+        }
+
+        shared_ptr<DBClientConnection> conn() const { return _conn; }
+
+        void go() {
+            _thread.reset( new boost::thread( boost::bind( &CloneFetcher::run, this ) ) );
+        }
+
+        void wait() {
+            if ( _thread.get() ) {
+                _thread->join();
+                _thread.reset();
+            }
+        }
+
+        /* the consumer is done with one of our batches */
+        void consumed() {
+            boostlock lk( _m );
+            _ahead--;
+            _c.notify_one();
+        }
+
+        /* the consumer gave up; anything we fetch from here on is thrown away */
+        void stop() {
+            boostlock lk( _m );
+            _stop = true;
+            _c.notify_one();
+        }
+
+    private:
+        void run() {
+            auto_ptr<CloneBatch> b( new CloneBatch( _task ) );
+            try {
+                auto_ptr<DBClientCursor> c = _conn->query( _ns.c_str(), _query, 0, 0, 0, _options );
+                uassert( 13006 , "cloner query failed" , c.get() );
+                int bytes = 0;
+                while ( c->more() ) {
+                    // next() points into the reply message, which the next getMore replaces
+                    BSONObj o = c->next().getOwned();
+                    if ( strcmp( o.firstElement().fieldName(), "$err" ) == 0 ) {
+                        b->err = o.firstElement().str();
+                        break;
+                    }
+                    bytes += o.objsize();
+                    b->objs.push_back( o );
+                    if ( bytes >= BatchBytes ) {
+                        if ( !hand( b ) )
+                            return;
+                        b.reset( new CloneBatch( _task ) );
+                        bytes = 0;
+                    }
+                }
+            }
+            catch ( std::exception& e ) {
+                b->err = e.what();
+            }
+            catch ( ... ) {
+                b->err = "unknown exception";
+            }
+            b->last = true;
+            hand( b );
+        }
+
+        /* blocks while we are MaxAhead batches in front.  false if the consumer stopped us. */
+        bool hand( auto_ptr<CloneBatch>& b ) {
+            boostlock lk( _m );
+            while ( _ahead >= MaxAhead && !_stop )
+                _c.wait( lk );
+            if ( _stop )
+                return false;
+            _ahead++;
+            _out.push( b.release() );
+            return true;
+        }
+
+        int _task;
+        shared_ptr<DBClientConnection> _conn;
+        string _ns;
+        Query _query;
+        int _options;
+        BlockingQueue<CloneBatch*>& _out;
+
+        boost::mutex _m;
+        boost::condition _c;
+        int _ahead;
+        bool _stop;
+        auto_ptr<boost::thread> _thread;
+    };
+
     class Cloner: boost::noncopyable {
         auto_ptr< DBClientWithCommands > conn;
         void copy(const char *from_ns, const char *to_ns, bool isindex, bool logForRepl,
                   bool masterSameProcess, bool slaveOk, Query q = Query());
         void replayOpLog( DBClientCursor *c, const BSONObj &query );
+        void splitById( const string& fromdb, const CloneTask& t, long long count, list<CloneTask>& tasks );
+        bool parallelCopy( const char *masterHost, const vector<CloneTask>& tasks, bool logForRepl, bool slaveOk, string& errmsg );
+        enum { SplitObjects = 1000000 }; // smallest _id range worth a connection of its own
     public:
         Cloner() { }
 
@@ -63,6 +194,12 @@ namespace mongo {
             BSONElement e = i.next();
             if ( e.eoo() )
                 break;
+            if ( string("background") == e.fieldName() ) {
+                /* the collection's data is already here: a foreground build sorts the keys and
+                   builds the btree bottom up, which is much faster than a background build's
+                   insert per key. */
+                continue;
+            }
             if ( string("ns") == e.fieldName() ) {
                 uassert( 10024 , "bad ns field for index during dbcopy", e.type() == String);
                 const char *p = strchr(e.valuestr(), '.');
@@ -85,6 +222,35 @@ namespace mongo {
         return res;
     }
 
+    /* insert one object fetched by the cloner.  false if the object was corrupt and skipped. */
+    static bool insertCloned(const char *from_collection, const char *to_collection, BSONObj js, bool logForRepl) {
+        /* assure object is valid.  note this will slow us down a little. */
+        if ( !js.valid() ) {
+            stringstream ss;
+            ss << "skipping corrupt object from " << from_collection;
+            BSONElement e = js.firstElement();
+            try {
+                e.validate();
+                ss << " firstElement: " << e;
+            }
+            catch( ... ){
+                ss << " firstElement corrupt";
+            }
+            out() << ss.str() << endl;
+            return false;
+        }
+
+        try { 
+            theDataFileMgr.insert(to_collection, js);
+            if ( logForRepl )
+                logOp("i", to_collection, js);
+        }
+        catch( UserException& e ) { 
+            log() << "warning: exception cloning object in " << from_collection << ' ' << e.what() << " obj:" << js.toString() << '\n';
+        }
+        return true;
+    }
+
     /* copy the specified collection
        isindex - if true, this is system.indexes collection, in which we do some transformation when copying.
     */
@@ -108,40 +274,19 @@ namespace mongo {
             }
             BSONObj tmp = c->next();
 
-            /* assure object is valid.  note this will slow us down a little. */
-            if ( !tmp.valid() ) {
-                stringstream ss;
-                ss << "skipping corrupt object from " << from_collection;
-                BSONElement e = tmp.firstElement();
-                try {
-                    e.validate();
-                    ss << " firstElement: " << e;
-                }
-                catch( ... ){
-                    ss << " firstElement corrupt";
-                }
-                out() << ss.str() << endl;
-                continue;
-            }
-
-            ++n;
-            
-            BSONObj js = tmp;
             if ( isindex ) {
+                if ( !tmp.valid() ) {
+                    out() << "skipping corrupt index spec from " << from_collection << endl;
+                    continue;
+                }
+                ++n;
                 assert( strstr(from_collection, "system.indexes") );
-                js = fixindex(tmp);
-                storedForLater.push_back( js.getOwned() );
+                storedForLater.push_back( fixindex(tmp).getOwned() );
                 continue;
             }
 
-            try { 
-                theDataFileMgr.insert(to_collection, js);
-                if ( logForRepl )
-                    logOp("i", to_collection, js);
-            }
-            catch( UserException& e ) { 
-                log() << "warning: exception cloning object in " << from_collection << ' ' << e.what() << " obj:" << js.toString() << '\n';
-            }
+            if ( insertCloned( from_collection, to_collection, tmp, logForRepl ) )
+                ++n;
             
             RARELY if ( time( 0 ) - saveLast > 60 ) {
                 log() << n << " objects cloned so far from collection " << from_collection << endl;
@@ -213,7 +358,7 @@ namespace mongo {
             while ( c->more() ){
                 BSONObj collection = c->next();
 
-                log(2) << "\t cloner got " << collection << endl;
+                log(2 , LogRepl) << "\t cloner got " << collection << endl;
 
                 BSONElement e = collection.getField("name");
                 if ( e.eoo() ) {
@@ -227,13 +372,13 @@ namespace mongo {
                 if( strstr(from_name, ".system.") ) { 
                     /* system.users is cloned -- but nothing else from system. */
                     if( legalClientSystemNS( from_name , true ) == 0 ){
-                        log(2) << "\t\t not cloning because system collection" << endl;
+                        log(2 , LogRepl) << "\t\t not cloning because system collection" << endl;
                         continue;
                     }
                 }
                 else if( strchr(from_name, '$') ) {
                     // don't clone index namespaces -- we take care of those separately below.
-                    log(2) << "\t\t not cloning because has $ " << endl;
+                    log(2 , LogRepl) << "\t\t not cloning because has $ " << endl;
                     continue;
                 }            
                 
@@ -241,12 +386,17 @@ namespace mongo {
             }
         }
 
+        /* with more than one connection to a remote host the collections -- and _id ranges of the
+           large ones -- are fetched in parallel.  inserts still happen here, under our lock. */
+        bool parallel = !masterSameProcess && cloneConnections > 1;
+        list<CloneTask> tasks;
+        list<string> needIdIndex;
         for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ){
             {
                 dbtemprelease r;
             }
             BSONObj collection = *i;
-            log(2) << "  really will clone: " << collection << endl;
+            log(2 , LogRepl) << "  really will clone: " << collection << endl;
             const char * from_name = collection["name"].valuestr();
             BSONObj options = collection.getObjectField("options");
             
@@ -258,15 +408,49 @@ namespace mongo {
             {
                 string err;
                 const char *toname = to_name.c_str();
-                userCreateNS(toname, options, err, logForRepl);
+                bool deferIdIndex = false;
+                userCreateNS(toname, options, err, logForRepl, &deferIdIndex);
+                if ( deferIdIndex )
+                    needIdIndex.push_back( to_name );
+            }
+
+            CloneTask t;
+            t.from = from_name;
+            t.to = to_name;
+            if ( !parallel ) {
+                log(1 , LogRepl) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+                if( snapshot ) 
+                    t.query.snapshot();
+                copy(from_name, to_name.c_str(), false, logForRepl, masterSameProcess, slaveOk, t.query);
+                continue;
+            }
+
+            long long count = 0;
+            if ( !options["capped"].trueValue() ) {
+                dbtemprelease r;
+                count = conn->count( from_name, BSONObj(), slaveOk ? QueryOption_SlaveOk : 0 );
+            }
+            if ( count >= 2 * SplitObjects ) {
+                splitById( fromdb, t, count, tasks );
+            }
+            else {
+                if( snapshot ) 
+                    t.query.snapshot();
+                tasks.push_back( t );
             }
-            log(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-            Query q;
-            if( snapshot ) 
-                q.snapshot();
-            copy(from_name, to_name.c_str(), false, logForRepl, masterSameProcess, slaveOk, q);
         }
 
+        bool ok = !parallel || parallelCopy( masterHost, vector<CloneTask>( tasks.begin(), tasks.end() ), logForRepl, slaveOk, errmsg );
+
+        /* the _id indexes were left out above so they can be built now in one pass from sorted keys.
+           done even if the copy failed so no collection is left without one. */
+        for ( list<string>::iterator i = needIdIndex.begin(); i != needIdIndex.end(); i++ ) {
+            log(1 , LogRepl) << "\t\t building _id index for " << *i << endl;
+            ensureHaveIdIndex( i->c_str() );
+        }
+        if ( !ok )
+            return false;
+
         // now build the indexes
         string system_indexes_from = fromdb + ".system.indexes";
         string system_indexes_to = todb + ".system.indexes";
@@ -279,6 +463,142 @@ namespace mongo {
         return true;
     }
 
+    /* splits a large collection into _id ranges, using medianKey on the source, so the ranges can
+       be fetched over separate connections.  the ranges are given as $min/$max bounds on the _id
+       index rather than as a query, so values of every type fall in exactly one range.
+    */
+    void Cloner::splitById( const string& fromdb, const CloneTask& t, long long count, list<CloneTask>& tasks ) {
+        BSONObj lo, hi;
+        {
+            BSONObjBuilder b;
+            b.appendMinKey( "_id" );
+            lo = b.obj();
+        }
+        {
+            BSONObjBuilder b;
+            b.appendMaxKey( "_id" );
+            hi = b.obj();
+        }
+        vector<BSONObj> bounds;
+        bounds.push_back( lo );
+        bounds.push_back( hi );
+
+        /* halve every range until there are enough of them or they would get too small */
+        while ( (int) bounds.size() - 1 < cloneConnections && count / (long long) ( bounds.size() - 1 ) >= 2 * SplitObjects ) {
+            vector<BSONObj> finer;
+            finer.push_back( bounds[0] );
+            for ( unsigned i = 1; i < bounds.size(); i++ ) {
+                BSONObj info;
+                bool ok;
+                {
+                    dbtemprelease r;
+                    ok = conn->runCommand( fromdb, BSON( "medianKey" << t.from << "keyPattern" << id_obj << "min" << bounds[i-1] << "max" << bounds[i] ), info );
+                }
+                BSONObj median = info.getObjectField( "median" );
+                if ( ok && !median.isEmpty() && median.woCompare( bounds[i-1] ) > 0 && median.woCompare( bounds[i] ) < 0 )
+                    finer.push_back( median.getOwned() );
+                finer.push_back( bounds[i] );
+            }
+            if ( finer.size() == bounds.size() )
+                break; // no _id index on the source, or nothing left to split
+            bounds.swap( finer );
+        }
+
+        log(1 , LogRepl) << "\t\t cloning " << t.from << " -> " << t.to << " in " << bounds.size() - 1 << " _id ranges" << endl;
+        for ( unsigned i = 1; i < bounds.size(); i++ ) {
+            CloneTask part = t;
+            part.query.hint( id_obj );
+            if ( i > 1 )
+                part.query.minKey( bounds[i-1] );
+            if ( i < bounds.size() - 1 )
+                part.query.maxKey( bounds[i] );
+            tasks.push_back( part );
+        }
+    }
+
+    /* runs up to cloneConnections fetchers at once, each on its own connection, and inserts their
+       batches as they arrive.  called, and returns, with our db lock held; it is only released
+       while waiting for the next batch.
+    */
+    bool Cloner::parallelCopy( const char *masterHost, const vector<CloneTask>& tasks, bool logForRepl, bool slaveOk, string& errmsg ) {
+        BlockingQueue<CloneBatch*> batches;
+        vector< shared_ptr<CloneFetcher> > fetchers( tasks.size() );
+        vector< shared_ptr<DBClientConnection> > idle;
+        int options = QueryOption_NoCursorTimeout | ( slaveOk ? QueryOption_SlaveOk : 0 );
+        unsigned next = 0;
+        int running = 0;
+        bool ok = true;
+
+        while ( ok && ( running > 0 || next < tasks.size() ) ) {
+            while ( ok && running < cloneConnections && next < tasks.size() ) {
+                shared_ptr<DBClientConnection> c;
+                if ( !idle.empty() ) {
+                    c = idle.back();
+                    idle.pop_back();
+                }
+                else {
+                    dbtemprelease r;
+                    c.reset( new DBClientConnection() );
+                    if ( !c->connect( masterHost, errmsg ) || !replAuthenticate( c.get() ) ) {
+                        if ( errmsg.empty() )
+                            errmsg = "clone: can't authenticate to " + string( masterHost );
+                        ok = false;
+                        break;
+                    }
+                }
+                log(1 , LogRepl) << "\t\t cloning " << tasks[next].from << " -> " << tasks[next].to << ' ' << tasks[next].query.toString() << endl;
+                fetchers[next].reset( new CloneFetcher( next, c, tasks[next], options, batches ) );
+                fetchers[next]->go();
+                next++;
+                running++;
+            }
+            if ( !ok )
+                break;
+
+            CloneBatch *p;
+            {
+                dbtemprelease r;
+                p = batches.blockingPop();
+            }
+            auto_ptr<CloneBatch> b( p );
+            const CloneTask& t = tasks[b->task];
+            if ( !b->err.empty() ) {
+                errmsg = "clone of " + t.from + " failed: " + b->err;
+                ok = false;
+                break;
+            }
+            for ( vector<BSONObj>::iterator i = b->objs.begin(); i != b->objs.end(); i++ )
+                insertCloned( t.from.c_str(), t.to.c_str(), *i, logForRepl );
+
+            shared_ptr<CloneFetcher> f = fetchers[b->task];
+            f->consumed();
+            if ( b->last ) {
+                {
+                    dbtemprelease r;
+                    f->wait();
+                }
+                idle.push_back( f->conn() );
+                fetchers[b->task].reset();
+                running--;
+            }
+        }
+
+        if ( !ok ) {
+            /* unblock and reap whatever is still running, then throw away what they sent */
+            dbtemprelease r;
+            for ( unsigned i = 0; i < fetchers.size(); i++ ) {
+                if ( fetchers[i] ) {
+                    fetchers[i]->stop();
+                    fetchers[i]->wait();
+                }
+            }
+            CloneBatch *p;
+            while ( batches.tryPop( p ) )
+                delete p;
+        }
+        return ok;
+    }
+
     bool Cloner::startCloneCollection( const char *fromhost, const char *ns, const BSONObj &query, string &errmsg, bool logForRepl, bool copyIndexes, int logSizeMb, long long &cursorId ) {
         char db[256];
         nsToDatabase( ns, db );
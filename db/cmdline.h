@@ -31,6 +31,9 @@ namespace mongo {
         bool notablescan;      // --notablescan
         bool prealloc;         // --noprealloc
         bool smallfiles;       // --smallfiles
+        bool sizeClasses;      // --sizeClasses
+        bool randomReadahead;  // --readahead random (default) or normal, for data files
+        bool wireCompression;  // --wireCompression compress traffic on connections we make
         
         bool quota;            // --quota
         int quotaFiles;        // --quotaFiles
@@ -47,7 +50,7 @@ namespace mongo {
         };
 
         CmdLine() : 
-            port(DefaultDBPort), quiet(false), notablescan(false), prealloc(true), smallfiles(false),
+            port(DefaultDBPort), quiet(false), notablescan(false), prealloc(true), smallfiles(false), sizeClasses(false), randomReadahead(true), wireCompression(false),
             quota(false), quotaFiles(8), cpu(false), oplogSize(0), defaultProfile(0), slowMS(100)
         { } 
 
@@ -5,7 +5,7 @@
    Mutex heirarchy (1 = "leaf")
      name                   level
      Logstream::mutex       1
-     ClientCursor::ccmutex  2
+     ClientCursor partition 2   (ClientCursor::Partition::mutex, one at a time)
      dblock                 3
 
      End func name with _inlock to indicate "caller must lock before calling".
@@ -12,9 +12,15 @@ namespace mongo {
     class OpDebug {
     public:
         StringBuilder str;
+        long long nscanned; // -1 if the op didn't scan anything
+        string plan;        // cursor chosen by the query optimizer, e.g. "BtreeCursor a_1"
+
+        OpDebug() : nscanned(-1) { }
         
         void reset(){
             str.reset();
+            nscanned = -1;
+            plan.clear();
         }
     };
     
@@ -35,6 +41,8 @@ namespace mongo {
         int _op;
         int _lockType; // see concurrency.h for values
         bool _waitingForLock;
+        unsigned long long _lockWaitStart;
+        unsigned long long _lockWaitMicros; // total time this op spent waiting on dbMutex
         int _dbprofile; // 0=off, 1=slow, 2=all
         AtomicUInt _opNum;
         char _ns[Namespace::MaxNsLen+2];
@@ -42,15 +50,25 @@ namespace mongo {
         
         char _queryBuf[256];
 
+        /* what a long running op is up to and how far along, for currentOp */
+        char _message[64];
+        long long _progressDone;
+        long long _progressTotal;
+
         void resetQuery(int x=0) { *((int *)_queryBuf) = x; }
         
         OpDebug _debug;
+        Arena _arena;
 
         void _reset(){
             _lockType = 0;
             _dbprofile = 0;
             _end = 0;
             _waitingForLock = false;
+            _lockWaitStart = 0;
+            _lockWaitMicros = 0;
+            _message[0] = 0;
+            _progressDone = _progressTotal = 0;
         }
 
         void setNS(const char *ns) {
@@ -93,6 +111,7 @@ namespace mongo {
             _opNum = _nextOpNum++;
             _ns[0] = '?'; // just in case not set later
             _debug.reset();
+            _arena.release();
             resetQuery();
             _remote = remote;
             _op = op;
@@ -107,14 +126,26 @@ namespace mongo {
 
         void waitingForLock(){
             _waitingForLock = true;
+            _lockWaitStart = curTimeMicros64();
         }
         void gotLock(){
+            if ( _waitingForLock && _lockWaitStart )
+                _lockWaitMicros += curTimeMicros64() - _lockWaitStart;
             _waitingForLock = false;
         }
+        unsigned long long lockWaitMicros() const {
+            return _lockWaitMicros;
+        }
 
         OpDebug& debug(){
             return _debug;
         }
+
+        /* scratch memory for this operation (e.g. BSONObjBuilder(Arena&)).  all of it is
+           released when the op is done(), so nothing built here may outlive the op. */
+        Arena& arena(){
+            return _arena;
+        }
         
         int profileLevel() const {
             return _dbprofile;
@@ -146,6 +177,7 @@ namespace mongo {
         void done() {
             _active = false;
             _end = curTimeMicros64();
+            _arena.release();
         }
         
         unsigned long long totalTimeMicros() {
@@ -166,6 +198,16 @@ namespace mongo {
             return elapsedMillis() / 1000;
         }
 
+        /* total 0 if there is no telling how far there is to go */
+        void setMessage(const char *msg, long long total = 0) {
+            strncpy(_message, msg, sizeof(_message) - 1);
+            _progressDone = 0;
+            _progressTotal = total;
+        }
+        void setProgress(long long done) {
+            _progressDone = done;
+        }
+
         void setQuery(const BSONObj& query) { 
             if( query.objsize() > (int) sizeof(_queryBuf) ) { 
                 resetQuery(1); // flag as too big and return
@@ -189,6 +231,7 @@ namespace mongo {
             // without the db mutex.
             memset(_ns, 0, sizeof(_ns));
             memset(_queryBuf, 0, sizeof(_queryBuf));
+            memset(_message, 0, sizeof(_message));
         }
         
         ~CurOp(){
@@ -32,9 +32,32 @@ namespace mongo {
             last = curr;
             curr = s->next( curr );
         }
+        if ( ok() && !( curr.a() == hinted_.a() && curr.getOfs() >= hinted_.getOfs() && curr.getOfs() < hintedEnd_ ) )
+            hintExtent();
         return ok();
     }
 
+    /* how much of the next extent a forward scan asks to have read in as it enters an extent */
+    const int PrefetchBytes = 4 * 1024 * 1024;
+
+    /* a forward table scan reads its extents start to end: ask for sequential readahead on the
+       extent it just entered and for the start of the next one to be read in now, and put the
+       extent it left back to the file's policy (random, usually -- see --readahead).  a scan
+       abandoned part way leaves its last extent hinted sequential until another scan passes by.
+    */
+    void BasicCursor::hintExtent() {
+        if ( tailable_ || s != forward() )
+            return;
+        if ( !hinted_.isNull() )
+            DataFileMgr::adviseExtent( hinted_, MemoryMappedFile::Default );
+        hinted_ = DiskLoc( curr.a(), curr.rec()->extentOfs );
+        Extent *e = hinted_.ext();
+        hintedEnd_ = hinted_.getOfs() + e->length;
+        DataFileMgr::adviseExtent( hinted_, MemoryMappedFile::Sequential );
+        if ( !e->xnext.isNull() )
+            DataFileMgr::adviseExtent( e->xnext, MemoryMappedFile::WillNeed, PrefetchBytes );
+    }
+
     /* these will be used outside of mutexes - really functors - thus the const */
     class Forward : public AdvanceStrategy {
         virtual DiskLoc next( const DiskLoc &prev ) const {
@@ -29,7 +29,7 @@ namespace mongo {
        concept and is for the user's cursor.
 
        WARNING concurrency: the vfunctions below are called back from within a 
-       ClientCursor::ccmutex.  Don't cause a deadlock, you've been warned.
+       ClientCursor partition mutex.  Don't cause a deadlock, you've been warned.
     */
     class Cursor {
     public:
@@ -115,9 +115,14 @@ namespace mongo {
 
     private:
         bool tailable_;
+        /* the extent we last gave readahead hints for, see hintExtent() */
+        DiskLoc hinted_;
+        int hintedEnd_;
         void init() {
             tailable_ = false;
+            hintedEnd_ = 0;
         }
+        void hintExtent();
     public:
         bool ok() {
             return !curr.isNull();
@@ -157,6 +162,8 @@ namespace mongo {
             return tailable_;
         }
         virtual bool getsetdup(DiskLoc loc) { return false; }
+        /* the extent a forward scan last hinted for readahead, null if none yet */
+        DiskLoc hintedExtent() const { return hinted_; }
     };
 
     /* used for order { $natural: -1 } */
@@ -60,6 +60,7 @@ namespace mongo {
     extern int lockFile;
     
     extern string repairpath;
+    extern int cloneConnections;
 
     void setupSignals();
     void closeAllSockets();
@@ -517,6 +518,8 @@ namespace mongo {
         srand((unsigned) (curTimeMicros() ^ startupSrandTimer.micros()));
 
         snapshotThread.go();
+        if ( ProfileRing::global.enabled() && profileRingFlusher._sleepsecs > 0 )
+            profileRingFlusher.go();
         listen(listenPort);
 
         // listen() will return when exit code closes its socket.
@@ -605,6 +608,9 @@ int main(int argc, char* argv[], char *envp[] )
         ("quiet", "quieter output")
         ("logpath", po::value<string>() , "file to send all output to instead of stdout" )
         ("logappend" , "appnd to logpath instead of over-writing" )
+        ("logqueue", po::value<int>(), "write log output from a background thread, queueing up to this many lines")
+        ("logqueuedrop", "with --logqueue, drop log lines rather than wait when the queue is full")
+        ("logcomponents", po::value<string>(), "per component verbosity, e.g. repl=2,query=1 (ops query repl index storage sharding)")
         ("repairpath", po::value<string>() , "root directory for repair files - defaults to dbpath" )
 #ifndef _WIN32
         ("fork" , "fork server process" )
@@ -622,6 +628,9 @@ int main(int argc, char* argv[], char *envp[] )
         ("noscripting", "disable scripting engine")
         ("noprealloc", "disable data file preallocation")
         ("smallfiles", "use a smaller default file size")
+        ("readahead", po::value<string>(), "data file readahead: random (default, scans ask for more as they go) or normal")
+        ("sizeClasses", "allocate records of new collections in power of 2 size classes, so free space is reused without searching")
+        ("wireCompression", "compress large messages on connections to other servers (replication, cloning, sharding)")
         ("nssize", po::value<int>()->default_value(16), ".ns file size (in MB) for new databases")
         ("diaglog", po::value<int>(), "0=off 1=W 2=R 3=both 7=W+some reads")
         ("sysinfo", "print some diagnostic system information")
@@ -631,6 +640,8 @@ int main(int argc, char* argv[], char *envp[] )
         ("syncdelay",po::value<double>(&dataFileSync._sleepsecs)->default_value(60), "seconds between disk syncs (0 for never)")
         ("profile",po::value<int>(), "0=off 1=slow, 2=all")
         ("slowms",po::value<int>(&cmdLine.slowMS)->default_value(100), "value of slow for profile and console log" )
+        ("profileRing",po::value<int>(), "keep profile records in an in memory ring of this many ops instead of system.profile")
+        ("profileRingFlush",po::value<int>(&profileRingFlusher._sleepsecs), "with --profileRing, copy records to system.profile every N seconds")
         ("maxConns",po::value<int>(), "max number of simultaneous connections")
 #if defined(_WIN32)
         ("install", "install mongodb service")
@@ -649,6 +660,7 @@ int main(int argc, char* argv[], char *envp[] )
         ("autoresync", "automatically resync if slave data is stale")
         ("oplogSize", po::value<long>(), "size limit (in MB) for op log")
         ("opIdMem", po::value<long>(), "size limit (in bytes) for in memory storage of op ids")
+        ("cloneConnections", po::value<int>(&cloneConnections)->default_value(4), "connections used to copy collections in parallel during initial sync and clone")
         ;
 
 	sharding_options.add_options()
@@ -810,6 +822,18 @@ int main(int argc, char* argv[], char *envp[] )
             uassert( 10033 ,  "logpath has to be non-zero" , lp.size() );
             initLogging( lp , params.count( "logappend" ) );
         }
+        if (params.count("logqueue")) {
+            int n = params["logqueue"].as<int>();
+            uassert( 13003 , "logqueue has to be > 0" , n > 0 );
+            startAsyncLogging( n , params.count( "logqueuedrop" ) ? LogQueueDrop : LogQueueBlock );
+        }
+        if (params.count("logcomponents")) {
+            string errmsg;
+            if ( ! setComponentLogLevels( params["logcomponents"].as<string>() , errmsg ) ) {
+                cout << errmsg << endl;
+                return -1;
+            }
+        }
         if (params.count("repairpath")) {
             repairpath = params["repairpath"].as<string>();
             uassert( 12589, "repairpath has to be non-zero", repairpath.size() );
@@ -834,6 +858,21 @@ int main(int argc, char* argv[], char *envp[] )
         if (params.count("smallfiles")) {
             cmdLine.smallfiles = true;
         }
+        if (params.count("wireCompression")) {
+            cmdLine.wireCompression = true;
+        }
+        if (params.count("sizeClasses")) {
+            cmdLine.sizeClasses = true;
+        }
+        if (params.count("readahead")) {
+            string r = params["readahead"].as<string>();
+            if ( r == "normal" )
+                cmdLine.randomReadahead = false;
+            else if ( r != "random" ) {
+                out() << "--readahead must be random or normal" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+        }
         if (params.count("diaglog")) {
             int x = params["diaglog"].as<int>();
             if ( x < 0 || x > 7 ) {
@@ -928,6 +967,11 @@ int main(int argc, char* argv[], char *envp[] )
         if ( params.count( "profile" ) ){
             cmdLine.defaultProfile = params["profile"].as<int>();
         }
+        if ( params.count( "profileRing" ) ){
+            int n = params["profileRing"].as<int>();
+            uassert( 13004 , "profileRing has to be > 0" , n > 0 );
+            ProfileRing::global.init( n , profileRingFlusher._sleepsecs > 0 );
+        }
         if ( params.count( "maxConns" ) ){
             int newSize = params["maxConns"].as<int>();
             uassert( 12507 , "maxConns has to be at least 5" , newSize >= 5 );
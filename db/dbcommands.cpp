@@ -38,6 +38,7 @@
 #include "../scripting/engine.h"
 #include "stats/counters.h"
 #include "background.h"
+#include "reccache.h"
 
 namespace mongo {
 
@@ -361,12 +362,26 @@ namespace mongo {
                 bb.done();
             }
 
+            if ( authed ){
+                BSONObjBuilder bb( result.subobjStart( "mappedFiles" ) );
+                MemoryMappedFile::appendStats( bb );
+                bb.done();
+            }
+
 
             {
                 BSONObjBuilder bb( result.subobjStart( "indexCounters" ) );
                 globalIndexCounters.append( bb );
                 bb.done();
             }
+
+#if defined(_RECSTORE)
+            {
+                BSONObjBuilder bb( result.subobjStart( "recCache" ) );
+                theRecCache.appendStats( bb );
+                bb.done();
+            }
+#endif
             
             if ( anyReplEnabled() ){
                 BSONObjBuilder bb( result.subobjStart( "repl" ) );
@@ -375,6 +390,20 @@ namespace mongo {
             }
             
             result.append( "opcounters" , globalOpCounters.getObj() );
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "wireCompression" ) );
+                appendWireCompressionStats( bb );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb;
+                appendAsyncLogStats( bb );
+                BSONObj o = bb.obj();
+                if ( ! o.isEmpty() )
+                    result.append( "asyncLog" , o );
+            }
             
             if ( ! authed )
                 result.append( "note" , "run against admin for more info" );
@@ -901,6 +930,23 @@ namespace mongo {
                 return false;
 
             Timer t;
+            BtreeBucket *head = id->head.btree();
+            if ( head->isCounted() ) {
+                // rank of the first key >= min and the first >= max, then one more descent
+                BSONObj order = id->keyPattern();
+                Ordering ordering = Ordering::make( order );
+                long long lo = head->keysBefore( *id, id->head, min, ordering, minDiskLoc );
+                long long hi = head->keysBefore( *id, id->head, max, ordering, minDiskLoc );
+                int pos;
+                DiskLoc b = hi > lo ? head->keyAtRank( id->head, lo + ( hi - lo ) / 2, pos ) : DiskLoc();
+                if ( b.isNull() ) {
+                    errmsg = "no index entries in the specified range";
+                    return false;
+                }
+                result.append( "median", b.btree()->keyAt( pos ).replaceFieldNames( order ).clientReadable() );
+                return true;
+            }
+
             int num = 0;
             NamespaceDetails *d = nsdetails(ns);
             int idxNo = d->idxNo(*id);
@@ -1332,6 +1378,33 @@ namespace mongo {
             help << "{ distinct : 'collection name' , key : 'a.b' }";
         }
 
+        /* an index can answer distinct without touching documents when its leading field is the
+           distinct key.  multikey indexes are skipped: they hold array elements, whereas distinct
+           reports whole values.
+           @return index # in d, or -1
+        */
+        static int indexForKey( NamespaceDetails *d , const string& key ){
+            NamespaceDetails::IndexIterator i = d->ii();
+            while ( i.more() ){
+                IndexDetails& id = i.next();
+                int idxNo = i.pos() - 1;
+                if ( key == id.keyPattern().firstElement().fieldName() && ! d->isMultikey( idxNo ) )
+                    return idxNo;
+            }
+            return -1;
+        }
+
+        /* the index stores a missing field as null, so for a null key make sure at least one
+           document really has the field before reporting it. */
+        static bool nullIsReal( BtreeCursor& c , const BSONObj& keyPattern ){
+            BSONObj first = c.currKey();
+            for ( ; c.ok() && c.currKey().woEqual( first ); c.advance() ){
+                if ( ! c.current().extractFields( keyPattern ).isEmpty() )
+                    return true;
+            }
+            return false;
+        }
+
         bool run(const char *dbname, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool fromRepl ){
             static DBDirectClient db;
 
@@ -1339,32 +1412,69 @@ namespace mongo {
             string key = cmdObj["key"].valuestrsafe();
 
             BSONObj keyPattern = BSON( key << 1 );
+            BSONObj query = getQuery( cmdObj );
 
-            set<BSONObj,BSONObjCmp> map;
-
+            /* values are streamed straight into the reply; the only cap left is the size of the
+               reply object itself. */
+            BSONObjBuilder b( result.subarrayStart( "values" ) );
+            int n = 0;
             long long size = 0;
 
-            auto_ptr<DBClientCursor> cursor = db.query( ns , getQuery( cmdObj ) , 0 , 0 , &keyPattern );
-            while ( cursor->more() ){
-                BSONObj o = cursor->next();
-                BSONObj value = o.extractFields( keyPattern );
-                if ( value.isEmpty() )
-                    continue;
-                if ( map.insert( value ).second ){
-                    size += o.objsize() + 20;
+            NamespaceDetails *d = nsdetails( ns.c_str() );
+            int idxNo = ( d && query.isEmpty() ) ? indexForKey( d , key ) : -1;
+
+            if ( idxNo >= 0 ){
+                // skip scan: one locate() per distinct value, documents are never read (except for nulls)
+                IndexDetails& id = d->idx( idxNo );
+                BSONObj idxKey = id.keyPattern();
+                int direction = idxKey.firstElement().number() < 0 ? -1 : 1;
+
+                BSONObjBuilder startKey;
+                BSONObjIterator i( idxKey );
+                while ( i.more() ){
+                    BSONElement e = i.next();
+                    if ( e.eoo() )
+                        break;
+                    int fieldDirection = e.number() < 0 ? -1 : 1;
+                    if ( fieldDirection == direction )
+                        startKey.appendMinKey( "" );
+                    else
+                        startKey.appendMaxKey( "" );
+                }
+
+                BtreeCursor c( d , idxNo , id , startKey.obj() , BSONObj() , true , direction );
+                while ( c.ok() ){
+                    BSONObj k = c.currKey();
+                    BSONElement value = k.firstElement();
+                    if ( value.isNull() && ! nullIsReal( c , keyPattern ) )
+                        continue;
+                    size += value.size();
                     uassert( 10044 ,  "distinct too big, 4mb cap" , size < 4 * 1024 * 1024 );
+                    b.appendAs( value , b.numStr( n++ ).c_str() );
+                    c.skipPastLeadingField();
                 }
             }
+            else {
+                set<BSONObj,BSONObjCmp> map;
+
+                auto_ptr<DBClientCursor> cursor = db.query( ns , query , 0 , 0 , &keyPattern );
+                while ( cursor->more() ){
+                    BSONObj o = cursor->next();
+                    BSONObj value = o.extractFields( keyPattern );
+                    if ( value.isEmpty() )
+                        continue;
+                    if ( map.insert( value ).second ){
+                        size += value.objsize();
+                        uassert( 13017 ,  "distinct too big, 4mb cap" , size < 4 * 1024 * 1024 );
+                    }
+                }
 
-            assert( size <= 0x7fffffff );
-            BSONObjBuilder b( (int) size );
-            int n=0;
-            for ( set<BSONObj,BSONObjCmp>::iterator i = map.begin() ; i != map.end(); i++ ){
-                b.appendAs( i->firstElement() , b.numStr( n++ ).c_str() );
+                for ( set<BSONObj,BSONObjCmp>::iterator i = map.begin() ; i != map.end(); i++ ){
+                    b.appendAs( i->firstElement() , b.numStr( n++ ).c_str() );
+                }
             }
 
-            result.appendArray( "values" , b.obj() );
-
+            b.done();
             return true;
         }
 
@@ -30,6 +30,7 @@
 #include "cmdline.h"
 #include "btree.h"
 #include "curop.h"
+#include "indexstats.h"
 #include "../util/background.h"
 #include "../scripting/engine.h"
 
@@ -81,7 +82,88 @@ namespace mongo {
         }
         
     } cleanCmd;
-    
+
+    /* { compact: "collectionnamewithoutthedbpart" [, batch: <records moved between yields>] }
+       reclaims the space of a fragmented collection without taking it offline.  records are moved
+       out of the tail extents into free space further forward, and the emptied extents go back to
+       the database for reuse.  the data files themselves do not shrink; use repairDatabase for that.
+    */
+    class CompactCmd : public Command {
+    public:
+        CompactCmd() : Command( "compact" ){}
+
+        virtual bool slaveOk(){ return true; }
+        virtual void help( stringstream& help ) const {
+            help << "move records out of a collection's tail extents and free them.\n"
+                "{ compact : \"collection\" [, batch : 1000] }";
+        }
+
+        bool run(const char *nsRaw, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool fromRepl ){
+            string ns = cc().database()->name + "." + cmdObj.firstElement().valuestrsafe();
+            if ( !cmdLine.quiet )
+                log() << "CMD: compact " << ns << endl;
+
+            result.append( "ns", ns );
+            return compactCollection( ns.c_str(), cmdObj["batch"].numberInt(), errmsg, result );
+        }
+        
+    } compactCmd;
+
+    /* { analyze: "collectionnamewithoutthedbpart" [, buckets: <histogram buckets per index>] }
+       walks each index of the collection, yielding as it goes, and saves key counts, prefix
+       cardinalities and a histogram to <db>.system.indexstats for the query optimizer.  run it
+       again after the data changes shape; the stats are not maintained by writes.
+    */
+    class AnalyzeCmd : public Command {
+    public:
+        AnalyzeCmd() : Command( "analyze" ){}
+
+        virtual bool slaveOk(){ return true; }
+        virtual void help( stringstream& help ) const {
+            help << "gather index statistics for the query optimizer.\n"
+                "{ analyze : \"collection\" [, buckets : 32] }";
+        }
+
+        bool run(const char *nsRaw, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool fromRepl ){
+            string ns = cc().database()->name + "." + cmdObj.firstElement().valuestrsafe();
+            if ( !cmdLine.quiet )
+                log() << "CMD: analyze " << ns << endl;
+
+            result.append( "ns", ns );
+            return analyzeCollection( ns.c_str(), cmdObj["buckets"].numberInt(), errmsg, result );
+        }
+
+    } analyzeCmd;
+
+    /* { touch: "collectionnamewithoutthedbpart" [, data: true] [, index: true | false | [ names ]] [, threads: 4] }
+       reads a collection's extents and its indexes' into the file cache, so a node that was just
+       restarted or failed over to doesn't serve cold while its working set faults in a page at a
+       time.  the reads happen with the db lock released; see currentOp for progress.
+    */
+    class TouchCmd : public Command {
+    public:
+        TouchCmd() : Command( "touch" ){}
+
+        virtual bool slaveOk(){ return true; }
+        virtual bool readOnly(){ return true; }
+        virtual void help( stringstream& help ) const {
+            help << "load a collection and its indexes into memory.\n"
+                "{ touch : \"collection\" [, data : true] [, index : true | false | [ \"name\", ... ]] [, threads : 4] }";
+        }
+
+        bool run(const char *nsRaw, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool fromRepl ){
+            string ns = cc().database()->name + "." + cmdObj.firstElement().valuestrsafe();
+            if ( !cmdLine.quiet )
+                log() << "CMD: touch " << ns << endl;
+
+            BSONElement data = cmdObj["data"];
+            result.append( "ns", ns );
+            return touchCollection( ns.c_str(), data.eoo() || data.trueValue(), cmdObj["index"],
+                                    cmdObj["threads"].numberInt(), errmsg, result );
+        }
+
+    } touchCmd;
+
     class ValidateCmd : public Command {
     public:
         ValidateCmd() : Command( "validate" ){}
@@ -249,7 +331,7 @@ namespace mongo {
                     while( i.more() ) {
                         IndexDetails& id = i.next();
                         ss << "    " << id.indexNamespace() << " keys:" <<
-                            id.head.btree()->fullValidate(id.head, id.keyPattern()) << endl;
+                            id.head.btree()->fullValidate(id.head, Ordering::make(id.keyPattern())) << endl;
                     }
                 }
                 catch (...) {
@@ -48,7 +48,7 @@ namespace mongo {
 
         class MyCmp {
         public:
-            MyCmp( const BSONObj & order = BSONObj() ) : _order( order ){}
+            MyCmp( const BSONObj & order = BSONObj() ) : _order( Ordering::make( order ) ){}
             bool operator()( const Data &l, const Data &r ) const {
                 RARELY killCurrentOp.checkForInterrupt();
                 _compares++;
@@ -58,7 +58,7 @@ namespace mongo {
                 return l.second.compare( r.second ) < 0;
             };
         private:
-            BSONObj _order;
+            Ordering _order;
         };
         
     public:
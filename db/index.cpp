@@ -82,6 +82,7 @@ namespace mongo {
 
     void IndexSpec::_init(){
         assert( keyPattern.objsize() );
+        ordering = Ordering::make( keyPattern );
         
         BSONObjIterator i( keyPattern );
         BSONObjBuilder nullKeyB;
@@ -190,7 +191,11 @@ namespace mongo {
        Keys will be left empty if key not found in the object.
     */
     void IndexDetails::getKeysFromObject( const BSONObj& obj, BSONObjSetDefaultOrder& keys) const {
-        NamespaceDetailsTransient::get_w( info.obj()["ns"].valuestr() ).getIndexSpec( this ).getKeys( obj, keys );
+        getSpec().getKeys( obj, keys );
+    }
+
+    const IndexSpec& IndexDetails::getSpec() const {
+        return NamespaceDetailsTransient::get_w( info.obj()["ns"].valuestr() ).getIndexSpec( this );
     }
 
     void setDifference(BSONObjSetDefaultOrder &l, BSONObjSetDefaultOrder &r, vector<BSONObj*> &diff) {
@@ -209,14 +214,19 @@ namespace mongo {
         }
     }
 
-    void getIndexChanges(vector<IndexChanges>& v, NamespaceDetails& d, BSONObj newObj, BSONObj oldObj) { 
+    void getIndexChanges(vector<IndexChanges>& v, NamespaceDetails& d, BSONObj newObj, BSONObj oldObj,
+                         unsigned long long keysMayChange, bool moving) { 
         int z = d.nIndexesBeingBuilt();
         v.resize(z);
-        NamespaceDetails::IndexIterator i = d.ii();
         for( int i = 0; i < z; i++ ) {
             IndexDetails& idx = d.idx(i);
-            BSONObj idxKey = idx.info.obj().getObjectField("key"); // eg { ts : 1 }
             IndexChanges& ch = v[i];
+            if( !( keysMayChange & (((unsigned long long) 1) << i) ) ) {
+                // same keys before and after; a move still needs them to repoint the entries
+                if( moving )
+                    idx.getKeysFromObject(oldObj, ch.oldkeys);
+                continue;
+            }
             idx.getKeysFromObject(oldObj, ch.oldkeys);
             idx.getKeysFromObject(newObj, ch.newkeys);
             if( ch.newkeys.size() > 1 ) 
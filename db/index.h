@@ -29,6 +29,7 @@ namespace mongo {
     public:
         BSONObj keyPattern; // e.g., { name : 1 }
         BSONObj info; // this is the same as IndexDetails::info.obj()
+        Ordering ordering; // directions of keyPattern, for comparing keys
         
         IndexSpec(){
         }
@@ -109,6 +110,9 @@ namespace mongo {
         */
         void getKeysFromObject( const BSONObj& obj, BSONObjSetDefaultOrder& keys) const;
 
+        /* the cached IndexSpec for this index.  must hold the write lock. */
+        const IndexSpec& getSpec() const;
+
         /* get the key pattern for this object.
            e.g., { lastname:1, firstname:1 }
         */
@@ -181,8 +185,8 @@ namespace mongo {
     };
 
     struct IndexChanges/*on an update*/ {
-        BSONObjSetDefaultOrder oldkeys;
-        BSONObjSetDefaultOrder newkeys;
+        BSONObjSetDefaultOrder oldkeys; // empty if the update can't change this index's keys and doesn't move
+        BSONObjSetDefaultOrder newkeys; // empty if the update can't change this index's keys
         vector<BSONObj*> removed; // these keys were removed as part of the change
         vector<BSONObj*> added;   // these keys were added as part of the change
 
@@ -200,6 +204,10 @@ namespace mongo {
     };
 
     class NamespaceDetails;
-    void getIndexChanges(vector<IndexChanges>& v, NamespaceDetails& d, BSONObj newObj, BSONObj oldObj);
+    /* keysMayChange - bit i is set if the update may change index i's keys.  keys aren't generated
+                        for the other indexes, except for oldkeys when the record is moving.
+    */
+    void getIndexChanges(vector<IndexChanges>& v, NamespaceDetails& d, BSONObj newObj, BSONObj oldObj,
+                         unsigned long long keysMayChange = ~0ULL, bool moving = false);
     void dupCheck(vector<IndexChanges>& v, NamespaceDetails& d, DiskLoc curObjLoc);
 } // namespace mongo
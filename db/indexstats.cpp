@@ -0,0 +1,331 @@
+// indexstats.cpp
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stdafx.h"
+#include "indexstats.h"
+#include "pdfile.h"
+#include "btree.h"
+#include "query.h"
+#include "queryoptimizer.h"
+#include "clientcursor.h"
+#include "background.h"
+#include "curop.h"
+
+namespace mongo {
+
+    const int DefaultHistogramBuckets = 32;
+    const int MaxHistogramBuckets = 256;
+
+    static string indexStatsNs( const char *ns ) {
+        return nsToDatabase( ns ) + ".system.indexstats";
+    }
+
+    BSONObj IndexStats::toBSON() const {
+        BSONObjBuilder b;
+        b.append( "name", name );
+        b.append( "key", keyPattern );
+        b.append( "keys", keys );
+        b.append( "distinct", distinct );
+        b.append( "bounds", bounds );
+        b.append( "cumulative", cumulative );
+        b.appendDate( "analyzed", analyzed );
+        return b.obj();
+    }
+
+    BSONObj IndexStats::summary() const {
+        BSONObjBuilder b;
+        b.append( "name", name );
+        b.append( "keys", keys );
+        b.append( "distinct", distinct );
+        b.append( "buckets", (int) bounds.size() );
+        b.appendDate( "analyzed", analyzed );
+        return b.obj();
+    }
+
+    bool IndexStats::fromBSON( const BSONObj &o, IndexStats &s ) {
+        BSONElement name = o["name"];
+        BSONElement key = o["key"];
+        if ( name.type() != String || key.type() != Object || !o["keys"].isNumber() ||
+             o["distinct"].type() != Array || o["bounds"].type() != Array || o["cumulative"].type() != Array )
+            return false;
+        s.name = name.valuestr();
+        s.keyPattern = key.embeddedObject().getOwned();
+        s.keys = o["keys"].numberLong();
+        s.analyzed = o["analyzed"].date();
+        s.distinct.clear();
+        s.bounds.clear();
+        s.cumulative.clear();
+        BSONObjIterator d( o["distinct"].embeddedObject() );
+        while ( d.more() )
+            s.distinct.push_back( d.next().numberLong() );
+        BSONObjIterator b( o["bounds"].embeddedObject() );
+        while ( b.more() ) {
+            BSONElement e = b.next();
+            if ( e.type() != Object )
+                return false;
+            s.bounds.push_back( e.embeddedObject().getOwned() );
+        }
+        BSONObjIterator c( o["cumulative"].embeddedObject() );
+        while ( c.more() )
+            s.cumulative.push_back( c.next().numberLong() );
+        return s.bounds.size() == s.cumulative.size() &&
+            (int) s.distinct.size() == s.keyPattern.nFields();
+    }
+
+    int IndexStats::bucketFor( const BSONObj &k, const Ordering &o ) const {
+        int l = 0;
+        int h = (int) bounds.size();
+        while ( l < h ) {
+            int m = ( l + h ) / 2;
+            if ( bounds[ m ].woCompare( k, o, false ) < 0 )
+                l = m + 1;
+            else
+                h = m;
+        }
+        return l;
+    }
+
+    long long IndexStats::bucketSize( int i ) const {
+        if ( i >= (int) cumulative.size() )
+            return 0;
+        return cumulative[ i ] - ( i ? cumulative[ i - 1 ] : 0 );
+    }
+
+    long long IndexStats::estimateKeys( const BoundList &bl, int nEqualityFields ) const {
+        if ( keys == 0 )
+            return 0;
+        Ordering o = Ordering::make( keyPattern );
+        /* keys per value of the equality prefix.  only trusted while the value's range falls in
+           one histogram bucket -- a value frequent enough to span buckets is counted from the
+           histogram instead of being averaged away.
+        */
+        long long perValue = -1;
+        if ( nEqualityFields > 0 && !distinct.empty() ) {
+            int f = min( nEqualityFields, (int) distinct.size() ) - 1;
+            perValue = keys / ( distinct[ f ] > 0 ? distinct[ f ] : 1 );
+        }
+        long long n = 0;
+        for( BoundList::const_iterator i = bl.begin(); i != bl.end(); ++i ) {
+            BSONObj start = i->first;
+            BSONObj end = i->second;
+            if ( start.woCompare( end, o, false ) > 0 )
+                swap( start, end ); // reverse scan
+            int a = bucketFor( start, o );
+            int b = bucketFor( end, o );
+            if ( a == b ) {
+                long long inBucket = bucketSize( a );
+                n += perValue >= 0 ? min( perValue, inBucket ) : inBucket / 2;
+            }
+            else {
+                n += cumulative[ b - 1 ] - cumulative[ a ] + bucketSize( a ) / 2 + bucketSize( b ) / 2;
+            }
+        }
+        return n;
+    }
+
+    IndexStatsBuilder::IndexStatsBuilder( const string &name, const BSONObj &keyPattern, int nBuckets ) :
+        _nBuckets( nBuckets ), _step( 1 ), _inBucket( 0 ) {
+        _s.name = name;
+        _s.keyPattern = keyPattern.getOwned();
+        _s.distinct.resize( keyPattern.nFields(), 0 );
+    }
+
+    /* btree keys have empty field names; give the stored bounds the key pattern's */
+    BSONObj IndexStatsBuilder::relabel( const BSONObj &key ) const {
+        BSONObjBuilder b;
+        BSONObjIterator p( _s.keyPattern );
+        BSONObjIterator k( key );
+        while ( p.more() && k.more() )
+            b.appendAs( k.next(), p.next().fieldName() );
+        return b.obj();
+    }
+
+    void IndexStatsBuilder::add( const BSONObj &key ) {
+        _s.keys++;
+
+        /* the first field that differs from the previous key starts a new value of that
+           prefix and of every longer one */
+        int f = 0;
+        if ( !_last.isEmpty() ) {
+            BSONObjIterator a( key );
+            BSONObjIterator b( _last );
+            while ( a.more() && b.more() && a.next().woCompare( b.next(), false ) == 0 )
+                f++;
+        }
+        for( int i = f; i < (int) _s.distinct.size(); i++ )
+            _s.distinct[ i ]++;
+        _last = key.getOwned();
+
+        if ( ++_inBucket < _step )
+            return;
+        _s.bounds.push_back( relabel( key ) );
+        _s.cumulative.push_back( _s.keys );
+        _inBucket = 0;
+        if ( (int) _s.bounds.size() < 2 * _nBuckets )
+            return;
+        /* full: merge neighbouring buckets and make the rest twice as deep */
+        for( unsigned i = 1; i < _s.bounds.size(); i += 2 ) {
+            _s.bounds[ i / 2 ] = _s.bounds[ i ];
+            _s.cumulative[ i / 2 ] = _s.cumulative[ i ];
+        }
+        _s.bounds.resize( _s.bounds.size() / 2 );
+        _s.cumulative.resize( _s.cumulative.size() / 2 );
+        _step *= 2;
+    }
+
+    void IndexStatsBuilder::finish( IndexStats &s ) {
+        if ( _inBucket > 0 ) {
+            _s.bounds.push_back( relabel( _last ) );
+            _s.cumulative.push_back( _s.keys );
+            _inBucket = 0;
+        }
+        _s.analyzed = jsTime();
+        s = _s;
+    }
+
+    static void readIndexStats( const char *ns, IndexStatsMap &stats ) {
+        NamespaceDetails *d = nsdetails( ns );
+        string statsNs = indexStatsNs( ns );
+        if ( !d || !nsdetails( statsNs.c_str() ) )
+            return;
+        for( auto_ptr< Cursor > c = theDataFileMgr.findAll( statsNs.c_str() ); c->ok(); c->advance() ) {
+            BSONObj o = c->current();
+            BSONElement id = o["_id"];
+            if ( id.type() != String || strcmp( id.valuestr(), ns ) != 0 || o["indexes"].type() != Array )
+                continue;
+            BSONObjIterator i( o["indexes"].embeddedObject() );
+            while ( i.more() ) {
+                BSONElement e = i.next();
+                shared_ptr< IndexStats > s( new IndexStats() );
+                if ( e.type() != Object || !IndexStats::fromBSON( e.embeddedObject(), *s ) )
+                    continue;
+                NamespaceDetails::IndexIterator ii = d->ii();
+                while( ii.more() ) {
+                    IndexDetails &id = ii.next();
+                    if ( id.indexName() == s->name && id.keyPattern().woCompare( s->keyPattern ) == 0 ) {
+                        stats[ s->name ] = s;
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    void getIndexStats( const char *ns, IndexStatsMap &stats ) {
+        {
+            boostlock lk( NamespaceDetailsTransient::_qcMutex );
+            NamespaceDetailsTransient &t = NamespaceDetailsTransient::get_inlock( ns );
+            if ( t.indexStatsLoaded() ) {
+                stats = t.indexStats();
+                return;
+            }
+        }
+        /* not under _qcMutex: this is a query of its own.  two readers may both load, that's fine. */
+        IndexStatsMap m;
+        readIndexStats( ns, m );
+        boostlock lk( NamespaceDetailsTransient::_qcMutex );
+        NamespaceDetailsTransient::get_inlock( ns ).setIndexStats( m );
+        stats = m;
+    }
+
+    bool analyzeCollection( const char *ns, int nBuckets, string &errmsg, BSONObjBuilder &result ) {
+        NamespaceDetails *d = nsdetails( ns );
+        if ( !d ) {
+            errmsg = "ns not found";
+            return false;
+        }
+        if ( NamespaceString( ns ).isSystem() ) {
+            errmsg = "can't analyze a system collection";
+            return false;
+        }
+        if ( nBuckets <= 0 )
+            nBuckets = DefaultHistogramBuckets;
+        if ( nBuckets > MaxHistogramBuckets )
+            nBuckets = MaxHistogramBuckets;
+
+        /* keeps index drops and builds off this collection while we yield */
+        BackgroundOperation::assertNoBgOpInProgForNs( ns );
+        BackgroundOperation op( ns );
+
+        Timer t;
+        vector< BSONObj > indexes;
+        vector< BSONObj > summary;
+        IndexStatsMap m;
+        int nIndexes = d->nIndexes;
+        for( int i = 0; i < nIndexes; i++ ) {
+            d = nsdetails( ns );
+            IndexDetails &id = d->idx( i );
+            BSONObj keyPattern = id.keyPattern().getOwned();
+            IndexStatsBuilder b( id.indexName(), keyPattern, nBuckets );
+
+            auto_ptr< ClientCursor > cc;
+            {
+                auto_ptr< Cursor > c( new BtreeCursor( d, i, id, extremeKeyForIndex( keyPattern, -1 ), extremeKeyForIndex( keyPattern, 1 ), true, 1 ) );
+                cc.reset( new ClientCursor( c, ns, false ) );
+            }
+            long long n = 0;
+            while ( cc->c->ok() ) {
+                b.add( cc->c->currKey() );
+                cc->c->advance();
+                if ( ++n % 128 == 0 ) {
+                    if ( !cc->yield() ) {
+                        cc.release();
+                        uasserted( 13013, "cursor gone during analyze" );
+                    }
+                    killCurrentOp.checkForInterrupt();
+                }
+            }
+
+            shared_ptr< IndexStats > s( new IndexStats() );
+            b.finish( *s );
+            m[ s->name ] = s;
+            indexes.push_back( s->toBSON() );
+            summary.push_back( s->summary() );
+        }
+
+        string statsNs = indexStatsNs( ns );
+        deleteObjects( statsNs.c_str(), BSON( "_id" << ns ), true, false, true );
+        BSONObjBuilder b;
+        b.append( "_id", ns );
+        b.append( "indexes", indexes );
+        BSONObj o = b.done();
+        theDataFileMgr.insert( statsNs.c_str(), o.objdata(), o.objsize(), true );
+
+        {
+            boostlock lk( NamespaceDetailsTransient::_qcMutex );
+            NamespaceDetailsTransient &nsd = NamespaceDetailsTransient::get_inlock( ns );
+            nsd.setIndexStats( m );
+            /* recorded plans were picked without the stats */
+            nsd.clearQueryCache();
+        }
+
+        log() << "analyze " << ns << " " << nIndexes << " indexes in " << t.millis() << "ms" << endl;
+        result.append( "indexes", summary );
+        result.append( "millis", t.millis() );
+        return true;
+    }
+
+    void dropIndexStats( const char *ns ) {
+        string statsNs = indexStatsNs( ns );
+        if ( NamespaceString( ns ).isSystem() || !nsdetails( statsNs.c_str() ) )
+            return;
+        deleteObjects( statsNs.c_str(), BSON( "_id" << ns ), true, false, true );
+    }
+
+} // namespace mongo
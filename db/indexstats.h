@@ -0,0 +1,102 @@
+// indexstats.h
+
+/**
+*    Copyright (C) 2008 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* index statistics for the query optimizer.
+
+   the analyze command walks every btree of a collection and records, per index, the number of
+   keys, the number of distinct values of each key prefix and an equi-depth histogram of the
+   keys.  they are kept in <db>.system.indexstats, one document per collection:
+
+     { _id : <ns>, indexes : [ { name, key, keys, distinct : [...], bounds : [...],
+                                 cumulative : [...], analyzed } ] }
+
+   and cached in NamespaceDetailsTransient.  QueryPlanSet uses them to estimate how many keys
+   each candidate plan will scan, and drops the hopeless ones before racing the rest.
+   the numbers are a snapshot as of the last analyze; they are estimates, not constraints.
+*/
+
+#pragma once
+
+#include "jsobj.h"
+#include "queryutil.h"
+
+namespace mongo {
+
+    class IndexStats {
+    public:
+        IndexStats() : keys(0) {}
+
+        string name;
+        BSONObj keyPattern;
+        long long keys;
+        /* distinct[ i ] is the number of distinct values of the first i + 1 key fields */
+        vector< long long > distinct;
+        /* equi-depth histogram in index order: bounds[ i ] is the last key of bucket i and
+           cumulative[ i ] the number of keys in buckets 0 through i */
+        vector< BSONObj > bounds;
+        vector< long long > cumulative;
+        Date_t analyzed;
+
+        BSONObj toBSON() const;
+        /* the counts without the histogram, for explain and the analyze command's reply */
+        BSONObj summary() const;
+        /* false if o is not a well formed stats entry */
+        static bool fromBSON( const BSONObj &o, IndexStats &s );
+
+        /* estimated number of keys scanned over bounds (as from FieldRangeSet::indexBounds), when
+           the first nEqualityFields key fields are constrained to a single value.
+        */
+        long long estimateKeys( const BoundList &bounds, int nEqualityFields ) const;
+
+    private:
+        /* bucket holding key k in index order, or bounds.size() if past the last key */
+        int bucketFor( const BSONObj &k, const Ordering &o ) const;
+        long long bucketSize( int i ) const;
+    };
+
+    /* collects IndexStats from keys fed in index order */
+    class IndexStatsBuilder {
+    public:
+        /* keeps between nBuckets and 2 * nBuckets histogram buckets */
+        IndexStatsBuilder( const string &name, const BSONObj &keyPattern, int nBuckets );
+        void add( const BSONObj &key );
+        void finish( IndexStats &s );
+    private:
+        BSONObj relabel( const BSONObj &key ) const;
+        IndexStats _s;
+        int _nBuckets;
+        long long _step;
+        long long _inBucket;
+        BSONObj _last;
+    };
+
+    typedef map< string, shared_ptr< IndexStats > > IndexStatsMap; // by index name
+
+    /* the stats of ns's indexes, from the NamespaceDetailsTransient cache, read from
+       system.indexstats the first time.  entries whose key pattern no longer matches the
+       index of that name are left out.
+    */
+    void getIndexStats( const char *ns, IndexStatsMap &stats );
+
+    /* walks the indexes of ns, yielding as it goes, and saves their stats.  nBuckets <= 0 for the default. */
+    bool analyzeCollection( const char *ns, int nBuckets, string &errmsg, BSONObjBuilder &result );
+
+    /* forget the stats of ns, when it is dropped or renamed. */
+    void dropIndexStats( const char *ns );
+
+} // namespace mongo
@@ -278,7 +278,7 @@ namespace mongo {
         ss << opToString( op ) << " ";
 
         int logThreshold = cmdLine.slowMS;
-        bool log = logLevel >= 1;
+        bool log = logLevelFor( LogOps ) >= 1;
         
         if ( op == dbQuery ) {
             if ( ! receivedQuery(c , dbresponse, m ) )
@@ -351,7 +351,7 @@ namespace mongo {
         currentOp.done();
         int ms = currentOp.totalTimeMillis();
         
-        log = log || (logLevel >= 2 && ++ctr % 512 == 0);
+        log = log || (logLevelFor( LogOps ) >= 2 && ++ctr % 512 == 0);
         DEV log = true;
         if ( log || ms > logThreshold ) {
             ss << ' ' << ms << "ms";
@@ -360,7 +360,11 @@ namespace mongo {
         
         if ( currentOp.shouldDBProfile( ms ) ){
             // performance profiling is on
-            if ( dbMutex.getState() < 0 ){
+            if ( ProfileRing::global.enabled() ){
+                // --profileRing: no db lock needed
+                ProfileRing::global.record( currentOp , ss.str() , ms );
+            }
+            else if ( dbMutex.getState() < 0 ){
                 mongo::log(1) << "warning: not profiling because recursive read lock" << endl;
             }
             else {
@@ -643,6 +647,7 @@ namespace mongo {
             tryToOutputFatal( "shutdown failed with exception" );
         }
         
+        flushAsyncLog();
         tryToOutputFatal( "dbexit: really exiting now\n" );
         ::exit(rc);
     }
@@ -23,6 +23,8 @@
 #include "pdfile.h"
 #include "jsobj.h"
 #include "pdfile.h"
+#include "curop.h"
+#include "commands.h"
 
 namespace mongo {
 
@@ -37,4 +39,174 @@ namespace mongo {
                               p.objdata(), p.objsize(), true);
     }
 
+    ProfileRing ProfileRing::global;
+    ProfileRingFlusher profileRingFlusher;
+
+    BSONObj ProfileRing::Record::toBSON() const {
+        BSONObjBuilder b;
+        b.appendDate("ts", ts);
+        b.append("op", opToString(op));
+        b.append("ns", ns);
+        b.append("millis", (double) millis);
+        b.append("lockWaitMicros", lockWaitMicros);
+        if ( nscanned >= 0 )
+            b.append("nscanned", nscanned);
+        if ( ! plan.empty() )
+            b.append("plan", plan);
+        b.append("info", info);
+        return b.obj();
+    }
+
+    void ProfileRing::Record::swap(Record& other) {
+        std::swap( ts, other.ts );
+        std::swap( op, other.op );
+        ns.swap( other.ns );
+        std::swap( millis, other.millis );
+        std::swap( lockWaitMicros, other.lockWaitMicros );
+        std::swap( nscanned, other.nscanned );
+        plan.swap( other.plan );
+        info.swap( other.info );
+    }
+
+    void ProfileRing::init(unsigned size, bool flushing) {
+        boostlock lk(_m);
+        _recs.clear();
+        _recs.resize( size );
+        _size = size;
+        _flushing = flushing;
+        _n = _flushed = _lost = 0;
+    }
+
+    void ProfileRing::record(CurOp& op, const string& info, int millis) {
+        Record r;
+        r.ts = jsTime();
+        r.op = op.getOp();
+        r.ns = op.getNS();
+        r.millis = millis;
+        r.lockWaitMicros = op.lockWaitMicros();
+        r.nscanned = op.debug().nscanned;
+        r.plan = op.debug().plan;
+        if ( info.size() > MaxInfoSize )
+            r.info = info.substr( 0, MaxInfoSize );
+        else
+            r.info = info;
+        add( r );
+    }
+
+    void ProfileRing::add(Record& r) {
+        // all allocation is done by the caller; under the mutex we only swap
+        boostlock lk(_m);
+        if ( _size == 0 )
+            return;
+        if ( _flushing && _n - _flushed >= _size ) {
+            // the flusher fell behind; the oldest unflushed record is about to go
+            _flushed++;
+            _lost++;
+        }
+        _recs[ _n % _size ].swap( r );
+        _n++;
+    }
+
+    void ProfileRing::get(const string& db, int limit, vector<Record>& out) {
+        string prefix = db.empty() ? "" : db + '.';
+        boostlock lk(_m);
+        unsigned long long have = _n < _size ? _n : _size;
+        for ( unsigned long long i = 0; i < have && (int) out.size() < limit; i++ ) {
+            const Record& r = _recs[ ( _n - 1 - i ) % _size ];
+            if ( prefix.empty() || r.ns.compare( 0, prefix.size(), prefix ) == 0 )
+                out.push_back( r );
+        }
+    }
+
+    void ProfileRing::takeUnflushed(vector<Record>& out) {
+        boostlock lk(_m);
+        for ( ; _flushed < _n; _flushed++ )
+            out.push_back( _recs[ _flushed % _size ] );
+    }
+
+    void ProfileRing::appendStats(BSONObjBuilder& b) {
+        boostlock lk(_m);
+        b.append("size", (int) _size);
+        b.append("recorded", (long long) _n);
+        if ( _flushing ) {
+            b.append("pending", (long long) ( _n - _flushed ));
+            b.append("lost", (long long) _lost);
+        }
+    }
+
+    void ProfileRingFlusher::run() {
+        Client::initThread("profileRingFlush");
+        Client& client = cc();
+        log(1) << "will flush profile ring every: " << _sleepsecs << " seconds" << endl;
+        vector<ProfileRing::Record> batch;
+        while ( ! inShutdown() ) {
+            sleepsecs( _sleepsecs );
+            batch.clear();
+            ProfileRing::global.takeUnflushed( batch );
+            if ( batch.empty() )
+                continue;
+            try {
+                // one lock acquisition per batch rather than one per op
+                mongolock lk(true);
+                for ( unsigned i = 0; i < batch.size(); i++ ) {
+                    const ProfileRing::Record& r = batch[i];
+                    if ( ! dbHolder.isLoaded( nsToDatabase( r.ns.c_str() ) , dbpath ) )
+                        continue; // db was dropped or closed since
+                    Client::Context ctx( r.ns );
+                    BSONObj p = r.toBSON();
+                    theDataFileMgr.insert( cc().database()->profileName.c_str(),
+                                           p.objdata(), p.objsize(), true );
+                }
+            }
+            catch ( std::exception& e ) {
+                log() << "ERROR in ProfileRingFlusher: " << e.what() << endl;
+            }
+        }
+        client.shutdown();
+    }
+
+    /* { profileRing : 1 [, limit : <n>] }
+       returns the most recent in memory profile records for this database, newest first.
+       run against admin to see all databases.
+    */
+    class CmdProfileRing : public Command {
+    public:
+        virtual bool slaveOk() {
+            return true;
+        }
+        virtual bool readOnly() { return true; }
+        virtual void help( stringstream& help ) const {
+            help << "recent ops from the in memory profiler (--profileRing)\n"
+                 << "{ profileRing : 1 [, limit : <n>] }";
+        }
+        CmdProfileRing() : Command("profileRing") {}
+        bool run(const char *ns, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            ProfileRing& ring = ProfileRing::global;
+            if ( ! ring.enabled() ) {
+                errmsg = "in memory profiler is off, start with --profileRing <n>";
+                return false;
+            }
+            int limit = 100;
+            BSONElement l = cmdObj["limit"];
+            if ( l.isNumber() )
+                limit = l.numberInt();
+
+            string db = nsToDatabase( ns );
+            if ( db == "admin" )
+                db = "";
+
+            vector<ProfileRing::Record> recs;
+            ring.get( db, limit, recs );
+            BSONObjBuilder arr( result.subarrayStart( "records" ) );
+            for ( unsigned i = 0; i < recs.size(); i++ )
+                arr.append( BSONObjBuilder::numStr( i ).c_str(), recs[i].toBSON() );
+            arr.done();
+
+            BSONObjBuilder stats( result.subobjStart( "stats" ) );
+            ring.appendStats( stats );
+            stats.done();
+            return true;
+        }
+    } cmdProfileRing;
+
 } // namespace mongo
@@ -22,9 +22,12 @@
 #include "../stdafx.h"
 #include "jsobj.h"
 #include "pdfile.h"
+#include "../util/background.h"
 
 namespace mongo {
 
+    class CurOp;
+
     /* --- profiling --------------------------------------------
        do when database->profile is set
     */
@@ -32,4 +35,69 @@ namespace mongo {
     void profile(const char *str,
                  int millis);
 
+    /* in memory profiler, enabled with --profileRing <n>.  when on, profiled ops are recorded
+       into a fixed size ring instead of being inserted into system.profile, so profiling no
+       longer takes the db write lock after every op.  read it back with the profileRing command.
+       with --profileRingFlush <secs> the records are also copied to system.profile in batches.
+    */
+    class ProfileRing : boost::noncopyable {
+    public:
+        enum { MaxInfoSize = 2048 };
+
+        struct Record {
+            Record() : ts(0), op(0), millis(0), lockWaitMicros(0), nscanned(-1) { }
+            Date_t ts;
+            int op;
+            string ns;
+            int millis;
+            long long lockWaitMicros;
+            long long nscanned;     // -1 if n/a
+            string plan;
+            string info;            // the OpDebug string, truncated to MaxInfoSize
+
+            BSONObj toBSON() const;
+            void swap(Record& other);
+        };
+
+        ProfileRing() : _size(0), _flushing(false), _n(0), _flushed(0), _lost(0) { }
+
+        /* call at startup, before any ops are recorded.  0 turns the ring off.
+           flushing: someone will call takeUnflushed(), so count records it misses. */
+        void init(unsigned size, bool flushing);
+        bool enabled() const { return _size > 0; }
+
+        void record(CurOp& op, const string& info, int millis);
+        /* r is swapped into the ring and left with the contents of the slot it replaced */
+        void add(Record& r);
+
+        /* newest first.  db == "" returns records for all databases. */
+        void get(const string& db, int limit, vector<Record>& out);
+
+        /* oldest first, everything added since the last call.  records overwritten before
+           they were taken are counted in lost(). */
+        void takeUnflushed(vector<Record>& out);
+
+        void appendStats(BSONObjBuilder& b);
+
+        static ProfileRing global;
+
+    private:
+        boost::mutex _m;
+        vector<Record> _recs;
+        unsigned _size;
+        bool _flushing;
+        unsigned long long _n;          // records ever added; the next goes in _recs[_n % _size]
+        unsigned long long _flushed;    // records before this have been handed to takeUnflushed()
+        unsigned long long _lost;
+    };
+
+    class ProfileRingFlusher : public BackgroundJob {
+    public:
+        ProfileRingFlusher() : _sleepsecs(0) { }
+        void run();
+        int _sleepsecs; // 0 = keep records in memory only.  set by --profileRingFlush
+    };
+
+    extern ProfileRingFlusher profileRingFlusher;
+
 } // namespace mongo
@@ -786,6 +786,91 @@ namespace mongo {
         return -1;
     }
 
+    Ordering Ordering::make(const BSONObj& keyPattern) {
+        Ordering o;
+        BSONObjIterator k(keyPattern);
+        while ( k.more() ) {
+            BSONElement e = k.next();
+            if ( e.eoo() )
+                break;
+            uassert( 13008 , "too many fields in key pattern" , o.nkeys < MaxFields );
+            if ( e.number() < 0 )
+                o.bits |= 1ULL << o.nkeys;
+            o.nkeys++;
+        }
+        return o;
+    }
+
+    /* compare two key elements.  same-typed ints, longs, doubles, dates, strings and ObjectIds --
+       nearly every index key -- are compared here without the canonical type lookup and the
+       switch in compareElementValues; anything else goes the long way.
+    */
+    static inline int keyElementCompare(const BSONElement& l, const BSONElement& r, bool considerFieldName) {
+        BSONType t = l.type();
+        if ( t != r.type() || ( considerFieldName && ( *l.fieldName() || *r.fieldName() ) ) )
+            return l.woCompare( r, considerFieldName );
+        switch ( t ) {
+        case NumberInt: {
+            int a = l._numberInt(), b = r._numberInt();
+            return a < b ? -1 : ( a == b ? 0 : 1 );
+        }
+        case NumberLong: {
+            long long a = l._numberLong(), b = r._numberLong();
+            return a < b ? -1 : ( a == b ? 0 : 1 );
+        }
+        case NumberDouble: {
+            double a = l._numberDouble(), b = r._numberDouble();
+            // nan and infinities have their own ordering in compareElementValues
+            const double m = numeric_limits< double >::max();
+            if ( a <= m && a >= -m && b <= m && b >= -m )
+                return a < b ? -1 : ( a == b ? 0 : 1 );
+            break;
+        }
+        case Date:
+        case Timestamp: {
+            unsigned long long a = l.date(), b = r.date();
+            return a < b ? -1 : ( a == b ? 0 : 1 );
+        }
+        case String:
+            return strcmp( l.valuestr(), r.valuestr() );
+        case jstOID:
+            return memcmp( l.value(), r.value(), 12 );
+        default:
+            break;
+        }
+        return compareElementValues( l, r );
+    }
+
+    int BSONObj::woCompare(const BSONObj &r, const Ordering &o,
+                           bool considerFieldName) const {
+        if ( isEmpty() )
+            return r.isEmpty() ? 0 : -1;
+        if ( r.isEmpty() )
+            return 1;
+
+        BSONObjIterator i(*this);
+        BSONObjIterator j(r);
+        unsigned long long mask = 1;
+        while ( 1 ) {
+            // so far, equal...
+
+            BSONElement l = i.next();
+            BSONElement r = j.next();
+            if ( l.eoo() )
+                return r.eoo() ? 0 : -1;
+            if ( r.eoo() )
+                return 1;
+
+            int x = keyElementCompare( l, r, considerFieldName );
+            if ( o.descending( mask ) )
+                x = -x;
+            if ( x != 0 )
+                return x;
+            mask <<= 1;
+        }
+        return -1;
+    }
+
     BSONObj staticNull = fromjson( "{'':null}" );
 
     /* well ordered compare */
@@ -44,6 +44,7 @@ namespace mongo {
     class BSONObjBuilder;
     class BSONArrayBuilder;
     class BSONObjBuilderValueStream;
+    class Ordering;
 
 #pragma pack(1)
 
@@ -904,6 +905,12 @@ namespace mongo {
         */
         int woCompare(const BSONObj& r, const BSONObj &idxKey = BSONObj(),
                       bool considerFieldName=true) const;
+
+        /** as above, with the directions of idxKey precomputed.  use this in loops: the key
+            pattern is not walked on every compare, and the common key types are compared in place.
+        */
+        int woCompare(const BSONObj& r, const Ordering &o,
+                      bool considerFieldName=true) const;
         
         int woSortOrder( const BSONObj& r , const BSONObj& sortKey ) const;
 
@@ -1005,14 +1012,37 @@ namespace mongo {
         explicit BSONArray(const BSONObj& obj): BSONObj(obj) {}
     };
 
+    /** the directions of a key pattern, one bit per field: { a : 1, b : -1 } has get(0) == 1
+        and get(1) == -1.  fields past the end of the pattern are ascending.  build one with make()
+        when a key pattern is going to be compared against many times.
+    */
+    class Ordering {
+    public:
+        enum { MaxFields = 64 };
+
+        Ordering() : bits(0), nkeys(0) {}
+
+        int get(int i) const {
+            return i < MaxFields && ( bits & ( 1ULL << i ) ) ? -1 : 1;
+        }
+        /* nonzero if the field whose bit is in mask is descending */
+        unsigned long long descending(unsigned long long mask) const { return bits & mask; }
+        int nFields() const { return nkeys; }
+
+        static Ordering make(const BSONObj& keyPattern);
+    private:
+        unsigned long long bits;
+        int nkeys;
+    };
+
     class BSONObjCmp {
     public:
-        BSONObjCmp( const BSONObj &_order = BSONObj() ) : order( _order ) {}
+        BSONObjCmp( const BSONObj &_order = BSONObj() ) : ordering( Ordering::make( _order ) ) {}
         bool operator()( const BSONObj &l, const BSONObj &r ) const {
-            return l.woCompare( r, order ) < 0;
+            return l.woCompare( r, ordering ) < 0;
         }
     private:
-        BSONObj order;
+        Ordering ordering;
     };
 
     class BSONObjCmpDefaultOrder : public BSONObjCmp {
@@ -1133,6 +1163,12 @@ namespace mongo {
             b.skip(4); /*leave room for size field*/
         }
 
+        /** @param arena build in per-operation memory (see CurOp::arena()).  obj() then returns
+            an object that is only valid until the arena is released. */
+        BSONObjBuilder( Arena &arena, int initsize=512 ) : b(buf_), buf_(arena, initsize), offset_( 0 ), s_( this ) {
+            b.skip(4); /*leave room for size field*/
+        }
+
         /** @param baseBuilder construct a BSONObjBuilder using an existing BufBuilder */
         BSONObjBuilder( BufBuilder &baseBuilder ) : b( baseBuilder ), buf_( 0 ), offset_( baseBuilder.len() ), s_( this ) {
             b.skip( 4 );
@@ -1469,8 +1505,11 @@ namespace mongo {
             marshalArray( fieldName, arrBuilder.done() );
         }*/
 
-        /** The returned BSONObj will free the buffer when it is finished. */
+        /** The returned BSONObj will free the buffer when it is finished. 
+            (unless we are building in an arena, in which case the arena owns it.) */
         BSONObj obj() {
+            if ( owned() && b.inArena() )
+                return BSONObj(_done());
             massert( 10335 ,  "builder does not own memory", owned() );
             int l;
             return BSONObj(decouple(l), true);
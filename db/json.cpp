@@ -21,152 +21,8 @@
 #include "../util/builder.h"
 #include "../util/base64.h"
 
-using namespace boost::spirit;
-
 namespace mongo {
 
-    struct ObjectBuilder {
-        BSONObjBuilder *back() {
-            return builders.back().get();
-        }
-        // Storage for field names of elements within builders.back().
-        const char *fieldName() {
-            return fieldNames.back().c_str();
-        }
-        bool empty() const {
-            return builders.size() == 0;
-        }
-        void init() {
-            boost::shared_ptr< BSONObjBuilder > b( new BSONObjBuilder() );
-            builders.push_back( b );
-            fieldNames.push_back( "" );
-            indexes.push_back( 0 );
-        }
-        void pushObject( const char *fieldName ) {
-            boost::shared_ptr< BSONObjBuilder > b( new BSONObjBuilder( builders.back()->subobjStart( fieldName ) ) );
-            builders.push_back( b );
-            fieldNames.push_back( "" );
-            indexes.push_back( 0 );
-        }
-        void pushArray( const char *fieldName ) {
-            boost::shared_ptr< BSONObjBuilder > b( new BSONObjBuilder( builders.back()->subarrayStart( fieldName ) ) );
-            builders.push_back( b );
-            fieldNames.push_back( "" );
-            indexes.push_back( 0 );
-        }
-        BSONObj pop() {
-            BSONObj ret;
-            if ( back()->owned() )
-                ret = back()->obj();
-            else
-                ret = back()->done();
-            builders.pop_back();
-            fieldNames.pop_back();
-            indexes.pop_back();
-            return ret;
-        }
-        void nameFromIndex() {
-            fieldNames.back() = BSONObjBuilder::numStr( indexes.back() );
-        }
-        string popString() {
-            string ret = ss.str();
-            ss.str( "" );
-            return ret;
-        }
-        // Cannot use auto_ptr because its copy constructor takes a non const reference.
-        vector< boost::shared_ptr< BSONObjBuilder > > builders;
-        vector< string > fieldNames;
-        vector< int > indexes;
-        stringstream ss;
-        string ns;
-        OID oid;
-        string binData;
-        BinDataType binDataType;
-        string regex;
-        string regexOptions;
-        Date_t date;
-    };
-
-    struct objectStart {
-        objectStart( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char &c ) const {
-            if ( b.empty() )
-                b.init();
-            else
-                b.pushObject( b.fieldName() );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct arrayStart {
-        arrayStart( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char &c ) const {
-            b.pushArray( b.fieldName() );
-            b.nameFromIndex();
-        }
-        ObjectBuilder &b;
-    };
-
-    struct arrayNext {
-        arrayNext( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char &c ) const {
-            ++b.indexes.back();
-            b.nameFromIndex();
-        }
-        ObjectBuilder &b;
-    };
-
-    struct ch {
-        ch( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char c ) const {
-            b.ss << c;
-        }
-        ObjectBuilder &b;
-    };
-
-    struct chE {
-        chE( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char c ) const {
-            char o = '\0';
-            switch ( c ) {
-            case '\"':
-                o = '\"';
-                break;
-            case '\'':
-                o = '\'';
-                break;
-            case '\\':
-                o = '\\';
-                break;
-            case '/':
-                o = '/';
-                break;
-            case 'b':
-                o = '\b';
-                break;
-            case 'f':
-                o = '\f';
-                break;
-            case 'n':
-                o = '\n';
-                break;
-            case 'r':
-                o = '\r';
-                break;
-            case 't':
-                o = '\t';
-                break;
-            case 'v':
-                o = '\v';
-                break;
-            default:
-                assert( false );
-            }
-            b.ss << o;
-        }
-        ObjectBuilder &b;
-    };
-
     namespace hex {
         int val( char c ) {
             if ( '0' <= c && c <= '9' )
@@ -183,133 +39,6 @@ namespace mongo {
         }
     } // namespace hex
 
-    struct chU {
-        chU( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            unsigned char first = hex::val( start );
-            unsigned char second = hex::val( start + 2 );
-            if ( first == 0 && second < 0x80 )
-                b.ss << second;
-            else if ( first < 0x08 ) {
-                b.ss << char( 0xc0 | ( ( first << 2 ) | ( second >> 6 ) ) );
-                b.ss << char( 0x80 | ( ~0xc0 & second ) );
-            } else {
-                b.ss << char( 0xe0 | ( first >> 4 ) );
-                b.ss << char( 0x80 | ( ~0xc0 & ( ( first << 2 ) | ( second >> 6 ) ) ) );
-                b.ss << char( 0x80 | ( ~0xc0 & second ) );
-            }
-        }
-        ObjectBuilder &b;
-    };
-
-    struct chClear {
-        chClear( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char c ) const {
-            b.popString();
-        }
-        ObjectBuilder &b;
-    };
-
-    struct fieldNameEnd {
-        fieldNameEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            string name = b.popString();
-            massert( 10338 ,  "Invalid use of reserved field name",
-                     name != "$oid" &&
-                     name != "$binary" &&
-                     name != "$type" &&
-                     name != "$date" &&
-                     name != "$regex" &&
-                     name != "$options" );
-            b.fieldNames.back() = name;
-        }
-        ObjectBuilder &b;
-    };
-
-    struct unquotedFieldNameEnd {
-        unquotedFieldNameEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            string name( start, end );
-            b.fieldNames.back() = name;
-        }
-        ObjectBuilder &b;
-    };
-
-    struct stringEnd {
-        stringEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->append( b.fieldName(), b.popString() );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct numberValue {
-        numberValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( double d ) const {
-            b.back()->append( b.fieldName(), d );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct intValue {
-        intValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( long long num ) const {
-            if (num >= numeric_limits<int>::min() && num <= numeric_limits<int>::max())
-                b.back()->append( b.fieldName(), (int)num );
-            else
-                b.back()->append( b.fieldName(), num );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct subobjectEnd {
-        subobjectEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.pop();
-        }
-        ObjectBuilder &b;
-    };
-
-    struct arrayEnd {
-        arrayEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.pop();
-        }
-        ObjectBuilder &b;
-    };
-
-    struct trueValue {
-        trueValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendBool( b.fieldName(), true );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct falseValue {
-        falseValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendBool( b.fieldName(), false );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct nullValue {
-        nullValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendNull( b.fieldName() );
-        }
-        ObjectBuilder &b;
-    };
-
-    struct dbrefNS {
-        dbrefNS( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.ns = b.popString();
-        }
-        ObjectBuilder &b;
-    };
-
 // NOTE s must be 24 characters.
     OID stringToOid( const char *s ) {
         OID oid;
@@ -319,247 +48,637 @@ namespace mongo {
         return oid;
     }
 
-    struct oidValue {
-        oidValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.oid = stringToOid( start );
+    /* character classes for the scanner.  string bodies are copied a run at a time: the run
+       ends at the first character whose class says it needs a look (a quote, a backslash,
+       a control character, or the terminating nul).
+    */
+    class JsonChars {
+    public:
+        enum {
+            Space = 1,
+            Hex = 2,
+            Digit = 4,
+            NameStart = 8,    // may start an unquoted field name
+            Name = 16,        // may continue one
+            Base64 = 32,
+            StopDouble = 64,  // ends a run in a "string"
+            StopSingle = 128, // ends a run in a 'string'
+            StopRegex = 256   // ends a run in a /regex/
+        };
+        bool is( char c, int cls ) const {
+            return _c[ (unsigned char) c ] & cls;
+        }
+        /* built on first use, as fromjson() is called by other modules' static initializers */
+        static const JsonChars& get() {
+            static JsonChars chars;
+            return chars;
+        }
+    private:
+        JsonChars() {
+            memset( _c, 0, sizeof( _c ) );
+            for ( int c = 0; c < 256; c++ ) {
+                if ( c == ' ' || ( c >= '\t' && c <= '\r' ) )
+                    _c[ c ] |= Space;
+                if ( isdigit( c ) )
+                    _c[ c ] |= Digit | Hex | Name | Base64;
+                if ( ( c >= 'a' && c <= 'f' ) || ( c >= 'A' && c <= 'F' ) )
+                    _c[ c ] |= Hex;
+                if ( isalpha( c ) || c == '$' || c == '_' )
+                    _c[ c ] |= NameStart | Name;
+                if ( isalpha( c ) || c == '+' || c == '/' )
+                    _c[ c ] |= Base64;
+                if ( c < 0x20 || c == '\\' )
+                    _c[ c ] |= StopDouble | StopSingle | StopRegex;
+            }
+            _c[ (unsigned char) '"' ] |= StopDouble;
+            _c[ (unsigned char) '\'' ] |= StopSingle;
+            _c[ (unsigned char) '/' ] |= StopRegex;
         }
-        ObjectBuilder &b;
+        unsigned short _c[ 256 ];
     };
 
-    struct dbrefEnd {
-        dbrefEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendDBRef( b.fieldName(), b.ns.c_str(), b.oid );
+    /* single pass parser for fromjson().  output is written straight into one BufBuilder as we
+       go; nested objects reserve their size field and patch it when they close.  nothing is
+       reparsed except the extended json forms ({ "$oid" : ... } etc.), which are tried first and
+       fall back to a plain object when they don't match -- so { "$ref" : "a", "$id" : ObjectId(...) }
+       is still an ordinary object.
+    */
+    class JsonParser {
+    public:
+        JsonParser( const char *str ) : _chars( JsonChars::get() ), _p( str ), _names( 128 ) {}
+
+        BSONObj parse() {
+            skipWs();
+            if ( *_p != '{' )
+                fail();
+            _p++;
+            object();
+            skipWs();
+            if ( *_p )
+                fail();
+            char *data = _b.buf();
+            _b.decouple();
+            return BSONObj( data, true );
+        }
+
+    private:
+        void fail() {
+            int len = strlen( _p );
+            if ( len > 10 )
+                len = 10;
+            stringstream ss;
+            ss << "Failure parsing JSON string near: " << string( _p, len );
+            massert( 10340 ,  ss.str(), false );
         }
-        ObjectBuilder &b;
-    };
 
-    struct oidEnd {
-        oidEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendOID( b.fieldName(), &b.oid );
+        void skipWs() {
+            while ( _chars.is( *_p, JsonChars::Space ) )
+                _p++;
         }
-        ObjectBuilder &b;
-    };
 
-    struct binDataBinary {
-        binDataBinary( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            massert( 10339 ,  "Badly formatted bindata", ( end - start ) % 4 == 0 );
-            string encoded( start, end );
-            b.binData = base64::decode( encoded );
+        /* skip whitespace, then consume c if it is next */
+        bool accept( char c ) {
+            skipWs();
+            if ( *_p != c )
+                return false;
+            _p++;
+            return true;
         }
-        ObjectBuilder &b;
-    };
 
-    struct binDataType {
-        binDataType( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.binDataType = BinDataType( hex::val( start ) );
+        /* skip whitespace, then consume the literal s if it is next */
+        bool accept( const char *s ) {
+            skipWs();
+            int n = strlen( s );
+            if ( strncmp( _p, s, n ) != 0 )
+                return false;
+            _p += n;
+            return true;
         }
-        ObjectBuilder &b;
-    };
 
-    struct binDataEnd {
-        binDataEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendBinData( b.fieldName(), b.binData.length(),
-                                     b.binDataType, b.binData.data() );
+        void expect( char c ) {
+            if ( !accept( c ) )
+                fail();
         }
-        ObjectBuilder &b;
-    };
 
-    struct dateValue {
-        dateValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( Date_t v ) const {
-            b.date = v;
+        void header( BSONType t, const char *fieldName ) {
+            _b.append( (char) t );
+            _b.append( fieldName );
         }
-        ObjectBuilder &b;
-    };
 
-    struct dateEnd {
-        dateEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendDate( b.fieldName(), b.date );
+        /* called with the '{' consumed.  writes the object body, size first */
+        void object() {
+            int start = _b.len();
+            _b.skip( 4 );
+            if ( !accept( '}' ) ) {
+                do {
+                    int nameOfs = fieldName();
+                    expect( ':' );
+                    value( nameOfs );
+                    _names.setlen( nameOfs );
+                } while ( accept( ',' ) );
+                expect( '}' );
+            }
+            endObject( start );
+        }
+
+        /* called with the '[' consumed */
+        void array() {
+            int start = _b.len();
+            _b.skip( 4 );
+            if ( !accept( ']' ) ) {
+                unsigned i = 0;
+                do {
+                    char num[ 16 ];
+                    char *n = num + sizeof( num );
+                    *--n = 0;
+                    unsigned x = i++;
+                    do {
+                        *--n = '0' + x % 10;
+                        x /= 10;
+                    } while ( x );
+                    value( n );
+                } while ( accept( ',' ) );
+                expect( ']' );
+            }
+            endObject( start );
+        }
+
+        void endObject( int start ) {
+            _b.append( (char) EOO );
+            *( (int *) ( _b.buf() + start ) ) = _b.len() - start;
+        }
+
+        /* parse a field name onto _names.  @return its offset there */
+        int fieldName() {
+            skipWs();
+            int ofs = _names.len();
+            char c = *_p;
+            if ( c == '"' || c == '\'' ) {
+                if ( !readString( c, _names ) )
+                    fail();
+                _names.append( (char) 0 );
+                const char *name = _names.buf() + ofs;
+                massert( 10338 ,  "Invalid use of reserved field name",
+                         strcmp( name, "$oid" ) &&
+                         strcmp( name, "$binary" ) &&
+                         strcmp( name, "$type" ) &&
+                         strcmp( name, "$date" ) &&
+                         strcmp( name, "$regex" ) &&
+                         strcmp( name, "$options" ) );
+            }
+            else if ( _chars.is( c, JsonChars::NameStart ) ) {
+                const char *s = _p;
+                while ( _chars.is( *_p, JsonChars::Name ) )
+                    _p++;
+                _names.append( (void *) s, _p - s );
+                _names.append( (char) 0 );
+            }
+            else {
+                fail();
+            }
+            return ofs;
         }
-        ObjectBuilder &b;
-    };
 
-    struct regexValue {
-        regexValue( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.regex = b.popString();
+        void value( int nameOfs ) {
+            // _names only grows when a nested object is started, after its name has been written
+            value( _names.buf() + nameOfs );
         }
-        ObjectBuilder &b;
-    };
 
-    struct regexOptions {
-        regexOptions( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.regexOptions = string( start, end );
+        void value( const char *fieldName ) {
+            skipWs();
+            switch ( *_p ) {
+            case '{': {
+                if ( extendedObject( fieldName ) )
+                    return;
+                _p++;
+                header( Object, fieldName );
+                object();
+                return;
+            }
+            case '[':
+                _p++;
+                header( Array, fieldName );
+                array();
+                return;
+            case '"':
+            case '\'':
+                stringValue( fieldName );
+                return;
+            case '/':
+                if ( !regex( fieldName ) )
+                    fail();
+                return;
+            case 'O': {
+                OID oid;
+                if ( !accept( "ObjectId" ) || !accept( '(' ) || !quotedOid( oid ) || !accept( ')' ) )
+                    fail();
+                _b.append( (char) jstOID );
+                _b.append( fieldName );
+                _b.append( (void *) &oid, 12 );
+                return;
+            }
+            case 'D':
+                if ( _p[ 1 ] == 'b' ) {
+                    string ns;
+                    OID oid;
+                    if ( !accept( "Dbref" ) || !accept( '(' ) || !quotedString( ns ) || !accept( ',' ) ||
+                         !quotedOid( oid ) || !accept( ')' ) )
+                        fail();
+                    appendDBRef( fieldName, ns, oid );
+                    return;
+                }
+                if ( !dateCall( fieldName ) )
+                    fail();
+                return;
+            case 'n':
+                if ( _p[ 1 ] == 'u' ) {
+                    if ( !accept( "null" ) )
+                        fail();
+                    header( jstNULL, fieldName );
+                    return;
+                }
+                if ( !accept( "new" ) || !dateCall( fieldName ) )
+                    fail();
+                return;
+            case 't':
+                if ( !accept( "true" ) )
+                    fail();
+                header( Bool, fieldName );
+                _b.append( (char) 1 );
+                return;
+            case 'f':
+                if ( !accept( "false" ) )
+                    fail();
+                header( Bool, fieldName );
+                _b.append( (char) 0 );
+                return;
+            default:
+                number( fieldName );
+            }
         }
-        ObjectBuilder &b;
-    };
 
-    struct regexEnd {
-        regexEnd( ObjectBuilder &_b ) : b( _b ) {}
-        void operator() ( const char *start, const char *end ) const {
-            b.back()->appendRegex( b.fieldName(), b.regex.c_str(),
-                                   b.regexOptions.c_str() );
+        /* the string body after an opening quote, up to and including the matching close quote,
+           unescaped onto out.  @return false if it is malformed; out then holds some of it.
+        */
+        bool readString( char quote, BufBuilder &out ) {
+            int stop = quote == '"' ? JsonChars::StopDouble : JsonChars::StopSingle;
+            _p++;
+            while ( 1 ) {
+                const char *run = _p;
+                while ( !_chars.is( *_p, stop ) )
+                    _p++;
+                if ( _p != run )
+                    out.append( (void *) run, _p - run );
+                char c = *_p;
+                if ( c == quote ) {
+                    _p++;
+                    return true;
+                }
+                if ( c != '\\' )
+                    return false; // control character or end of input
+                c = *++_p;
+                _p++;
+                switch ( c ) {
+                case 'b': out.append( '\b' ); break;
+                case 'f': out.append( '\f' ); break;
+                case 'n': out.append( '\n' ); break;
+                case 'r': out.append( '\r' ); break;
+                case 't': out.append( '\t' ); break;
+                case 'v': out.append( '\v' ); break;
+                case 'u':
+                    if ( !unicode( out ) )
+                        out.append( 'u' );
+                    break;
+                case 'x': // hex and octal aren't supported
+                    return false;
+                case 0:
+                    _p--;
+                    return false;
+                default:
+                    if ( _chars.is( c, JsonChars::Digit ) )
+                        return false;
+                    out.append( c );
+                }
+            }
         }
-        ObjectBuilder &b;
-    };
 
-// One gotcha with this parsing library is probably best ilustrated with an
-// example.  Say we have a production like this:
-// z = ( ch_p( 'a' )[ foo ] >> ch_p( 'b' ) ) | ( ch_p( 'a' )[ foo ] >> ch_p( 'c' ) );
-// On input "ac", action foo() will be called twice -- once as the parser tries
-// to match "ab", again as the parser successfully matches "ac".  Sometimes
-// the grammar can be modified to eliminate these situations.  Here, for example:
-// z = ch_p( 'a' )[ foo ] >> ( ch_p( 'b' ) | ch_p( 'c' ) );
-// However, this is not always possible.  In my implementation I've tried to
-// stick to the following pattern: store fields fed to action callbacks
-// temporarily as ObjectBuilder members, then append to a BSONObjBuilder once
-// the parser has completely matched a nonterminal and won't backtrack.  It's
-// worth noting here that this parser follows a short-circuit convention.  So,
-// in the original z example on line 3, if the input was "ab", foo() would only
-// be called once.
-    struct JsonGrammar : public grammar< JsonGrammar > {
-public:
-        JsonGrammar( ObjectBuilder &_b ) : b( _b ) {}
-
-        template < typename ScannerT >
-        struct definition {
-            definition( JsonGrammar const &self ) {
-                object = ch_p( '{' )[ objectStart( self.b ) ] >> !members >> '}';
-                members = list_p((fieldName >> ':' >> value) , ',');
-                fieldName =
-                    str[ fieldNameEnd( self.b ) ] |
-                    singleQuoteStr[ fieldNameEnd( self.b ) ] |
-                    unquotedFieldName[ unquotedFieldNameEnd( self.b ) ];
-                array = ch_p( '[' )[ arrayStart( self.b ) ] >> !elements >> ']';
-                elements = list_p(value, ch_p(',')[arrayNext( self.b )]);
-                value =
-                    oid[ oidEnd( self.b ) ] |
-                    dbref[ dbrefEnd( self.b ) ] |
-                    bindata[ binDataEnd( self.b ) ] |
-                    date[ dateEnd( self.b ) ] |
-                    regex[ regexEnd( self.b ) ] |
-                    str[ stringEnd( self.b ) ] |
-                    singleQuoteStr[ stringEnd( self.b ) ] |
-                    number |
-                    integer |
-                    object[ subobjectEnd( self.b ) ] |
-                    array[ arrayEnd( self.b ) ] |
-                    lexeme_d[ str_p( "true" ) ][ trueValue( self.b ) ] |
-                    lexeme_d[ str_p( "false" ) ][ falseValue( self.b ) ] |
-                    lexeme_d[ str_p( "null" ) ][ nullValue( self.b ) ];
-                // NOTE lexeme_d and rules don't mix well, so we have this mess.
-                // NOTE We use range_p rather than cntrl_p, because the latter is locale dependent.
-                str = lexeme_d[ ch_p( '"' )[ chClear( self.b ) ] >>
-                                *( ( ch_p( '\\' ) >>
-                                     (
-                                       ch_p( 'b' )[ chE( self.b ) ] |
-                                       ch_p( 'f' )[ chE( self.b ) ] |
-                                       ch_p( 'n' )[ chE( self.b ) ] |
-                                       ch_p( 'r' )[ chE( self.b ) ] |
-                                       ch_p( 't' )[ chE( self.b ) ] |
-                                       ch_p( 'v' )[ chE( self.b ) ] |
-                                       ( ch_p( 'u' ) >> ( repeat_p( 4 )[ xdigit_p ][ chU( self.b ) ] ) ) |
-                                       ( ~ch_p('x') & (~range_p('0','9'))[ ch( self.b ) ] ) // hex and octal aren't supported
-                                     )
-                                   ) |
-                                   ( ~range_p( 0x00, 0x1f ) & ~ch_p( '"' ) & ( ~ch_p( '\\' ) )[ ch( self.b ) ] ) ) >> '"' ];
-
-                singleQuoteStr = lexeme_d[ ch_p( '\'' )[ chClear( self.b ) ] >>
-                                *( ( ch_p( '\\' ) >>
-                                     (
-                                       ch_p( 'b' )[ chE( self.b ) ] |
-                                       ch_p( 'f' )[ chE( self.b ) ] |
-                                       ch_p( 'n' )[ chE( self.b ) ] |
-                                       ch_p( 'r' )[ chE( self.b ) ] |
-                                       ch_p( 't' )[ chE( self.b ) ] |
-                                       ch_p( 'v' )[ chE( self.b ) ] |
-                                       ( ch_p( 'u' ) >> ( repeat_p( 4 )[ xdigit_p ][ chU( self.b ) ] ) ) |
-                                       ( ~ch_p('x') & (~range_p('0','9'))[ ch( self.b ) ] ) // hex and octal aren't supported
-                                     )
-                                   ) |
-                                   ( ~range_p( 0x00, 0x1f ) & ~ch_p( '\'' ) & ( ~ch_p( '\\' ) )[ ch( self.b ) ] ) ) >> '\'' ];
-
-                // real_p accepts numbers with nonsignificant zero prefixes, which
-                // aren't allowed in JSON.  Oh well.
-                number = strict_real_p[ numberValue( self.b ) ];
-
-                static int_parser<long long, 10,  1, numeric_limits<long long>::digits10 + 1> long_long_p;
-                integer = long_long_p[ intValue(self.b) ];
-
-                // We allow a subset of valid js identifier names here.
-                unquotedFieldName = lexeme_d[ ( alpha_p | ch_p( '$' ) | ch_p( '_' ) ) >> *( ( alnum_p | ch_p( '$' ) | ch_p( '_'  )) ) ];
-
-                dbref = dbrefS | dbrefT;
-                dbrefS = ch_p( '{' ) >> "\"$ref\"" >> ':' >>
-                         str[ dbrefNS( self.b ) ] >> ',' >> "\"$id\"" >> ':' >> quotedOid >> '}';
-                dbrefT = str_p( "Dbref" ) >> '(' >> str[ dbrefNS( self.b ) ] >> ',' >>
-                         quotedOid >> ')';
-
-                oid = oidS | oidT;
-                oidS = ch_p( '{' ) >> "\"$oid\"" >> ':' >> quotedOid >> '}';
-                oidT = str_p( "ObjectId" ) >> '(' >> quotedOid >> ')';
-
-                quotedOid = lexeme_d[ '"' >> ( repeat_p( 24 )[ xdigit_p ] )[ oidValue( self.b ) ] >> '"' ];
-
-                bindata = ch_p( '{' ) >> "\"$binary\"" >> ':' >>
-                          lexeme_d[ '"' >> ( *( range_p( 'A', 'Z' ) | range_p( 'a', 'z' ) | range_p( '0', '9' ) | ch_p( '+' ) | ch_p( '/' ) ) >> *ch_p( '=' ) )[ binDataBinary( self.b ) ] >> '"' ] >> ',' >> "\"$type\"" >> ':' >>
-                          lexeme_d[ '"' >> ( repeat_p( 2 )[ xdigit_p ] )[ binDataType( self.b ) ] >> '"' ] >> '}';
-
-                // TODO: this will need to use a signed parser at some point
-                date = dateS | dateT;
-                dateS = ch_p( '{' ) >> "\"$date\"" >> ':' >> uint_parser< Date_t >()[ dateValue( self.b ) ] >> '}';
-                dateT = !str_p("new") >> str_p( "Date" ) >> '(' >> uint_parser< Date_t >()[ dateValue( self.b ) ] >> ')';
-
-                regex = regexS | regexT;
-                regexS = ch_p( '{' ) >> "\"$regex\"" >> ':' >> str[ regexValue( self.b ) ] >> ',' >> "\"$options\"" >> ':' >> lexeme_d[ '"' >> ( *( alpha_p ) )[ regexOptions( self.b ) ] >> '"' ] >> '}';
-                // FIXME Obviously it would be nice to unify this with str.
-                regexT = lexeme_d[ ch_p( '/' )[ chClear( self.b ) ] >>
-                                   *( ( ch_p( '\\' ) >>
-                                        ( ch_p( '"' )[ chE( self.b ) ] |
-                                          ch_p( '\\' )[ chE( self.b ) ] |
-                                          ch_p( '/' )[ chE( self.b ) ] |
-                                          ch_p( 'b' )[ chE( self.b ) ] |
-                                          ch_p( 'f' )[ chE( self.b ) ] |
-                                          ch_p( 'n' )[ chE( self.b ) ] |
-                                          ch_p( 'r' )[ chE( self.b ) ] |
-                                          ch_p( 't' )[ chE( self.b ) ] |
-                                          ( ch_p( 'u' ) >> ( repeat_p( 4 )[ xdigit_p ][ chU( self.b ) ] ) ) ) ) |
-                                      ( ~range_p( 0x00, 0x1f ) & ~ch_p( '/' ) & ( ~ch_p( '\\' ) )[ ch( self.b ) ] ) ) >> str_p( "/" )[ regexValue( self.b ) ]
-                                   >> ( *( ch_p( 'i' ) | ch_p( 'g' ) | ch_p( 'm' ) ) )[ regexOptions( self.b ) ] ];
+        /* a \uXXXX escape, with _p after the 'u'.  written as utf8.  @return false, consuming
+           nothing, if four hex digits don't follow.
+        */
+        bool unicode( BufBuilder &out ) {
+            for ( int i = 0; i < 4; i++ )
+                if ( !_chars.is( _p[ i ], JsonChars::Hex ) )
+                    return false;
+            unsigned char first = hex::val( _p );
+            unsigned char second = hex::val( _p + 2 );
+            _p += 4;
+            if ( first == 0 && second < 0x80 )
+                out.append( (char) second );
+            else if ( first < 0x08 ) {
+                out.append( char( 0xc0 | ( ( first << 2 ) | ( second >> 6 ) ) ) );
+                out.append( char( 0x80 | ( ~0xc0 & second ) ) );
+            } else {
+                out.append( char( 0xe0 | ( first >> 4 ) ) );
+                out.append( char( 0x80 | ( ~0xc0 & ( ( first << 2 ) | ( second >> 6 ) ) ) ) );
+                out.append( char( 0x80 | ( ~0xc0 & second ) ) );
             }
-            rule< ScannerT > object, members, array, elements, value, str, number, integer,
-            dbref, dbrefS, dbrefT, oid, oidS, oidT, bindata, date, dateS, dateT,
-            regex, regexS, regexT, quotedOid, fieldName, unquotedFieldName, singleQuoteStr;
-            const rule< ScannerT > &start() const {
-                return object;
+            return true;
+        }
+
+        /* a double quoted string into s */
+        bool quotedString( string &s ) {
+            skipWs();
+            if ( *_p != '"' )
+                return false;
+            BufBuilder b( 64 );
+            if ( !readString( '"', b ) )
+                return false;
+            s = string( b.buf(), b.len() );
+            return true;
+        }
+
+        void stringValue( const char *fieldName ) {
+            header( String, fieldName );
+            int sizeOfs = _b.len();
+            _b.skip( 4 );
+            int start = _b.len();
+            if ( !readString( *_p, _b ) )
+                fail();
+            // a \u0000 ends the value, as it always has
+            const char *s = _b.buf() + start;
+            const char *z = (const char *) memchr( s, 0, _b.len() - start );
+            if ( z )
+                _b.setlen( start + ( z - s ) );
+            _b.append( (char) 0 );
+            *( (int *) ( _b.buf() + sizeOfs ) ) = _b.len() - start;
+        }
+
+        void appendDBRef( const char *fieldName, const string &ns, const OID &oid ) {
+            header( DBRef, fieldName );
+            _b.append( (int) strlen( ns.c_str() ) + 1 );
+            _b.append( ns.c_str() );
+            _b.append( (void *) &oid, 12 );
+        }
+
+        /* "<24 hex digits>" */
+        bool quotedOid( OID &oid ) {
+            skipWs();
+            if ( *_p != '"' )
+                return false;
+            for ( int i = 1; i <= 24; i++ )
+                if ( !_chars.is( _p[ i ], JsonChars::Hex ) )
+                    return false;
+            if ( _p[ 25 ] != '"' )
+                return false;
+            oid = stringToOid( _p + 1 );
+            _p += 26;
+            return true;
+        }
+
+        /* an unsigned decimal that fits in a Date_t */
+        bool dateValue( unsigned long long &d ) {
+            skipWs();
+            if ( !_chars.is( *_p, JsonChars::Digit ) )
+                return false;
+            d = 0;
+            while ( _chars.is( *_p, JsonChars::Digit ) ) {
+                unsigned digit = *_p++ - '0';
+                if ( d > ( ~0ULL - digit ) / 10 )
+                    return false;
+                d = d * 10 + digit;
             }
-        };
-        ObjectBuilder &b;
+            return true;
+        }
+
+        /* Date( <millis> ), with any "new" already consumed */
+        bool dateCall( const char *fieldName ) {
+            unsigned long long d;
+            if ( !accept( "Date" ) || !accept( '(' ) || !dateValue( d ) || !accept( ')' ) )
+                return false;
+            header( Date, fieldName );
+            _b.append( d );
+            return true;
+        }
+
+        /* /regex/options, with _p at the opening slash */
+        bool regex( const char *fieldName ) {
+            BufBuilder re( 64 );
+            _p++;
+            while ( 1 ) {
+                const char *run = _p;
+                while ( !_chars.is( *_p, JsonChars::StopRegex ) )
+                    _p++;
+                if ( _p != run )
+                    re.append( (void *) run, _p - run );
+                if ( *_p == '/' )
+                    break;
+                if ( *_p != '\\' )
+                    return false;
+                char c = *++_p;
+                _p++;
+                switch ( c ) {
+                case '"': case '\\': case '/': re.append( c ); break;
+                case 'b': re.append( '\b' ); break;
+                case 'f': re.append( '\f' ); break;
+                case 'n': re.append( '\n' ); break;
+                case 'r': re.append( '\r' ); break;
+                case 't': re.append( '\t' ); break;
+                case 'u':
+                    if ( !unicode( re ) )
+                        return false;
+                    break;
+                default:
+                    return false;
+                }
+            }
+            _p++;
+            re.append( (char) 0 );
+            const char *o = _p;
+            while ( *_p == 'i' || *_p == 'g' || *_p == 'm' )
+                _p++;
+            string options( o, _p - o );
+            header( RegEx, fieldName );
+            _b.append( (const char *) re.buf() );
+            _b.append( options.c_str() );
+            return true;
+        }
+
+        /* { "$oid" : ... }, { "$ref" : ..., "$id" : ... }, { "$binary" : ..., "$type" : ... },
+           { "$date" : ... } and { "$regex" : ..., "$options" : ... }.  _p is at the '{'.
+           @return false, consuming nothing, if what follows is some other object.
+        */
+        bool extendedObject( const char *fieldName ) {
+            const char *save = _p;
+            _p++;
+            skipWs();
+            if ( _p[ 0 ] == '"' && _p[ 1 ] == '$' ) {
+                bool ok = false;
+                switch ( _p[ 2 ] ) {
+                case 'o': ok = oidObject( fieldName ); break;
+                case 'r': ok = dbrefObject( fieldName ) || regexObject( fieldName ); break;
+                case 'b': ok = binDataObject( fieldName ); break;
+                case 'd': ok = dateObject( fieldName ); break;
+                }
+                if ( ok )
+                    return true;
+            }
+            _p = save;
+            return false;
+        }
+
+        bool oidObject( const char *fieldName ) {
+            OID oid;
+            if ( !accept( "\"$oid\"" ) || !accept( ':' ) || !quotedOid( oid ) || !accept( '}' ) )
+                return false;
+            _b.append( (char) jstOID );
+            _b.append( fieldName );
+            _b.append( (void *) &oid, 12 );
+            return true;
+        }
+
+        bool dbrefObject( const char *fieldName ) {
+            const char *save = _p;
+            string ns;
+            OID oid;
+            if ( !accept( "\"$ref\"" ) || !accept( ':' ) || !quotedString( ns ) || !accept( ',' ) ||
+                 !accept( "\"$id\"" ) || !accept( ':' ) || !quotedOid( oid ) || !accept( '}' ) ) {
+                _p = save;
+                return false;
+            }
+            appendDBRef( fieldName, ns, oid );
+            return true;
+        }
+
+        bool binDataObject( const char *fieldName ) {
+            if ( !accept( "\"$binary\"" ) || !accept( ':' ) || !accept( '"' ) )
+                return false;
+            const char *s = _p;
+            while ( _chars.is( *_p, JsonChars::Base64 ) )
+                _p++;
+            while ( *_p == '=' )
+                _p++;
+            massert( 10339 ,  "Badly formatted bindata", ( _p - s ) % 4 == 0 );
+            string data = base64::decode( string( s, _p - s ) );
+            if ( *_p++ != '"' || !accept( ',' ) || !accept( "\"$type\"" ) || !accept( ':' ) || !accept( '"' ) )
+                return false;
+            if ( !_chars.is( _p[ 0 ], JsonChars::Hex ) || !_chars.is( _p[ 1 ], JsonChars::Hex ) || _p[ 2 ] != '"' )
+                return false;
+            BinDataType type = BinDataType( hex::val( _p ) );
+            _p += 3;
+            if ( !accept( '}' ) )
+                return false;
+            header( BinData, fieldName );
+            _b.append( (int) data.length() );
+            _b.append( (char) type );
+            _b.append( (void *) data.data(), data.length() );
+            return true;
+        }
+
+        bool dateObject( const char *fieldName ) {
+            unsigned long long d;
+            if ( !accept( "\"$date\"" ) || !accept( ':' ) || !dateValue( d ) || !accept( '}' ) )
+                return false;
+            header( Date, fieldName );
+            _b.append( d );
+            return true;
+        }
+
+        bool regexObject( const char *fieldName ) {
+            string re;
+            if ( !accept( "\"$regex\"" ) || !accept( ':' ) || !quotedString( re ) || !accept( ',' ) ||
+                 !accept( "\"$options\"" ) || !accept( ':' ) || !accept( '"' ) )
+                return false;
+            const char *o = _p;
+            while ( isalpha( *_p ) )
+                _p++;
+            string options( o, _p - o );
+            if ( *_p++ != '"' || !accept( '}' ) )
+                return false;
+            header( RegEx, fieldName );
+            _b.append( re.c_str() );
+            _b.append( options.c_str() );
+            return true;
+        }
+
+        /* a number with a '.' or an exponent is a double.  otherwise an integer: int if it fits,
+           else long long; more than 19 digits, or a value out of range of long long, is an error.
+        */
+        void number( const char *fieldName ) {
+            const char *s = _p;
+            const char *q = _p;
+            bool negative = false;
+            if ( *q == '-' || *q == '+' )
+                negative = *q++ == '-';
+            const char *digits = q;
+            while ( _chars.is( *q, JsonChars::Digit ) )
+                q++;
+            int nInt = q - digits;
+            int nFrac = 0;
+            bool real = false;
+            if ( *q == '.' ) {
+                real = true;
+                q++;
+                while ( _chars.is( *q, JsonChars::Digit ) ) {
+                    q++;
+                    nFrac++;
+                }
+            }
+            if ( nInt + nFrac == 0 )
+                fail();
+            if ( *q == 'e' || *q == 'E' ) {
+                const char *e = q + 1;
+                if ( *e == '-' || *e == '+' )
+                    e++;
+                if ( _chars.is( *e, JsonChars::Digit ) ) {
+                    real = true;
+                    q = e;
+                    while ( _chars.is( *q, JsonChars::Digit ) )
+                        q++;
+                }
+            }
+            if ( real ) {
+                double d = strtod( s, 0 );
+                _p = q;
+                header( NumberDouble, fieldName );
+                _b.append( d );
+                return;
+            }
+
+            if ( nInt > numeric_limits<long long>::digits10 + 1 )
+                fail();
+            unsigned long long limit = negative ? 1ULL + numeric_limits<long long>::max() : numeric_limits<long long>::max();
+            unsigned long long n = 0;
+            for ( const char *d = digits; d < q; d++ ) {
+                unsigned digit = *d - '0';
+                if ( n > ( limit - digit ) / 10 ) {
+                    _p = d;
+                    fail();
+                }
+                n = n * 10 + digit;
+            }
+            _p = q;
+            long long num = negative ? (long long) ( 0 - n ) : (long long) n;
+            if ( num >= numeric_limits<int>::min() && num <= numeric_limits<int>::max() ) {
+                header( NumberInt, fieldName );
+                _b.append( (int) num );
+            }
+            else {
+                header( NumberLong, fieldName );
+                _b.append( num );
+            }
+        }
+
+        const JsonChars &_chars;
+        const char *_p;
+        BufBuilder _b;     // the object
+        BufBuilder _names; // field names of the objects we're inside, each nul terminated
     };
 
     BSONObj fromjson( const char *str ) {
         if ( ! strlen(str) )
             return BSONObj();
-        ObjectBuilder b;
-        JsonGrammar parser( b );
-        parse_info<> result = parse( str, parser, space_p );
-        if ( !result.full ) {
-            int len = strlen( result.stop );
-            if ( len > 10 )
-                len = 10;
-            stringstream ss;
-            ss << "Failure parsing JSON string near: " << string( result.stop, len );
-            massert( 10340 ,  ss.str(), false );
-        }
-        return b.pop();
+        JsonParser parser( str );
+        return parser.parse();
     }
 
     BSONObj fromjson( const string &str ) {
@@ -66,7 +66,8 @@ namespace mongo {
         where = 0;
     }
 
-    ElementMatcher::ElementMatcher( BSONElement _e , int _op ) : toMatch( _e ) , compareOp( _op ) {
+    ElementMatcher::ElementMatcher( BSONElement _e , int _op ) : toMatch( _e ) , compareOp( _op ) , topSlot( -1 ) , rest( 0 ) {
+        matchType = toMatch.canonicalType();
         if ( _op == BSONObj::opMOD ){
             BSONObj o = _e.embeddedObject().firstElement().embeddedObject();
             mod = o["0"].numberInt();
@@ -296,6 +297,33 @@ namespace mongo {
         }
         
         constrainIndexKey_ = constrainIndexKey;
+        if ( constrainIndexKey_.isEmpty() )
+            compileTopFields();
+    }
+
+    void Matcher::compileTopFields() {
+        for ( unsigned i = 0; i < basics.size(); i++ ) {
+            ElementMatcher& bm = basics[i];
+            // $all, $ne and $nin have their own traversals in matchesDotted()
+            if ( bm.compareOp == BSONObj::opALL || bm.compareOp == BSONObj::NE || bm.compareOp == BSONObj::NIN )
+                continue;
+
+            const char *fieldName = bm.toMatch.fieldName();
+            const char *p = strchr( fieldName, '.' );
+            string top = p ? string( fieldName, p - fieldName ) : string( fieldName );
+
+            unsigned slot = 0;
+            while ( slot < _topFields.size() && _topFields[ slot ] != top )
+                slot++;
+            if ( slot == _topFields.size() ) {
+                if ( slot == MaxTopFields )
+                    continue;
+                _topFields.push_back( top );
+            }
+
+            bm.topSlot = slot;
+            bm.rest = p ? p + 1 : 0;
+        }
     }
 
     inline int Matcher::valuesMatch(const BSONElement& l, const BSONElement& r, int op, const ElementMatcher& bm) {
@@ -336,7 +364,7 @@ namespace mongo {
         }
 
         /* check LT, GTE, ... */
-        if ( l.canonicalType() != r.canonicalType() )
+        if ( l.canonicalType() != bm.matchType )
             return false;
         int c = compareElementValues(l, r);
         if ( c < -1 ) c = -1;
@@ -465,6 +493,11 @@ namespace mongo {
             }
         }
 
+        return matchesElement( e, toMatch, compareOp, em, indexed );
+    }
+
+    /* tail of matchesDotted(), once the element for the field (possibly eoo) has been found */
+    int Matcher::matchesElement(const BSONElement& e, const BSONElement& toMatch, int compareOp, const ElementMatcher& em, bool indexed) {
         if ( compareOp == BSONObj::opEXISTS ) {
             return ( e.eoo() ^ toMatch.boolean() ) ? 1 : -1;
         } else if ( ( e.type() != Array || indexed || compareOp == BSONObj::opSIZE ) &&
@@ -503,6 +536,17 @@ namespace mongo {
         return -1;
     }
 
+    /* same result as matchesDotted(), but starting from the top level element already fetched
+       by matches() */
+    int Matcher::matchesPrefetched(const BSONElement& top, const ElementMatcher& em) {
+        if ( em.rest ) {
+            if ( top.type() != Object && top.type() != Array )
+                return retMissing( em );
+            return matchesDotted( em.rest, em.toMatch, top.embeddedObject(), em.compareOp, em, top.type() == Array );
+        }
+        return matchesElement( top, em.toMatch, em.compareOp, em, false );
+    }
+
     extern int dump;
 
     inline bool regexMatches(RegexMatcher& rm, const BSONElement& e) {
@@ -526,15 +570,35 @@ namespace mongo {
     /* See if an object matches the query.
     */
     bool Matcher::matches(const BSONObj& jsobj ) {
-        /* assuming there is usually only one thing to match.  if more this
-        could be slow sometimes. */
+        /* fetch every top level field the query references in a single pass over the
+           object, rather than one getField() scan per field. */
+        BSONElement tops[ MaxTopFields ];
+        int remaining = _topFields.size();
+        if ( remaining ) {
+            BSONObjIterator i( jsobj );
+            while ( remaining && i.more() ) {
+                BSONElement e = i.next();
+                if ( e.eoo() )
+                    break;
+                const char *fn = e.fieldName();
+                for ( unsigned k = 0; k < _topFields.size(); k++ ) {
+                    if ( tops[ k ].eoo() && strcmp( fn, _topFields[ k ].c_str() ) == 0 ) {
+                        tops[ k ] = e;
+                        remaining--;
+                        break;
+                    }
+                }
+            }
+        }
 
         // check normal non-regex cases:
         for ( unsigned i = 0; i < basics.size(); i++ ) {
             ElementMatcher& bm = basics[i];
             BSONElement& m = bm.toMatch;
             // -1=mismatch. 0=missing element. 1=match
-            int cmp = matchesDotted(m.fieldName(), m, jsobj, bm.compareOp, bm );
+            int cmp = bm.topSlot >= 0 ?
+                matchesPrefetched( tops[ bm.topSlot ], bm ) :
+                matchesDotted(m.fieldName(), m, jsobj, bm.compareOp, bm );
             if ( cmp < 0 )
                 return false;
             if ( cmp == 0 ) {
@@ -55,12 +55,13 @@ namespace mongo {
     class ElementMatcher {
     public:
     
-        ElementMatcher() {
+        ElementMatcher() : topSlot( -1 ) , rest( 0 ) {
         }
         
         ElementMatcher( BSONElement _e , int _op );
         
-        ElementMatcher( BSONElement _e , int _op , const BSONObj& array ) : toMatch( _e ) , compareOp( _op ) {
+        ElementMatcher( BSONElement _e , int _op , const BSONObj& array ) : toMatch( _e ) , compareOp( _op ) , topSlot( -1 ) , rest( 0 ) {
+            matchType = toMatch.canonicalType();
             
             myset.reset( new set<BSONElement,element_lt>() );
             
@@ -83,6 +84,15 @@ namespace mongo {
         BSONType type;
 
         shared_ptr<Matcher> subMatcher;
+
+        /* precompiled by Matcher so documents need not be re-scanned per field:
+             matchType - canonical type of toMatch, the only type $lt/$gt etc. can match
+             topSlot   - index of our top level field in Matcher::_topFields, -1 if not prefetched
+             rest      - for dotted names, the part after the first '.'; 0 otherwise
+        */
+        int matchType;
+        int topSlot;
+        const char *rest;
     };
 
     class Where; // used for $where javascript eval
@@ -112,6 +122,13 @@ namespace mongo {
             const char *fieldName,
             const BSONElement &toMatch, const BSONObj &obj,
             const ElementMatcher&bm);
+
+        int matchesElement(
+            const BSONElement& e,
+            const BSONElement& toMatch,
+            int compareOp, const ElementMatcher& bm, bool indexed);
+
+        int matchesPrefetched(const BSONElement& top, const ElementMatcher& bm);
         
     public:
         static int opDirection(int op) {
@@ -140,10 +157,16 @@ namespace mongo {
 
         int valuesMatch(const BSONElement& l, const BSONElement& r, int op, const ElementMatcher& bm);
 
+        /* assign top level slots to basics so matches() can fetch all the fields a query
+           references in one pass over the document. */
+        void compileTopFields();
+
         Where *where;                    // set if query uses $where
         BSONObj jsobj;                  // the query pattern.  e.g., { name: "joe" }
         BSONObj constrainIndexKey_;
         vector<ElementMatcher> basics;
+        enum { MaxTopFields = 16 };
+        vector<string> _topFields; // distinct top level field names referenced by basics
         bool haveSize;
         bool all;
         bool hasArray;
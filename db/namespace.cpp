@@ -28,6 +28,7 @@
 #include "query.h"
 #include "queryutil.h"
 #include "json.h"
+#include "indexstats.h"
 
 namespace mongo {
 
@@ -168,6 +169,8 @@ namespace mongo {
     */
     DiskLoc NamespaceDetails::alloc(const char *ns, int lenToAlloc, DiskLoc& extentLoc) {
         lenToAlloc = (lenToAlloc + 3) & 0xfffffffc;
+        if ( sizeClasses() )
+            lenToAlloc = sizeClassFor(lenToAlloc);
         DiskLoc loc = _alloc(ns, lenToAlloc);
         if ( loc.isNull() )
             return loc;
@@ -280,6 +283,29 @@ namespace mongo {
         return bestmatch;
     }
 
+    /* for collections with size classes; len is a class size (see sizeClassFor()).
+       returned item is out of the deleted list upon return
+    */
+    DiskLoc NamespaceDetails::__classAlloc(int len) {
+        if ( len > bucketSizes[MaxBucket-1] ) {
+            // the last list holds everything bigger, so its head might not fit
+            return __stdAlloc(len);
+        }
+        for ( int b = bucket(len); b < Buckets; b++ ) {
+            DiskLoc cur = deletedList[b];
+            if ( cur.isNull() )
+                continue;
+            DeletedRecord *r = cur.drec();
+            assert( r->lengthWithHeaders >= len );
+            deletedList[b] = r->nextDeleted;
+            r->nextDeleted.setInvalid(); // defensive.
+            assert( r->extentOfs < cur.getOfs() );
+            return cur;
+        }
+        // out of space. alloc a new extent.
+        return DiskLoc();
+    }
+
     void NamespaceDetails::dumpDeleted(set<DiskLoc> *extents) {
         for ( int i = 0; i < Buckets; i++ ) {
             DiskLoc dl = deletedList[i];
@@ -474,7 +500,7 @@ namespace mongo {
     /* alloc with capped table handling. */
     DiskLoc NamespaceDetails::_alloc(const char *ns, int len) {
         if ( !capped )
-            return __stdAlloc(len);
+            return sizeClasses() ? __classAlloc(len) : __stdAlloc(len);
 
         // capped.
 
@@ -612,6 +638,8 @@ namespace mongo {
         clearQueryCache();
         _keysComputed = false;
         _indexSpecs.clear();
+        _indexStatsLoaded = false;
+        _indexStats.clear();
     }
     
 /*    NamespaceDetailsTransient& NamespaceDetailsTransient::get(const char *ns) {
@@ -621,6 +649,20 @@ namespace mongo {
         return *t;
     }
 */
+    DiskLoc NamespaceDetailsTransient::oplogSampleBefore( unsigned long long ts ) const {
+        // first sample > ts, then back one
+        int l = 0;
+        int h = (int) _oplogSamples.size();
+        while ( l < h ) {
+            int m = ( l + h ) / 2;
+            if ( _oplogSamples[ m ].first <= ts )
+                l = m + 1;
+            else
+                h = m;
+        }
+        return l == 0 ? DiskLoc() : _oplogSamples[ l - 1 ].second;
+    }
+
     void NamespaceDetailsTransient::clearForPrefix(const char *prefix) {
         assertInWriteLock();
         vector< string > found;
@@ -686,7 +728,7 @@ namespace mongo {
        options: { capped : ..., size : ... }
     */
     void addNewNamespaceToCatalog(const char *ns, const BSONObj *options = 0) {
-        log(1) << "New namespace: " << ns << '\n';
+        log(1 , LogStorage) << "New namespace: " << ns << '\n';
         if ( strstr(ns, "system.namespaces") ) {
             // system.namespaces holds all the others, so it is not explicitly listed in the catalog.
             // TODO: fix above should not be strstr!
@@ -717,6 +759,7 @@ namespace mongo {
 		// transient (including query cache) so clear these.
 		ClientCursor::invalidate( from );
 		NamespaceDetailsTransient::clearForPrefix( from );
+		dropIndexStats( from );
 
 		NamespaceDetails *details = ni->details( from );
 		ni->add_ns( to, *details );
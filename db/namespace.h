@@ -19,6 +19,7 @@
 #pragma once
 
 #include "../stdafx.h"
+#include <deque>
 #include "jsobj.h"
 #include "queryutil.h"
 #include "diskloc.h"
@@ -28,6 +29,7 @@
 namespace mongo {
 
     class Cursor;
+    class IndexStats;
 
 #pragma pack(1)
 
@@ -274,7 +276,8 @@ namespace mongo {
         */
         enum NamespaceFlags {
             Flag_HaveIdIndex = 1 << 0, // set when we have _id index (ONLY if ensureIdIndex was called -- 0 if that has never been called)
-            Flag_CappedDisallowDelete = 1 << 1 // set when deletes not allowed during capped table allocation.
+            Flag_CappedDisallowDelete = 1 << 1, // set when deletes not allowed during capped table allocation.
+            Flag_SizeClasses = 1 << 2 // records are allocated in power of 2 size classes; see sizeClassFor()
         };
 
         IndexDetails& idx(int idxNo) {
@@ -410,6 +413,23 @@ namespace mongo {
             return Buckets-1;
         }
 
+        /* with Flag_SizeClasses a record is allocated as the smallest bucket size that holds it.
+           every record on deleted list bucket(c) or above is then at least c long, so alloc() just
+           takes the head of the first nonempty list: no list is walked, and the only data file page
+           touched is the one handed out.  a freed record goes back to the list its class allocates
+           from.  records larger than the biggest class that lists can vouch for are allocated exactly.
+        */
+        bool sizeClasses() const {
+            return ( flags & Flag_SizeClasses ) && !capped;
+        }
+        static int sizeClassFor(int lenWHdr) {
+            if ( lenWHdr > bucketSizes[MaxBucket-1] )
+                return lenWHdr;
+            for ( int i = 0; ; i++ )
+                if ( bucketSizes[i] >= lenWHdr )
+                    return bucketSizes[i];
+        }
+
         /* allocate a new record.  lenToAlloc includes headers. */
         DiskLoc alloc(const char *ns, int lenToAlloc, DiskLoc& extentLoc);
 
@@ -444,6 +464,7 @@ namespace mongo {
         void advanceCapExtent( const char *ns );
         void maybeComplain( const char *ns, int len ) const;
         DiskLoc __stdAlloc(int len);
+        DiskLoc __classAlloc(int len);
         DiskLoc __capAlloc(int len);
         DiskLoc _alloc(const char *ns, int len);
         void compact(); // combine adjacent deleted records
@@ -471,7 +492,7 @@ namespace mongo {
         void reset();
         static std::map< string, shared_ptr< NamespaceDetailsTransient > > _map;
     public:
-        NamespaceDetailsTransient(const char *ns) : _ns(ns), _keysComputed(false), _qcWriteCount(), _cll_enabled() { }
+        NamespaceDetailsTransient(const char *ns) : _ns(ns), _keysComputed(false), _qcWriteCount(), _indexStatsLoaded(false), _cll_enabled() { }
         /* _get() is not threadsafe */
         static NamespaceDetailsTransient& _get(const char *ns);
         /* use get_w() when doing write operations */
@@ -547,6 +568,19 @@ namespace mongo {
             _qcCache[ pattern ] = make_pair( indexKey, nScanned );
         }
 
+        /* index statistics from the analyze command (see indexstats.h) ------------ */
+        /* you must be in the qcMutex when calling these */
+    private:
+        bool _indexStatsLoaded;
+        map< string, shared_ptr< IndexStats > > _indexStats; // by index name
+    public:
+        bool indexStatsLoaded() const { return _indexStatsLoaded; }
+        const map< string, shared_ptr< IndexStats > >& indexStats() const { return _indexStats; }
+        void setIndexStats( const map< string, shared_ptr< IndexStats > > &stats ) {
+            _indexStats = stats;
+            _indexStatsLoaded = true;
+        }
+
         /* for collection-level logging -- see CmdLogCollection ----------------- */ 
         /* assumed to be in write lock for this */
     private:
@@ -560,6 +594,26 @@ namespace mongo {
         void cllInvalidate();
         bool cllValidateComplete();
 
+        /* oplog start positions -------------------------------------------------
+           a sparse map from op timestamp to the extent it was written into, sampled by
+           fast_oplog_insert() so an OplogReplay query can start near { ts : { $gte : x } }
+           without scanning back through the oplog.  samples may go stale as the capped
+           collection wraps; callers must check what they find.
+           in the write lock, or _qcMutex with get_inlock(), for these
+        */
+    private:
+        deque< pair< unsigned long long, DiskLoc > > _oplogSamples; // ascending ts
+    public:
+        enum { OplogSampleEvery = 256, OplogSamplesMax = 65536 };
+        void sampleOplog( unsigned long long ts, const DiskLoc& extent ) {
+            if ( _oplogSamples.size() >= OplogSamplesMax )
+                _oplogSamples.pop_front();
+            _oplogSamples.push_back( make_pair( ts, extent ) );
+        }
+        /* @return extent of the newest sample with a ts <= ts, or null */
+        DiskLoc oplogSampleBefore( unsigned long long ts ) const;
+        void clearOplogSamples() { _oplogSamples.clear(); }
+
     }; /* NamespaceDetailsTransient */
 
     inline NamespaceDetailsTransient& NamespaceDetailsTransient::_get(const char *ns) {
@@ -41,6 +41,9 @@ _ disallow system* manipulations from the database.
 #include "extsort.h"
 #include "curop.h"
 #include "background.h"
+#include "indexstats.h"
+#include "../util/file.h"
+#include "../util/thread_pool.h"
 
 namespace mongo {
 
@@ -96,7 +99,7 @@ namespace mongo {
     void ensureIdIndexForNewNs(const char *ns) {
         if ( ( strstr( ns, ".system." ) == 0 || legalClientSystemNS( ns , false ) ) &&
              strstr( ns, ".$freelist" ) == 0 ){
-            log( 1 ) << "adding _id index for new collection" << endl;
+            log( 1 , LogStorage ) << "adding _id index for new collection" << endl;
             ensureHaveIdIndex( ns );
         }        
     }
@@ -134,13 +137,13 @@ namespace mongo {
         return z;
     }
 
-    bool _userCreateNS(const char *ns, const BSONObj& j, string& err) {
+    bool _userCreateNS(const char *ns, const BSONObj& j, string& err, bool *deferIdIndex = 0) {
         if ( nsdetails(ns) ) {
             err = "collection already exists";
             return false;
         }
 
-        log(1) << "create collection " << ns << ' ' << j << '\n';
+        log(1 , LogStorage) << "create collection " << ns << ' ' << j << '\n';
 
         /* todo: do this only when we have allocated space successfully? or we could insert with a { ok: 0 } field
            and then go back and set to ok : 1 after we are done.
@@ -201,14 +204,19 @@ namespace mongo {
         NamespaceDetails *d = nsdetails(ns);
         assert(d);
 
-        if ( j.getField( "autoIndexId" ).type() ) {
-            if ( j["autoIndexId"].trueValue() ){
-                ensureIdIndexForNewNs( ns );
-            }
-        } else {
-            if ( !newCapped ) {
+        bool wantIdIndex = j.getField( "autoIndexId" ).type() ? j["autoIndexId"].trueValue() : !newCapped;
+        if ( wantIdIndex ) {
+            if ( deferIdIndex )
+                *deferIdIndex = true;
+            else
                 ensureIdIndexForNewNs( ns );
-            }
+        }
+
+        if ( !newCapped ) {
+            e = j.getField( "sizeClasses" );
+            bool userNs = strstr( ns, ".system." ) == 0 && strchr( ns, '$' ) == 0;
+            if ( e.type() ? e.trueValue() : ( cmdLine.sizeClasses && userNs ) )
+                d->flags |= NamespaceDetails::Flag_SizeClasses;
         }
 
         if ( mx > 0 )
@@ -219,12 +227,12 @@ namespace mongo {
 
     // { ..., capped: true, size: ..., max: ... }
     // returns true if successful
-    bool userCreateNS(const char *ns, BSONObj j, string& err, bool logForReplication) {
+    bool userCreateNS(const char *ns, BSONObj j, string& err, bool logForReplication, bool *deferIdIndex) {
         const char *coll = strchr( ns, '.' ) + 1;
         massert( 10356 ,  "invalid ns", coll && *coll );
         char cl[ 256 ];
         nsToDatabase( ns, cl );
-        bool ok = _userCreateNS(ns, j, err);
+        bool ok = _userCreateNS(ns, j, err, deferIdIndex);
         if ( logForReplication && ok ) {
             if ( j.getField( "create" ).eoo() ) {
                 BSONObjBuilder b;
@@ -312,7 +320,7 @@ namespace mongo {
             return;
         }
         
-        header = (MDFHeader *) mmf.map(filename, size);
+        header = (MDFHeader *) mmf.map(filename, size, cmdLine.randomReadahead ? MemoryMappedFile::RANDOM : 0);
         if( sizeof(char *) == 4 ) 
             uassert( 10084 , "can't map file memory - mongo requires 64 bit build for larger datasets", header);
         else
@@ -437,7 +445,7 @@ namespace mongo {
     /*---------------------------------------------------------------------*/
 
     DiskLoc Extent::reuse(const char *nsname) { 
-        log(3) << "reset extent was:" << nsDiagnostic.buf << " now:" << nsname << '\n';
+        log(3 , LogStorage) << "reset extent was:" << nsDiagnostic.buf << " now:" << nsname << '\n';
         massert( 10360 ,  "Extent::reset bad magic value", magic == 0x41424344 );
         xnext.Null();
         xprev.Null();
@@ -623,12 +631,26 @@ namespace mongo {
         log() << "  end freelist" << endl;
     }
 
+    /* the database's list of free extents, created if need be */
+    static NamespaceDetails* freeListDetails() {
+        string s = cc().database()->name + ".$freelist";
+        NamespaceDetails *freeExtents = nsdetails(s.c_str());
+        if( freeExtents == 0 ) { 
+            string err;
+            _userCreateNS(s.c_str(), BSONObj(), err);
+            freeExtents = nsdetails(s.c_str());
+            massert( 10361 , "can't create .$freelist", freeExtents);
+        }
+        return freeExtents;
+    }
+
     /* drop a collection/namespace */
     void dropNS(const string& nsToDrop) {
         NamespaceDetails* d = nsdetails(nsToDrop.c_str());
         uassert( 10086 ,  (string)"ns not found: " + nsToDrop , d );
 
         BackgroundOperation::assertNoBgOpInProgForNs(nsToDrop.c_str());
+        NamespaceDetailsTransient::get_w( nsToDrop.c_str() ).clearOplogSamples();
 
         NamespaceString s(nsToDrop);
         assert( s.db == cc().database()->name );
@@ -639,6 +661,8 @@ namespace mongo {
                 uasserted( 12502, "can't drop system ns" );
         }
 
+        dropIndexStats( nsToDrop.c_str() );
+
         {
             // remove from the system catalog
             BSONObj cond = BSON( "name" << nsToDrop );   // { name: "colltodropname" }
@@ -649,14 +673,7 @@ namespace mongo {
 
         // free extents
         if( !d->firstExtent.isNull() ) {
-            string s = cc().database()->name + ".$freelist";
-            NamespaceDetails *freeExtents = nsdetails(s.c_str());
-            if( freeExtents == 0 ) { 
-                string err;
-                _userCreateNS(s.c_str(), BSONObj(), err);
-                freeExtents = nsdetails(s.c_str());
-                massert( 10361 , "can't create .$freelist", freeExtents);
-            }
+            NamespaceDetails *freeExtents = freeListDetails();
             if( freeExtents->firstExtent.isNull() ) { 
                 freeExtents->firstExtent = d->firstExtent;
                 freeExtents->lastExtent = d->lastExtent;
@@ -678,7 +695,7 @@ namespace mongo {
     }
 
     void dropCollection( const string &name, string &errmsg, BSONObjBuilder &result ) {
-        log(1) << "dropCollection: " << name << endl;
+        log(1 , LogStorage) << "dropCollection: " << name << endl;
         NamespaceDetails *d = nsdetails(name.c_str());
         assert( d );
 
@@ -693,7 +710,7 @@ namespace mongo {
             }
             assert( d->nIndexes == 0 );
         }
-        log(1) << "\t dropIndexes done" << endl;
+        log(1 , LogStorage) << "\t dropIndexes done" << endl;
         result.append("ns", name.c_str());
         ClientCursor::invalidate(name.c_str());
         dropNS(name);        
@@ -746,8 +763,8 @@ namespace mongo {
     /* deletes a record, just the pdfile portion -- no index cleanup, no cursor cleanup, etc. 
        caller must check if capped
     */
-    void DataFileMgr::_deleteRecord(NamespaceDetails *d, const char *ns, Record *todelete, const DiskLoc& dl)
-    {
+    /* take a record out of its extent's record list.  its space is not freed. */
+    static void removeRecordFromExtent(Record *todelete, const DiskLoc& dl) {
         /* remove ourself from the record next/prev chain */
         {
             if ( todelete->prevOfs != DiskLoc::NullOfs )
@@ -772,6 +789,27 @@ namespace mongo {
                     e->lastRecord.setOfs(dl.a(), todelete->prevOfs);
             }
         }
+    }
+
+    /* append a newly allocated record to its extent's record list */
+    static void addRecordToExtent(Record *r, const DiskLoc& loc) {
+        Extent *e = r->myExtent(loc);
+        if ( e->lastRecord.isNull() ) {
+            e->firstRecord = e->lastRecord = loc;
+            r->prevOfs = r->nextOfs = DiskLoc::NullOfs;
+        }
+        else {
+            Record *oldlast = e->lastRecord.rec();
+            r->prevOfs = e->lastRecord.getOfs();
+            r->nextOfs = DiskLoc::NullOfs;
+            oldlast->nextOfs = loc.getOfs();
+            e->lastRecord = loc;
+        }
+    }
+
+    void DataFileMgr::_deleteRecord(NamespaceDetails *d, const char *ns, Record *todelete, const DiskLoc& dl)
+    {
+        removeRecordFromExtent(todelete, dl);
 
         /* add to the free list */
         {
@@ -804,7 +842,7 @@ namespace mongo {
         }
 
         /* check if any cursors point to us.  if so, advance them. */
-        ClientCursor::aboutToDelete(dl);
+        ClientCursor::aboutToDelete(ns, dl);
 
         unindexRecord(d, todelete, dl, noWarn);
 
@@ -813,6 +851,129 @@ namespace mongo {
     }
 
 
+    int followupExtentSize(int len, int lastExtentLen);
+
+    /* lengthWithHeaders to allocate for a record of len bytes */
+    static int paddedLength(NamespaceDetails *d, int len) {
+        int lenWHdr = len + Record::HeaderSize;
+        if ( !d->sizeClasses() ) { // rounding up to a size class is padding enough
+            lenWHdr = (int) (lenWHdr * d->paddingFactor);
+            if ( lenWHdr == 0 ) {
+                // old datafiles, backward compatible here.
+                assert( d->paddingFactor == 0 );
+                d->paddingFactor = 1.0;
+                lenWHdr = len + Record::HeaderSize;
+            }
+        }
+        return lenWHdr;
+    }
+
+    /* allocate a record, adding extents if a collection that isn't capped is out of space.
+       @return null if a capped collection has no room
+    */
+    static DiskLoc allocRecord(const char *ns, NamespaceDetails *d, int len, int lenWHdr) {
+        DiskLoc extentLoc;
+        DiskLoc loc = d->alloc(ns, lenWHdr, extentLoc);
+        if ( loc.isNull() ) {
+            // out of space
+            if ( d->capped == 0 ) { // size capped doesn't grow
+                log(1 , LogStorage) << "allocating new extent for " << ns << " padding:" << d->paddingFactor << " lenWHdr: " << lenWHdr << endl;
+                cc().database()->allocExtent(ns, followupExtentSize(lenWHdr, d->lastExtentSize), false);
+                loc = d->alloc(ns, lenWHdr, extentLoc);
+                if ( loc.isNull() ){
+                    log() << "WARNING: alloc() failed after allocating new extent. lenWHdr: " << lenWHdr << " last extent size:" << d->lastExtentSize << "; trying again\n";
+                    for ( int zzz=0; zzz<10 && lenWHdr > d->lastExtentSize; zzz++ ){
+                        log() << "try #" << zzz << endl;
+                        cc().database()->allocExtent(ns, followupExtentSize(len, d->lastExtentSize), false);
+                        loc = d->alloc(ns, lenWHdr, extentLoc);
+                        if ( ! loc.isNull() )
+                            break;
+                    }
+                }
+            }
+            if ( loc.isNull() ) {
+                log() << "out of space in datafile " << ns << " capped:" << d->capped << endl;
+                assert(d->capped);
+            }
+        }
+        return loc;
+    }
+
+    /* a record moved from dl to newLoc: repoint idx's entry for key, or if that would put it out
+       of order, unindex and reinsert it */
+    static void moveIndexEntry(IndexDetails& idx, BSONObj& key, const DiskLoc& dl, const DiskLoc& newLoc) {
+        if ( idx.head.btree()->repoint(idx.head, idx, key, dl, newLoc) )
+            return;
+        idx.head.btree()->unindex(idx.head, idx, key, dl);
+        idx.head.btree()->bt_insert(idx.head, newLoc, key, Ordering::make(idx.keyPattern()), /*dupsAllowed*/true, idx);
+    }
+
+    /* move an updated record's index entries from dl to newLoc.  keys the update keeps are
+       repointed; removed keys are unindexed and added ones inserted.  dupCheck() has been run.
+    */
+    static void moveIndexChanges(NamespaceDetails& d, vector<IndexChanges>& changes, const DiskLoc& dl, const DiskLoc& newLoc, StringBuilder& ss) {
+        int z = d.nIndexesBeingBuilt();
+        for ( int x = 0; x < z; x++ ) {
+            IndexDetails& idx = d.idx(x);
+            IndexChanges& ch = changes[x];
+            // removed is in oldkeys order
+            vector<BSONObj*>::iterator r = ch.removed.begin();
+            for ( BSONObjSetDefaultOrder::iterator i = ch.oldkeys.begin(); i != ch.oldkeys.end(); i++ ) {
+                BSONObj& key = (BSONObj&) *i;
+                try {
+                    if ( r != ch.removed.end() && *r == &key ) {
+                        r++;
+                        idx.head.btree()->unindex(idx.head, idx, key, dl);
+                    }
+                    else {
+                        moveIndexEntry(idx, key, dl, newLoc);
+                    }
+                }
+                catch (AssertionException&) {
+                    ss << " exception update move index ";
+                    problem() << " caught assertion moving index entries " << idx.indexNamespace() << endl;
+                }
+            }
+            Ordering idxKey = Ordering::make(idx.keyPattern());
+            for ( unsigned i = 0; i < ch.added.size(); i++ ) {
+                try {
+                    idx.head.btree()->bt_insert(idx.head, newLoc, *ch.added[i], idxKey, /*dupsAllowed*/true, idx);
+                }
+                catch (AssertionException&) {
+                    ss << " exception update index ";
+                    problem() << " caught assertion update index " << idx.indexNamespace() << endl;
+                }
+            }
+        }
+    }
+
+    /* put an in place update's index entries back as they were.  keys added to indexes before x,
+       and the first n keys added to index x, are removed; keys removed from those indexes go back.
+    */
+    static void undoIndexChanges(NamespaceDetails& d, vector<IndexChanges>& changes, int x, unsigned n, const DiskLoc& dl) {
+        for ( int j = 0; j <= x; j++ ) {
+            IndexDetails& idx = d.idx(j);
+            Ordering idxKey = Ordering::make(idx.keyPattern());
+            unsigned nAdded = j < x ? changes[j].added.size() : n;
+            for ( unsigned i = 0; i < nAdded; i++ ) {
+                try {
+                    idx.head.btree()->unindex(idx.head, idx, *changes[j].added[i], dl);
+                }
+                catch (AssertionException&) {
+                    problem() << " caught assertion undoing update index " << idx.indexNamespace() << endl;
+                }
+            }
+            for ( unsigned i = 0; i < changes[j].removed.size(); i++ ) {
+                try {
+                    idx.head.btree()->bt_insert(idx.head, dl, *changes[j].removed[i], idxKey, /*dupsAllowed*/true, idx);
+                }
+                catch (AssertionException&) {
+                    problem() << " caught assertion undoing update unindex " << idx.indexNamespace() << endl;
+                }
+            }
+        }
+    }
+
     /** Note: if the object shrinks a lot, we don't free up space, we leave extra at end of the record.
      */
     const DiskLoc DataFileMgr::updateRecord(
@@ -820,7 +981,7 @@ namespace mongo {
         NamespaceDetails *d,
         NamespaceDetailsTransient *nsdt,
         Record *toupdate, const DiskLoc& dl,
-        const char *_buf, int _len, OpDebug& debug)
+        const char *_buf, int _len, OpDebug& debug, unsigned long long keysMayChange)
     {
         StringBuilder& ss = debug.str;
         dassert( toupdate == dl.rec() );
@@ -843,21 +1004,36 @@ namespace mongo {
             objNew = b.obj();
         }
 
-        /* duplicate key check. we descend the btree twice - once for this check, and once for the actual inserts, further  
-           below.  that is suboptimal, but it's pretty complicated to do it the other way without rollbacks...
-        */
+        bool moving = toupdate->netLength() < objNew.objsize();
+        if ( moving )
+            uassert( 10003 , "E10003 failing update: objects in a capped ns cannot grow", !(d && d->capped));
+
         vector<IndexChanges> changes;
-        getIndexChanges(changes, *d, objNew, objOld);
-        dupCheck(changes, *d, dl);
+        getIndexChanges(changes, *d, objNew, objOld, keysMayChange, moving);
 
-        if ( toupdate->netLength() < objNew.objsize() ) {
+        if ( moving ) {
             // doesn't fit.  reallocate -----------------------------------------------------
-            uassert( 10003 , "E10003 failing update: objects in a capped ns cannot grow", !(d && d->capped));
+            /* the index entries are moved over in place, so check for duplicates first.  a
+               separate descent, but only for keys the update adds. */
+            dupCheck(changes, *d, dl);
             d->paddingTooSmall();
             if ( cc().database()->profile )
                 ss << " moved ";
-            deleteRecord(ns, toupdate, dl);
-            return insert(ns, objNew.objdata(), objNew.objsize(), false);
+
+            DiskLoc loc = allocRecord(ns, d, objNew.objsize(), paddedLength(d, objNew.objsize()));
+            assert( !loc.isNull() ); // not capped
+            BSONElementManipulator::lookForTimestamps( objNew ); // as insert() did
+            Record *r = loc.rec();
+            memcpy(r->data, objNew.objdata(), objNew.objsize());
+            addRecordToExtent(r, loc);
+            d->nrecords++;
+            d->datasize += r->netLength();
+
+            ClientCursor::aboutToDelete(ns, dl);
+            moveIndexChanges(*d, changes, dl, loc, ss);
+            _deleteRecord(d, ns, toupdate, dl);
+            nsdt->notifyOfWriteOp();
+            return loc;
         }
 
         nsdt->notifyOfWriteOp();
@@ -879,16 +1055,20 @@ namespace mongo {
                     }
                 }
                 assert( !dl.isNull() );
-                BSONObj idxKey = idx.info.obj().getObjectField("key");
+                Ordering idxKey = Ordering::make(idx.info.obj().getObjectField("key"));
                 keyUpdates += changes[x].added.size();
                 for ( unsigned i = 0; i < changes[x].added.size(); i++ ) {
                     try {
-                        /* we did the dupCheck() above.  so we don't have to worry about it here. */
+                        /* a unique index checks for a duplicate in the descent that inserts */
                         idx.head.btree()->bt_insert(
                                                     idx.head,
-                                                    dl, *changes[x].added[i], idxKey, /*dupsAllowed*/true, idx);
+                                                    dl, *changes[x].added[i], idxKey, /*dupsAllowed*/!idx.unique(), idx);
                     }
-                    catch (AssertionException&) {
+                    catch (AssertionException& e) {
+                        if ( e.code == ASSERT_ID_DUPKEY ) {
+                            undoIndexChanges(*d, changes, x, i, dl);
+                            throw; // keep ASSERT_ID_DUPKEY, it's what drivers look for
+                        }
                         ss << " exception update index ";
                         out() << " caught assertion update index " << idx.indexNamespace() << '\n';
                         problem() << " caught assertion update index " << idx.indexNamespace() << endl;
@@ -917,8 +1097,9 @@ namespace mongo {
     static inline void  _indexRecord(NamespaceDetails *d, int idxNo, BSONObj& obj, DiskLoc recordLoc, bool dupsAllowed) {
         IndexDetails& idx = d->idx(idxNo);
         BSONObjSetDefaultOrder keys;
-        idx.getKeysFromObject(obj, keys);
-        BSONObj order = idx.keyPattern();
+        const IndexSpec& spec = idx.getSpec();
+        spec.getKeys(obj, keys);
+        const Ordering& order = spec.ordering;
         int n = 0;
         for ( BSONObjSetDefaultOrder::iterator i=keys.begin(); i != keys.end(); i++ ) {
             if( ++n == 2 ) { 
@@ -1050,7 +1231,7 @@ namespace mongo {
             wassert( btBuilder.getn() == nkeys || dropDups ); 
         }
         
-        log(1) << "\t fastBuildIndex dupsToDrop:" << dupsToDrop.size() << endl;
+        log(1 , LogStorage) << "\t fastBuildIndex dupsToDrop:" << dupsToDrop.size() << endl;
 
         for( list<DiskLoc>::iterator i = dupsToDrop.begin(); i != dupsToDrop.end(); i++ )
             theDataFileMgr.deleteRecord( ns, i->rec(), *i, false, true );
@@ -1165,7 +1346,7 @@ namespace mongo {
         BSONObj info = idx.info.obj();
         bool background = info["background"].trueValue();
         if( background ) {
-            log(2) << "buildAnIndex: background=true\n";
+            log(2 , LogStorage) << "buildAnIndex: background=true\n";
         }
 
         assert( !BackgroundOperation::inProgForNs(ns.c_str()) ); // should have been checked earlier, better not be...
@@ -1198,14 +1379,439 @@ namespace mongo {
                         _unindexRecord(d->idx(j), obj, loc, false);
                     }
                     catch(...) { 
-                        log(3) << "unindex fails on rollback after unique failure\n";
+                        log(3 , LogStorage) << "unindex fails on rollback after unique failure\n";
+                    }
+                }
+                throw;
+            }
+        }
+    }
+
+    /* -- online compaction ------------------------------------------------------------------
+
+       the compact command empties a collection's last extent by moving its records into free space
+       in the other extents, then hands the extent back to the database's .$freelist.  that repeats,
+       from the tail toward the front, while the rest of the collection has room.  the lock is
+       released every batch records through a ClientCursor, as a background index build does.
+    */
+
+    /* walks d's free lists.  if unlink, the deleted records in extent ext are taken off them.
+       @return bytes of free space outside ext */
+    static long long deletedOutsideExtent(NamespaceDetails *d, const DiskLoc& ext, bool unlink) {
+        long long outside = 0;
+        for ( int b = 0; b < Buckets; b++ ) {
+            DiskLoc *prev = &d->deletedList[b];
+            DiskLoc cur = *prev;
+            while ( !cur.isNull() ) {
+                DeletedRecord *r = cur.drec();
+                if ( DiskLoc(cur.a(), r->extentOfs) != ext ) {
+                    outside += r->lengthWithHeaders;
+                    prev = &r->nextDeleted;
+                }
+                else if ( unlink ) {
+                    *prev = r->nextDeleted;
+                }
+                cur = r->nextDeleted;
+            }
+        }
+        return outside;
+    }
+
+    /* allocate for ns anywhere but extent ext, without adding an extent.  space handed out from
+       ext (a delete there while we yielded puts some back on the free list) is simply dropped: it
+       goes back with the extent. */
+    static DiskLoc allocOutsideExtent(NamespaceDetails *d, const char *ns, int lenWHdr, const DiskLoc& ext) {
+        while ( 1 ) {
+            DiskLoc extentLoc;
+            DiskLoc loc = d->alloc(ns, lenWHdr, extentLoc);
+            if ( loc.isNull() || extentLoc != ext )
+                return loc;
+        }
+    }
+
+    /* move the record at dl out of extent ext, fixing up the indexes and any cursors on it.
+       @return false if there was no room elsewhere */
+    static bool moveRecordOutOfExtent(NamespaceDetails *d, const char *ns, const DiskLoc& dl, const DiskLoc& ext) {
+        Record *r = dl.rec();
+        BSONObj obj(r);
+        int lenWHdr = obj.objsize() + Record::HeaderSize;
+        if ( !d->sizeClasses() && d->paddingFactor > 1.0 )
+            lenWHdr = (int) ( lenWHdr * d->paddingFactor );
+        DiskLoc loc = allocOutsideExtent(d, ns, lenWHdr, ext);
+        if ( loc.isNull() )
+            return false;
+
+        Record *moved = loc.rec();
+        memcpy(moved->data, obj.objdata(), obj.objsize());
+        addRecordToExtent(moved, loc);
+
+        ClientCursor::aboutToDelete(ns, dl);
+        int n = d->nIndexes;
+        for ( int i = 0; i < n; i++ ) {
+            IndexDetails& idx = d->idx(i);
+            BSONObjSetDefaultOrder keys;
+            idx.getKeysFromObject(obj, keys);
+            for ( BSONObjSetDefaultOrder::iterator k = keys.begin(); k != keys.end(); k++ )
+                moveIndexEntry(idx, (BSONObj&) *k, dl, loc);
+        }
+
+        removeRecordFromExtent(r, dl);
+        d->datasize += moved->netLength() - r->netLength();
+        return true;
+    }
+
+    /* the moves out of e stopped part way.  everything in it that is not a live record -- space we
+       moved records out of, and space dropped by allocOutsideExtent -- goes back on the free list. */
+    static void rebuildExtentFreeList(NamespaceDetails *d, Extent *e) {
+        deletedOutsideExtent(d, e->myLoc, true);
+
+        vector< pair<int,int> > used; // ofs, lengthWithHeaders
+        DiskLoc i = e->firstRecord;
+        while ( !i.isNull() ) {
+            Record *r = i.rec();
+            used.push_back( make_pair( i.getOfs(), r->lengthWithHeaders ) );
+            if ( r->nextOfs == DiskLoc::NullOfs )
+                break;
+            i.setOfs( i.a(), r->nextOfs );
+        }
+        sort( used.begin(), used.end() );
+        used.push_back( make_pair( e->myLoc.getOfs() + e->length, 0 ) );
+
+        int ofs = e->myLoc.getOfs() + ( e->extentData - (char *) e );
+        for ( unsigned j = 0; j < used.size(); j++ ) {
+            int gap = used[j].first - ofs;
+            if ( gap >= Record::HeaderSize ) {
+                DiskLoc loc( e->myLoc.a(), ofs );
+                DeletedRecord *dr = loc.drec();
+                dr->lengthWithHeaders = gap;
+                dr->extentOfs = e->myLoc.getOfs();
+                dr->nextDeleted.Null();
+                d->addDeletedRec(dr, loc);
+            }
+            ofs = used[j].first + used[j].second;
+        }
+    }
+
+    /* unlink the empty extent e from d and put it on the database's .$freelist */
+    static void freeEmptyExtent(NamespaceDetails *d, Extent *e) {
+        assert( e->firstRecord.isNull() );
+        if ( e->xprev.isNull() )
+            d->firstExtent = e->xnext;
+        else
+            e->xprev.ext()->xnext = e->xnext;
+        if ( e->xnext.isNull() )
+            d->lastExtent = e->xprev;
+        else
+            e->xnext.ext()->xprev = e->xprev;
+        if ( !d->lastExtent.isNull() )
+            d->lastExtentSize = d->lastExtent.ext()->length;
+
+        NamespaceDetails *freeExtents = freeListDetails();
+        e->xprev.Null();
+        e->xnext = freeExtents->firstExtent;
+        if ( freeExtents->firstExtent.isNull() )
+            freeExtents->lastExtent = e->myLoc;
+        else
+            freeExtents->firstExtent.ext()->xprev = e->myLoc;
+        freeExtents->firstExtent = e->myLoc;
+    }
+
+    static bool hasExtent(NamespaceDetails *d, const DiskLoc& ext) {
+        for ( DiskLoc i = d->firstExtent; !i.isNull(); i = i.ext()->xnext )
+            if ( i == ext )
+                return true;
+        return false;
+    }
+
+    bool compactCollection(const char *ns, int batch, string& errmsg, BSONObjBuilder& result) {
+        NamespaceDetails *d = nsdetails(ns);
+        if ( d == 0 ) {
+            errmsg = "ns not found";
+            return false;
+        }
+        if ( d->capped ) {
+            errmsg = "can't compact a capped collection";
+            return false;
+        }
+        if ( NamespaceString(ns).isSystem() ) {
+            errmsg = "can't compact a system collection";
+            return false;
+        }
+        if ( batch <= 0 )
+            batch = 1000;
+
+        /* keeps index builds, drops and other compactions off this collection while we yield */
+        BackgroundOperation::assertNoBgOpInProgForNs(ns);
+        BackgroundOperation op(ns);
+
+        auto_ptr<ClientCursor> cc;
+        {
+            auto_ptr<Cursor> c( new BasicCursor( DiskLoc() ) );
+            cc.reset( new ClientCursor(c, ns, false) );
+        }
+
+        Timer t;
+        long long moved = 0;
+        long long bytesFreed = 0;
+        int extentsFreed = 0;
+        const char *stopped = 0;
+        while ( 1 ) {
+            d = nsdetails(ns);
+            DiskLoc ext = d->lastExtent;
+            if ( ext == d->firstExtent ) {
+                break;
+            }
+            Extent *e = ext.ext();
+
+            long long live = 0;
+            for ( DiskLoc i = e->firstRecord; !i.isNull(); ) {
+                Record *r = i.rec();
+                live += r->lengthWithHeaders;
+                if ( r->nextOfs == DiskLoc::NullOfs )
+                    break;
+                i.setOfs( i.a(), r->nextOfs );
+            }
+            if ( deletedOutsideExtent(d, ext, false) < live ) {
+                stopped = "not enough free space in the other extents";
+                break;
+            }
+
+            deletedOutsideExtent(d, ext, true);
+            bool room = true;
+            try {
+                int n = 0;
+                while ( !e->firstRecord.isNull() ) {
+                    if ( !moveRecordOutOfExtent(d, ns, e->firstRecord, ext) ) {
+                        room = false;
+                        break;
+                    }
+                    moved++;
+                    if ( ++n % batch == 0 ) {
+                        NamespaceDetailsTransient::get_w(ns).notifyOfWriteOp();
+                        if ( !cc->yield() ) {
+                            cc.release();
+                            uasserted(13007, "cursor gone during compact");
+                        }
+                        killCurrentOp.checkForInterrupt();
+                        d = nsdetails(ns);
                     }
                 }
+            }
+            catch ( ... ) {
+                /* a failed yield may mean the collection, or the whole database, went away while
+                   we were unlocked: only tidy up ext if it is still one of ns's extents */
+                NamespaceDetails *nd = mongo::cc().database() ? nsdetails(ns) : 0;
+                if ( nd && hasExtent(nd, ext) )
+                    rebuildExtentFreeList(nd, ext.ext());
                 throw;
             }
+            NamespaceDetailsTransient::get_w(ns).notifyOfWriteOp();
+
+            if ( !room ) {
+                rebuildExtentFreeList(d, e);
+                stopped = "free space in the other extents is too fragmented";
+                break;
+            }
+
+            /* deletes in ext while we yielded put some of it back on the free list */
+            deletedOutsideExtent(d, ext, true);
+            bytesFreed += e->length;
+            extentsFreed++;
+            log(1 , LogStorage) << "compact " << ns << " freed extent " << ext.toString() << " len:" << e->length << endl;
+            freeEmptyExtent(d, e);
+
+            if ( !cc->yield() ) {
+                cc.release();
+                uasserted(13018, "cursor gone during compact");
+            }
+            killCurrentOp.checkForInterrupt();
+        }
+
+        log() << "compact " << ns << " moved " << moved << " records, freed " << extentsFreed << " extents in " << t.millis() << "ms" << endl;
+        result.append( "moved" , moved );
+        result.append( "extentsFreed" , extentsFreed );
+        result.append( "bytesFreed" , bytesFreed );
+        if ( stopped )
+            result.append( "note" , stopped );
+        return true;
+    }
+
+    /* a stretch of a data file for touchCollection() to read */
+    struct TouchChunk {
+        int file;
+        fileofs ofs;
+        unsigned len;
+    };
+
+    class TouchJob : boost::noncopyable {
+    public:
+        TouchJob() : stop(false), next(0), done(0) {}
+        vector< shared_ptr<File> > files; // opened under the db lock, so they are the right ones
+        vector< TouchChunk > chunks;
+        volatile bool stop;
+
+        bool take( TouchChunk &c ) {
+            boostlock lk( m );
+            if ( stop || next == chunks.size() )
+                return false;
+            c = chunks[ next++ ];
+            return true;
+        }
+        void read( unsigned len ) {
+            boostlock lk( m );
+            done += len;
+        }
+        long long bytesRead() {
+            boostlock lk( m );
+            return done;
+        }
+    private:
+        boost::mutex m;
+        unsigned next;
+        long long done;
+    };
+
+    enum { TouchChunkSize = 1024 * 1024 };
+
+    /* positional reads of the same File from several threads are fine (see file.h) */
+    static void touchWorker( TouchJob *job ) {
+        scoped_array<char> buf( new char[ TouchChunkSize ] );
+        TouchChunk c;
+        while ( job->take( c ) ) {
+            File &f = *job->files[ c.file ];
+            f.read( c.ofs, buf.get(), c.len );
+            if ( f.bad() ) {
+                job->stop = true; // touchCollection reports it
+                return;
+            }
+            job->read( c.len );
         }
     }
 
+    /* the extents of ns as ( file, ofs ) -> length */
+    static long long touchExtents( const char *ns, map< pair<int,int>, int > &extents ) {
+        NamespaceDetails *d = nsdetails( ns );
+        long long bytes = 0;
+        if ( d == 0 ) // an index kept outside the data files (_RECSTORE)
+            return 0;
+        for ( DiskLoc i = d->firstExtent; !i.isNull(); i = i.ext()->xnext ) {
+            int len = i.ext()->length;
+            extents[ make_pair( i.a(), i.getOfs() ) ] = len;
+            bytes += len;
+        }
+        return bytes;
+    }
+
+    bool touchCollection(const char *ns, bool data, const BSONElement& indexes, int nThreads, string& errmsg, BSONObjBuilder& result) {
+        NamespaceDetails *d = nsdetails(ns);
+        if ( d == 0 ) {
+            errmsg = "ns not found";
+            return false;
+        }
+        if ( nThreads <= 0 )
+            nThreads = 4;
+        if ( nThreads > 16 )
+            nThreads = 16;
+
+        /* the index namespaces' extents hold all of their buckets, in file order: reading them
+           through beats chasing child pointers down from each head one bucket at a time */
+        map< pair<int,int>, int > extents;
+        long long dataBytes = data ? touchExtents( ns, extents ) : 0;
+        BSONObjBuilder ib;
+        if ( indexes.type() == Array ) {
+            BSONObjIterator i( indexes.embeddedObject() );
+            while ( i.more() ) {
+                string name = i.next().valuestrsafe();
+                int x = d->findIndexByName( name.c_str() );
+                if ( x < 0 ) {
+                    errmsg = "index not found: " + name;
+                    return false;
+                }
+                ib.append( name.c_str(), touchExtents( d->idx( x ).indexNamespace().c_str(), extents ) );
+            }
+        }
+        else if ( indexes.eoo() || indexes.trueValue() ) {
+            NamespaceDetails::IndexIterator i = d->ii();
+            while ( i.more() ) {
+                IndexDetails &idx = i.next();
+                ib.append( idx.indexName().c_str(), touchExtents( idx.indexNamespace().c_str(), extents ) );
+            }
+        }
+
+        /* adjacent extents are read as one, in file order, a chunk at a time */
+        TouchJob job;
+        map< int, int > fileIndex;
+        long long total = 0;
+        for ( map< pair<int,int>, int >::iterator i = extents.begin(); i != extents.end(); ) {
+            int file = i->first.first;
+            fileofs ofs = i->first.second;
+            fileofs end = ofs + i->second;
+            for ( ++i; i != extents.end() && i->first.first == file && (fileofs) i->first.second == end; ++i )
+                end += i->second;
+
+            if ( fileIndex.count( file ) == 0 ) {
+                shared_ptr<File> f( new File() );
+                f->open( cc().database()->fileName( file ).string().c_str(), true );
+                if ( f->bad() ) {
+                    errmsg = "can't open data file";
+                    return false;
+                }
+                fileIndex[ file ] = job.files.size();
+                job.files.push_back( f );
+            }
+            for ( ; ofs < end; ofs += TouchChunkSize ) {
+                TouchChunk c;
+                c.file = fileIndex[ file ];
+                c.ofs = ofs;
+                c.len = (unsigned) min( (fileofs) TouchChunkSize, end - ofs );
+                job.chunks.push_back( c );
+                total += c.len;
+            }
+        }
+
+        CurOp *op = cc().curop();
+        op->setMessage( "touch: reading extents", total );
+        Timer t;
+        {
+            /* nothing below looks at the database: the files are open and the reads go through
+               the file cache the mappings share */
+            dbtempreleasecond unlock;
+            ThreadPool pool( nThreads );
+            for ( int i = 0; i < nThreads; i++ )
+                pool.schedule( touchWorker, &job );
+            try {
+                while ( pool.tasks_remaining() ) {
+                    sleepmillis( 100 );
+                    op->setProgress( job.bytesRead() );
+                    killCurrentOp.checkForInterrupt();
+                }
+            }
+            catch ( ... ) {
+                job.stop = true; // the pool waits for the workers to notice as we unwind
+                throw;
+            }
+        }
+        long long bytesRead = job.bytesRead();
+        op->setProgress( bytesRead );
+        for ( unsigned i = 0; i < job.files.size(); i++ ) {
+            if ( job.files[ i ]->bad() ) {
+                log() << "touch " << ns << " read error after " << bytesRead << " of " << total << " bytes" << endl;
+                errmsg = "error reading data file";
+                result.append( "bytes" , bytesRead );
+                return false;
+            }
+        }
+
+        log() << "touch " << ns << " read " << bytesRead / ( 1024 * 1024 ) << "MB in " << extents.size() << " extents in " << t.millis() << "ms" << endl;
+        if ( data )
+            result.append( "data" , dataBytes );
+        result.append( "indexes" , ib.done() );
+        result.append( "extents" , (int) extents.size() );
+        result.append( "bytes" , bytesRead );
+        result.append( "millis" , t.millis() );
+        return true;
+    }
+
     extern BSONObj id_obj; // { _id : 1 }
 
     void ensureHaveIdIndex(const char *ns) {
@@ -1357,15 +1963,7 @@ namespace mongo {
             BSONElementManipulator::lookForTimestamps( io );
         }
 
-        DiskLoc extentLoc;
-        int lenWHdr = len + Record::HeaderSize;
-        lenWHdr = (int) (lenWHdr * d->paddingFactor);
-        if ( lenWHdr == 0 ) {
-            // old datafiles, backward compatible here.
-            assert( d->paddingFactor == 0 );
-            d->paddingFactor = 1.0;
-            lenWHdr = len + Record::HeaderSize;
-        }
+        int lenWHdr = paddedLength(d, len);
         
         // If the collection is capped, check if the new object will violate a unique index
         // constraint before allocating space.
@@ -1373,30 +1971,9 @@ namespace mongo {
             checkNoIndexConflicts( d, BSONObj( reinterpret_cast<const char *>( obuf ) ) );
         }
         
-        DiskLoc loc = d->alloc(ns, lenWHdr, extentLoc);
-        if ( loc.isNull() ) {
-            // out of space
-            if ( d->capped == 0 ) { // size capped doesn't grow
-                log(1) << "allocating new extent for " << ns << " padding:" << d->paddingFactor << " lenWHdr: " << lenWHdr << endl;
-                cc().database()->allocExtent(ns, followupExtentSize(lenWHdr, d->lastExtentSize), false);
-                loc = d->alloc(ns, lenWHdr, extentLoc);
-                if ( loc.isNull() ){
-                    log() << "WARNING: alloc() failed after allocating new extent. lenWHdr: " << lenWHdr << " last extent size:" << d->lastExtentSize << "; trying again\n";
-                    for ( int zzz=0; zzz<10 && lenWHdr > d->lastExtentSize; zzz++ ){
-                        log() << "try #" << zzz << endl;
-                        cc().database()->allocExtent(ns, followupExtentSize(len, d->lastExtentSize), false);
-                        loc = d->alloc(ns, lenWHdr, extentLoc);
-                        if ( ! loc.isNull() )
-                            break;
-                    }
-                }
-            }
-            if ( loc.isNull() ) {
-                log() << "out of space in datafile " << ns << " capped:" << d->capped << endl;
-                assert(d->capped);
-                return DiskLoc();
-            }
-        }
+        DiskLoc loc = allocRecord(ns, d, len, lenWHdr);
+        if ( loc.isNull() )
+            return DiskLoc();
 
         Record *r = loc.rec();
         assert( r->lengthWithHeaders >= lenWHdr );
@@ -1410,19 +1987,7 @@ namespace mongo {
             if( obuf )
                 memcpy(r->data, obuf, len);
         }
-        Extent *e = r->myExtent(loc);
-        if ( e->lastRecord.isNull() ) {
-            e->firstRecord = e->lastRecord = loc;
-            r->prevOfs = r->nextOfs = DiskLoc::NullOfs;
-        }
-        else {
-
-            Record *oldlast = e->lastRecord.rec();
-            r->prevOfs = e->lastRecord.getOfs();
-            r->nextOfs = DiskLoc::NullOfs;
-            oldlast->nextOfs = loc.getOfs();
-            e->lastRecord = loc;
-        }
+        addRecordToExtent(r, loc);
 
         d->nrecords++;
         d->datasize += r->netLength();
@@ -1487,7 +2052,7 @@ namespace mongo {
     /* special version of insert for transaction logging -- streamlined a bit.
        assumes ns is capped and no indexes
     */
-    Record* DataFileMgr::fast_oplog_insert(NamespaceDetails *d, const char *ns, int len) {
+    Record* DataFileMgr::fast_oplog_insert(NamespaceDetails *d, const char *ns, int len, unsigned long long ts) {
         RARELY assert( d == nsdetails(ns) );
 
         DiskLoc extentLoc;
@@ -1516,6 +2081,12 @@ namespace mongo {
 
         d->nrecords++;
 
+        static unsigned sampleCount = 0;
+        if ( ts && ++sampleCount % NamespaceDetailsTransient::OplogSampleEvery == 0 ) {
+            boostlock lk(NamespaceDetailsTransient::_qcMutex);
+            NamespaceDetailsTransient::get_inlock( ns ).sampleOplog( ts, extentLoc );
+        }
+
         return r;
     }
 
@@ -1529,7 +2100,7 @@ namespace mongo {
         // ns is of the form "<dbname>.$cmd"
         char db[256];
         nsToDatabase(ns, db);
-        log(1) << "dropDatabase " << db << endl;
+        log(1 , LogStorage) << "dropDatabase " << db << endl;
         assert( cc().database()->name == db );
 
         BackgroundOperation::assertNoBgOpInProgForDb(db);
@@ -1719,7 +2290,7 @@ namespace mongo {
         bool ok = false;
         BOOST_CHECK_EXCEPTION( ok = fo.apply( q ) );
         if ( ok )
-            log(2) << fo.op() << " file " << q.string() << '\n';
+            log(2 , LogStorage) << fo.op() << " file " << q.string() << '\n';
         int i = 0;
         int extra = 10; // should not be necessary, this is defensive in case there are missing files
         while ( 1 ) {
@@ -1730,7 +2301,7 @@ namespace mongo {
             BOOST_CHECK_EXCEPTION( ok = fo.apply(q) );
             if ( ok ) {
                 if ( extra != 10 ){
-                    log(1) << fo.op() << " file " << q.string() << '\n';
+                    log(1 , LogStorage) << fo.op() << " file " << q.string() << '\n';
                     log() << "  _applyOpToDataFiles() warning: extra == " << extra << endl;
                 }
             }
@@ -1758,7 +2329,7 @@ namespace mongo {
         int n = 0;
         for( set< string >::iterator i = dbs.begin(); i != dbs.end(); ++i ) {
             string name = *i;
-            log(2) << "DatabaseHolder::closeAll path:" << path << " name:" << name << endl;
+            log(2 , LogStorage) << "DatabaseHolder::closeAll path:" << path << " name:" << name << endl;
             Client::Context ctx( name , path );
             if( !force && BackgroundOperation::inProgForDb(name.c_str()) )
                 log() << "WARNING: can't close database " << name << "because a bg job is in progress - try killOp command" << endl;
@@ -48,9 +48,21 @@ namespace mongo {
     
     /* deletes this ns, indexes and cursors */
     void dropCollection( const string &name, string &errmsg, BSONObjBuilder &result ); 
-    bool userCreateNS(const char *ns, BSONObj j, string& err, bool logForReplication);
+    /* deferIdIndex - if nonzero, the _id index is not created: *deferIdIndex is set if the caller
+                      should ensureHaveIdIndex() itself.  a bulk load does that once the data is in
+                      so the index is built bottom up rather than a key at a time. */
+    bool userCreateNS(const char *ns, BSONObj j, string& err, bool logForReplication, bool *deferIdIndex = 0);
     auto_ptr<Cursor> findTableScan(const char *ns, const BSONObj& order, const DiskLoc &startLoc=DiskLoc());
 
+    /* online compaction: moves records out of ns's tail extents, batch at a time yielding in between,
+       and gives the emptied extents back to the database (see the compact command). */
+    bool compactCollection(const char *ns, int batch, string& errmsg, BSONObjBuilder& result);
+
+    /* reads the extents of ns and of the chosen indexes (indexes: true for all, false for none,
+       or an array of index names) into the file cache with nThreads threads, without the db lock
+       (see the touch command). */
+    bool touchCollection(const char *ns, bool data, const BSONElement& indexes, int nThreads, string& errmsg, BSONObjBuilder& result);
+
 // -1 if library unavailable.
     boost::intmax_t freeSpace();
 
@@ -97,13 +109,17 @@ namespace mongo {
         /* see if we can find an extent of the right size in the freelist. */
         static Extent* allocFromFreeList(const char *ns, int approxSize, bool capped = false);
 
-        /** @return DiskLoc where item ends up */
+        /** @return DiskLoc where item ends up
+            @param keysMayChange bit i is set if the update may change index i's keys.  the other
+                   indexes' keys are not regenerated (see getIndexChanges()).
+        */
         const DiskLoc updateRecord(
             const char *ns,
             NamespaceDetails *d,
             NamespaceDetailsTransient *nsdt,
             Record *toupdate, const DiskLoc& dl,
-            const char *buf, int len, OpDebug& debug);
+            const char *buf, int len, OpDebug& debug,
+            unsigned long long keysMayChange = ~0ULL);
         // The object o may be updated if modified on insert.                                
         void insertAndLog( const char *ns, const BSONObj &o, bool god = false );
         DiskLoc insert(const char *ns, BSONObj &o, bool god = false);
@@ -115,9 +131,13 @@ namespace mongo {
            assumes ns is capped and no indexes
            no _id field check
         */
-        Record* fast_oplog_insert(NamespaceDetails *d, const char *ns, int len);
+        /* ts: the op's timestamp (OpTime::asDate()), sampled for OplogReplay queries.  0 if n/a */
+        Record* fast_oplog_insert(NamespaceDetails *d, const char *ns, int len, unsigned long long ts = 0);
 
         static Extent* getExtent(const DiskLoc& dl);
+        /* readahead hint for the extent at dl (see MemoryMappedFile::advise).  prefetch is the most
+           to ask for with WillNeed, from the start of the extent; 0 for all of it. */
+        static void adviseExtent(const DiskLoc& dl, MemoryMappedFile::Advice a, int prefetch = 0);
         static Record* getRecord(const DiskLoc& dl);
 
         /* does not clean up indexes, etc. : just deletes the record in the pdfile. */
@@ -442,6 +462,15 @@ namespace mongo {
         return cc().database()->getFile(dl.a())->getExtent(dl);
     }
 
+    inline void DataFileMgr::adviseExtent(const DiskLoc& dl, MemoryMappedFile::Advice a, int prefetch) {
+        MongoDataFile *f = cc().database()->getFile(dl.a());
+        Extent *e = f->getExtent(dl);
+        int len = e->length;
+        if ( a == MemoryMappedFile::WillNeed && prefetch > 0 && prefetch < len )
+            len = prefetch;
+        f->mmf.advise(e, len, a);
+    }
+
     inline Record* DataFileMgr::getRecord(const DiskLoc& dl) {
         assert( dl.a() != -1 );
         return cc().database()->getFile(dl.a())->recordAt(dl);
@@ -385,6 +385,15 @@ namespace mongo {
                         setComplete();
                         return;
                     }
+                    if ( bc_->counted() ) {
+                        // counted index: no need to walk the keys
+                        long long n = bc_->nEqual( firstMatch_ ) - skip_;
+                        if ( limit_ > 0 && n > limit_ )
+                            n = limit_;
+                        count_ = n > 0 ? n : 0;
+                        setComplete();
+                        return;
+                    }
                     _gotOne();
                 } else {
                     if ( !firstMatch_.woEqual( bc_->currKeyNode().key ) ) {
@@ -505,12 +514,20 @@ namespace mongo {
             b_.skip( sizeof( QueryResult ) );
             
             if ( findingStart_ ) {
-                // Use a ClientCursor here so we can release db mutex while scanning
-                // oplog (can take quite a while with large oplogs).
-                auto_ptr<Cursor> c = qp().newReverseCursor();
-                findingStartCursor_ = new ClientCursor(c, qp().ns(), false);
-                findingStartTimer_.reset();
-                findingStartMode_ = Initial;
+                DiskLoc sampled = sampledStartLoc();
+                if ( !sampled.isNull() ) {
+                    // close to the start already; scan forward from there
+                    createClientCursor( sampled );
+                    findingStartMode_ = InExtent;
+                }
+                else {
+                    // Use a ClientCursor here so we can release db mutex while scanning
+                    // oplog (can take quite a while with large oplogs).
+                    auto_ptr<Cursor> c = qp().newReverseCursor();
+                    findingStartCursor_ = new ClientCursor(c, qp().ns(), false);
+                    findingStartTimer_.reset();
+                    findingStartMode_ = Initial;
+                }
             } else {
                 c_ = qp().newCursor();
             }
@@ -522,6 +539,13 @@ namespace mongo {
                 so_.reset( new ScanAndOrder( ntoskip_, ntoreturn_, order_ ) );
                 wantMore_ = false;
             }
+            else if ( ntoskip_ > 0 && !explain_ && c_.get() &&
+                      ( qp().query().isEmpty() || ( qp().exactKeyMatch() && !matcher_->needRecord() ) ) ) {
+                // every key in range matches, so a counted index can skip without looking at them
+                BtreeCursor *bc = dynamic_cast< BtreeCursor* >( c_.get() );
+                if ( bc )
+                    ntoskip_ -= (int) bc->skipKeys( ntoskip_ );
+            }
         }
         
         DiskLoc startLoc( const DiskLoc &rec ) {
@@ -545,6 +569,38 @@ namespace mongo {
             return DiskLoc(); // reached beginning of collection
         }
         
+        /* start of the extent fast_oplog_insert() sampled for the newest op at or before our
+           ts bound -- if its first record is still no newer than the bound.  null otherwise. */
+        DiskLoc sampledStartLoc() {
+            const FieldRange &tsRange = qp().range( "ts" );
+            if ( tsRange.empty() || !tsRange.nontrivial() )
+                return DiskLoc();
+            BSONElement min = tsRange.min();
+            if ( min.type() != Timestamp && min.type() != Date )
+                return DiskLoc();
+            unsigned long long ts = min.date();
+
+            DiskLoc ext;
+            {
+                boostlock lk(NamespaceDetailsTransient::_qcMutex);
+                ext = NamespaceDetailsTransient::get_inlock( qp().ns() ).oplogSampleBefore( ts );
+            }
+            if ( ext.isNull() )
+                return DiskLoc();
+            Extent *e = ext.ext();
+            if ( e->magic != 0x41424344 || !( e->nsDiagnostic == qp().ns() ) )
+                return DiskLoc();
+
+            NamespaceDetails *d = qp().nsd();
+            DiskLoc first = ( ext == d->capExtent && d->capLooped() ) ? d->capFirstNewRecord : e->firstRecord;
+            if ( first.isNull() || !first.isValid() )
+                return DiskLoc();
+            BSONElement firstTs = BSONObj( first.rec() )[ "ts" ];
+            if ( firstTs.eoo() || firstTs.date() > ts )
+                return DiskLoc(); // the extent has been reused since we sampled it
+            return first;
+        }
+
         void createClientCursor( const DiskLoc &startLoc = DiskLoc() ) {
             auto_ptr<Cursor> c = qp().newCursor( startLoc );
             findingStartCursor_ = new ClientCursor(c, qp().ns(), false);            
@@ -919,7 +975,9 @@ namespace mongo {
                 if ( dqo.scanAndOrderRequired() )
                     ss << " scanAndOrder ";
                 auto_ptr< Cursor > c = dqo.cursor();
-                log( 5 ) << "   used cursor: " << c.get() << endl;
+                log( 5 , LogQuery ) << "   used cursor: " << c.get() << endl;
+                if ( curop.profileLevel() > 0 )
+                    curop.debug().plan = c->toString();
                 if ( dqo.saveClientCursor() ) {
                     // the clientcursor now owns the Cursor* and 'c' is released:
                     ClientCursor *cc = new ClientCursor(c, ns, !(queryOptions & QueryOption_NoCursorTimeout));
@@ -946,6 +1004,8 @@ namespace mongo {
                     builder.append("n", n);
                     if ( dqo.scanAndOrderRequired() )
                         builder.append("scanAndOrder", true);
+                    if ( dqo.qp().estimatedKeys() >= 0 )
+                        builder.append("estimatedKeys", dqo.qp().estimatedKeys());
                     builder.append("millis", curop.elapsedMillis());
                     if ( !oldPlan.isEmpty() )
                         builder.append( "oldPlan", oldPlan.firstElement().embeddedObject().firstElement().embeddedObject() );
@@ -969,6 +1029,8 @@ namespace mongo {
         
         int duration = curop.elapsedMillis();
         bool dbprofile = curop.shouldDBProfile( duration );
+        if ( dbprofile )
+            curop.debug().nscanned = nscanned;
         if ( dbprofile || duration >= cmdLine.slowMS ) {
             ss << " nscanned:" << nscanned << ' ';
             if ( ntoskip )
@@ -58,7 +58,8 @@ namespace mongo {
     exactKeyMatch_( false ),
     direction_( 0 ),
     endKeyInclusive_( endKey.isEmpty() ),
-    unhelpful_( false ) {
+    unhelpful_( false ),
+    estimatedKeys_( -1 ) {
 
         if ( !fbs_.matchPossible() ) {
             unhelpful_ = true;
@@ -211,6 +212,26 @@ namespace mongo {
         }
     }
     
+    void QueryPlan::estimate( const IndexStatsMap &stats ) {
+        estimatedKeys_ = -1;
+        indexStats_.reset();
+        if ( !fbs_.matchPossible() )
+            return;
+        if ( !index_ ) {
+            estimatedKeys_ = d->nrecords;
+            return;
+        }
+        IndexStatsMap::const_iterator i = stats.find( index_->indexName() );
+        if ( i == stats.end() )
+            return;
+        indexStats_ = i->second;
+        int nEqualityFields = 0;
+        BSONObjIterator k( index_->keyPattern() );
+        while( k.more() && fbs_.range( k.next().fieldName() ).equality() )
+            ++nEqualityFields;
+        estimatedKeys_ = indexStats_->estimateKeys( indexBounds_, nEqualityFields );
+    }
+    
     QueryPlanSet::QueryPlanSet( const char *_ns, const BSONObj &query, const BSONObj &order, const BSONElement *hint, bool honorRecordedPlan, const BSONObj &min, const BSONObj &max ) :
     ns(_ns),
     query_( query.getOwned() ),
@@ -244,6 +265,7 @@ namespace mongo {
     
     void QueryPlanSet::init() {
         plans_.clear();
+        pruned_.clear();
         mayRecordPlan_ = true;
         usingPrerecordedPlan_ = false;
         
@@ -363,11 +385,46 @@ namespace mongo {
                 plans.push_back( p );
             }
         }
+        // Table scan plan
+        plans.push_back( PlanPtr( new QueryPlan( d, -1, fbs_, order_ ) ) );
+
+        prunePlans( plans );
         for( PlanSet::iterator i = plans.begin(); i != plans.end(); ++i )
             addPlan( *i, checkFirst );
-
-        // Table scan plan
-        addPlan( PlanPtr( new QueryPlan( d, -1, fbs_, order_ ) ), checkFirst );
+    }
+    
+    /* With index statistics (see the analyze command), plans expected to scan many times more
+       than the best one are dropped rather than raced, so they cost no I/O.  Plans without
+       statistics are always kept, and so is any plan that returns the requested order without
+       a sort -- it may win by stopping early. */
+    void QueryPlanSet::prunePlans( PlanSet &plans ) {
+        const long long PruneFactor = 10;
+        const long long PruneMinKeys = 100;
+        if ( plans.size() < 2 || strstr( fbs_.ns(), ".system." ) )
+            return;
+        IndexStatsMap stats;
+        getIndexStats( fbs_.ns(), stats );
+        if ( stats.empty() )
+            return;
+        long long best = -1;
+        for( PlanSet::iterator i = plans.begin(); i != plans.end(); ++i ) {
+            (*i)->estimate( stats );
+            long long e = (*i)->estimatedKeys();
+            if ( e >= 0 && ( best < 0 || e < best ) )
+                best = e;
+        }
+        PlanSet keep;
+        for( PlanSet::iterator i = plans.begin(); i != plans.end(); ++i ) {
+            long long e = (*i)->estimatedKeys();
+            if ( e > best * PruneFactor && e > PruneMinKeys &&
+                 ( order_.isEmpty() || (*i)->scanAndOrderRequired() ) ) {
+                log(1 , LogQuery) << "  pruned plan " << (*i)->indexKey() << " estimated " << e << " keys, best " << best << endl;
+                pruned_.push_back( BSON( "indexKey" << (*i)->indexKey() << "estimatedKeys" << e ) );
+            } else {
+                keep.push_back( *i );
+            }
+        }
+        plans.swap( keep );
     }
     
     shared_ptr< QueryOp > QueryPlanSet::runOp( QueryOp &op ) {
@@ -391,10 +448,20 @@ namespace mongo {
         vector< BSONObj > arr;
         for( PlanSet::const_iterator i = plans_.begin(); i != plans_.end(); ++i ) {
             auto_ptr< Cursor > c = (*i)->newCursor();
-            arr.push_back( BSON( "cursor" << c->toString() << "startKey" << c->prettyStartKey() << "endKey" << c->prettyEndKey() ) );
+            BSONObjBuilder p;
+            p.append( "cursor", c->toString() );
+            p.append( "startKey", c->prettyStartKey() );
+            p.append( "endKey", c->prettyEndKey() );
+            if ( (*i)->estimatedKeys() >= 0 )
+                p.append( "estimatedKeys", (*i)->estimatedKeys() );
+            if ( (*i)->indexStats() )
+                p.append( "indexStats", (*i)->indexStats()->summary() );
+            arr.push_back( p.obj() );
         }
         BSONObjBuilder b;
         b.append( "allPlans", arr );
+        if ( !pruned_.empty() )
+            b.append( "prunedPlans", pruned_ );
         return b.obj();
     }
     
@@ -407,7 +474,7 @@ namespace mongo {
         massert( 10369 ,  "no plans", plans_.plans_.size() > 0 );
         
         if ( plans_.plans_.size() > 1 )
-            log(1) << "  running multiple plans" << endl;
+            log(1 , LogQuery) << "  running multiple plans" << endl;
 
         vector< shared_ptr< QueryOp > > ops;
         for( PlanSet::iterator i = plans_.plans_.begin(); i != plans_.plans_.end(); ++i ) {
@@ -21,6 +21,7 @@
 #include "cursor.h"
 #include "jsobj.h"
 #include "queryutil.h"
+#include "indexstats.h"
 
 namespace mongo {
     
@@ -55,6 +56,13 @@ namespace mongo {
         BSONObj simplifiedQuery( const BSONObj& fields = BSONObj() ) const { return fbs_.simplifiedQuery( fields ); }
         const FieldRange &range( const char *fieldName ) const { return fbs_.range( fieldName ); }
         void registerSelf( long long nScanned ) const;
+        /* Sets estimatedKeys() from the index statistics; a table scan is estimated at the
+           collection's record count. */
+        void estimate( const IndexStatsMap &stats );
+        /* Keys (records, for a table scan) this plan is expected to scan, or -1 if unknown. */
+        long long estimatedKeys() const { return estimatedKeys_; }
+        /* The statistics estimatedKeys() came from, if any. */
+        shared_ptr< IndexStats > indexStats() const { return indexStats_; }
         // just for testing
         BoundList indexBounds() const { return indexBounds_; }
     private:
@@ -70,6 +78,8 @@ namespace mongo {
         BoundList indexBounds_;
         bool endKeyInclusive_;
         bool unhelpful_;
+        long long estimatedKeys_;
+        shared_ptr< IndexStats > indexStats_;
     };
 
     // Inherit from this interface to implement a new query operation.
@@ -123,11 +133,14 @@ namespace mongo {
         }
         const FieldRangeSet &fbs() const { return fbs_; }
         BSONObj explain() const;
+        // Plans dropped on their estimates, for explain().
+        const vector< BSONObj > &prunedPlans() const { return pruned_; }
         bool usingPrerecordedPlan() const { return usingPrerecordedPlan_; }
     private:
         void addOtherPlans( bool checkFirst );
         typedef boost::shared_ptr< QueryPlan > PlanPtr;
         typedef vector< PlanPtr > PlanSet;
+        void prunePlans( PlanSet &plans );
         void addPlan( PlanPtr plan, bool checkFirst ) {
             if ( checkFirst && plan->indexKey().woCompare( plans_[ 0 ]->indexKey() ) == 0 )
                 return;
@@ -155,11 +168,15 @@ namespace mongo {
         bool honorRecordedPlan_;
         BSONObj min_;
         BSONObj max_;
+        vector< BSONObj > pruned_;
     };
 
     // NOTE min, max, and keyPattern will be updated to be consistent with the selected index.
     IndexDetails *indexDetailsForRange( const char *ns, string &errmsg, BSONObj &min, BSONObj &max, BSONObj &keyPattern );
 
+    // The key a forward (baseDirection 1) or reverse (-1) scan of an index with this pattern ends on.
+    BSONObj extremeKeyForIndex( const BSONObj &idxPattern, int baseDirection );
+
     inline bool isSimpleIdQuery( const BSONObj& query ){
         return 
             strcmp( query.firstElement().fieldName() , "_id" ) == 0 && 
@@ -22,7 +22,6 @@ void setRecCacheSize(unsigned mb) {
 }
 
 void writerThread() { 
-    sleepsecs(10);
     while( 1 ) { 
         try { 
             theRecCache.writeLazily();
@@ -41,8 +40,6 @@ void recCacheCloseAll() {
 #endif
 }
 
-int ndirtywritten;
-
 inline static string escape(const char *ns) {
     char buf[256];
     char *p = buf;
@@ -130,7 +127,7 @@ BasicRecStore* RecCache::initStore(int n) {
     /* this will be slow if there are thousands of files */
     path dir(directory());
     directory_iterator end;
-    try {
+    try {
         directory_iterator i(dir);
         while ( i != end ) {
             string s = i->string();
@@ -139,17 +136,17 @@ BasicRecStore* RecCache::initStore(int n) {
                 // found it
                 path P = *i;
                 return _initStore(P.leaf());
-            }
+            }
             i++;
-        }
-    }
+        }
+    }
     catch( DBException & ) { 
         throw;
-    }
+    }
     catch (...) {
         string s = string("i/o error looking for .idx file in ") + directory();
         massert( 10375 , s, false);
-    }
+    }
     stringstream ss;
     ss << "index datafile missing? n=" << n;
     uasserted(12500,ss.str());
@@ -175,7 +172,7 @@ string RecCache::findStoreFilename(const char *_ns, bool& found) {
     path dir(directory());
     directory_iterator end;
     int nmax = -1;
-    try {
+    try {
         directory_iterator i(dir);
         while ( i != end ) {
             string s = path(*i).leaf();
@@ -183,22 +180,22 @@ string RecCache::findStoreFilename(const char *_ns, bool& found) {
             if( p ) {
                 found = true;
                 return s;
-            }
+            }
             if( strstr(s.c_str(), ".idx") ) { 
                 stringstream ss(s);
                 int n = -1;
                 ss >> n;
                 if( n > nmax )
                     nmax = n;
-            }
+            }
             i++;
-        }
-    }
+        }
+    }
     catch (...) {
         string s = string("i/o error looking for .idx file in ") + directory();
         massert( 10376 , s, false);
-    }
-
+    }
+
     // DNE.  return a name that would work.
     stringstream ss;
     ss << nmax+1 << namefrag;
@@ -212,162 +209,337 @@ void RecCache::initStoreByNs(const char *_ns, const string& nskey) {
     _initStore(fn);
 }
 
-inline void RecCache::writeIfDirty(Node *n) {
-    if( n->dirty ) {
-        ndirtywritten++;
-        n->dirty = false;
-        store(n->loc).update(fileOfs(n->loc), n->data, recsize);
+int RecCache::mkNode(const DiskLoc& d) {
+    if( freeList < 0 ) {
+        if( nslots % SlabNodes == 0 ) {
+            char *data = (char *) malloc(SlabNodes * recsize);
+            massert( 13014 , "out of memory allocating RecCache slab", data );
+            nodeSlabs.push_back(new Node[SlabNodes]);
+            dataSlabs.push_back(data);
+        }
+        int i = nslots++;
+        node(i).data = dataSlabs[i / SlabNodes] + (size_t) (i % SlabNodes) * recsize;
+        freeList = i;
+        if( (unsigned) nslots > table.size() / 2 )
+            growTable();
+    }
+    int i = freeList;
+    Node& n = node(i);
+    freeList = n.next;
+    n.loc = d;
+    n.state = Clean;
+    n.referenced = true;
+    n.inUse = true;
+    n.inQueue = false;
+    unsigned h = hash(d);
+    n.next = table[h];
+    table[h] = i;
+    nnodes++;
+    return i;
+}
+
+void RecCache::freeNode(int i) {
+    Node& n = node(i);
+    assert( n.inUse );
+    int *p = &table[hash(n.loc)];
+    while( *p != i ) {
+        assert( *p >= 0 );
+        p = &node(*p).next;
+    }
+    *p = n.next;
+    n.inUse = false;
+    n.state = Clean;
+    n.next = freeList;
+    freeList = i;
+    nnodes--;
+}
+
+/* keep the table at least twice the number of slots so chains stay short */
+void RecCache::growTable() {
+    unsigned sz = table.empty() ? 4096 : table.size() * 2;
+    while( sz < (unsigned) nslots * 2 )
+        sz *= 2;
+    table.assign(sz, -1);
+    tableMask = sz - 1;
+    for( int i = 0; i < nslots; i++ ) {
+        Node& n = node(i);
+        if( !n.inUse )
+            continue;
+        unsigned h = hash(n.loc);
+        n.next = table[h];
+        table[h] = i;
     }
 }
 
+/* second chance: a page referenced since the hand last passed gets another lap.  dirty pages
+   are skipped, the writer will make them clean. */
+int RecCache::clockVictim() {
+    for( int k = 0; k < 2 * nslots; k++ ) {
+        int i = clockHand;
+        if( ++clockHand >= nslots )
+            clockHand = 0;
+        Node& n = node(i);
+        if( !n.inUse || n.state != Clean )
+            continue;
+        if( n.referenced ) {
+            n.referenced = false;
+            continue;
+        }
+        return i;
+    }
+    return -1;
+}
+
+void RecCache::queuePending() {
+    for( vector<int>::iterator i = pending.begin(); i != pending.end(); i++ ) {
+        Node& n = node(*i);
+        if( !n.inUse || n.state != Pending )
+            continue;
+        n.state = Queued;
+        if( !n.inQueue ) {
+            n.inQueue = true;
+            queue.push_back(*i);
+        }
+    }
+    pending.clear();
+    if( queue.size() >= WriteBatch )
+        queuedCond.notify_one();
+}
+
+void RecCache::evict() {
+    while( nnodes > MAXNODES ) {
+        int i = clockVictim();
+        if( i < 0 )
+            break;
+        freeNode(i);
+        evictions++;
+    }
+}
+
+void RecCache::writeNode(Node& n) {
+    BasicRecStore *rs = openStore(n.loc);
+    if( rs )
+        rs->update(fileOfs(n.loc), n.data, recsize);
+    n.state = Clean;
+    pagesWritten++;
+    writeCalls++;
+}
+
+/* write every dirty page in place.  caller holds writeMutex, so there is no batch in flight. */
+void RecCache::flushAll(bool rawLog) {
+    try {
+        for( int i = 0; i < nslots; i++ ) {
+            Node& n = node(i);
+            if( n.inUse && n.state != Clean )
+                writeNode(n);
+        }
+    }
+    catch(...) {
+        const char *message = "Problem: bad() in RecCache::flushAll, file io error\n";
+
+        if ( rawLog )
+            rawOut( message );
+        else
+            ( log() << message ).flush();
+    }
+    for( int i = 0; i < nslots; i++ ) {
+        node(i).state = Clean;
+        node(i).inQueue = false;
+    }
+    pending.clear();
+    queue.clear();
+}
+
 void RecCache::closeFiles(string dbname, string path) { 
     assertInWriteLock();
+    boostlock wl(writeMutex);
     boostlock lk(rcmutex);
 
     // first we write all dirty pages.  it is not easy to check which Nodes are for a particular
     // db, so we just write them all.
-    writeDirty( dirtyl.begin(), true );
+    flushAll(true);
 
     string key = path + dbname + '.';
     unsigned sz = key.size();
-    for( map<string, BasicRecStore*>::iterator i = storesByNsKey.begin(); i != storesByNsKey.end(); i++ ) { 
+    for( map<string, BasicRecStore*>::iterator i = storesByNsKey.begin(); i != storesByNsKey.end(); ) { 
         map<string, BasicRecStore*>::iterator j = i;
         i++;
         if( strncmp(j->first.c_str(), key.c_str(), sz) == 0 ) {
-            assert( stores[j->second->fileNumber] != 0 );
-            stores[j->second->fileNumber] = 0;
-            delete j->second;
+            closeStore(j->second);
             storesByNsKey.erase(j);
         }
     }
 }
 
 void RecCache::closing() { 
+    boostlock wl(writeMutex);
     boostlock lk(rcmutex);
-    (cout << "TEMP: recCacheCloseAll() writing dirty pages...\n").flush();
-    writeDirty( dirtyl.begin(), true );
+    log() << "RecCache: writing dirty pages..." << endl;
+    flushAll(true);
     for( unsigned i = 0; i < stores.size(); i++ ) { 
         if( stores[i] ) {
             delete stores[i];
+            stores[i] = 0;
         }
     }
-    (cout << "TEMP: write dirty done\n").flush();
+    log() << "RecCache: write dirty done" << endl;
 }
 
-/* note that this is written in order, as much as possible, given that dirtyl is of type set. */
-void RecCache::writeDirty( set<DiskLoc>::iterator startAt, bool rawLog ) { 
-    try { 
-        ndirtywritten=0;
-        for( set<DiskLoc>::iterator i = startAt; i != dirtyl.end(); i++ ) { 
-            map<DiskLoc, Node*>::iterator j = m.find(*i);
-            if( j != m.end() )
-                writeIfDirty(j->second);
-        }
-        OCCASIONALLY out() << "TEMP: ndirtywritten: " << ndirtywritten << endl;
+struct PageWrite {
+    PageWrite(BasicRecStore *_rs, fileofs _ofs, int _node) : rs(_rs), ofs(_ofs), node(_node) { }
+    bool operator<(const PageWrite& r) const {
+        if( rs->fileNumber != r.rs->fileNumber )
+            return rs->fileNumber < r.rs->fileNumber;
+        return ofs < r.ofs;
     }
-    catch(...) {
-        const char *message = "Problem: bad() in RecCache::writeDirty, file io error\n";
-
-        if ( rawLog )
-            rawOut( message );
-        else
-            ( log() << message ).flush();
-    }
-    dirtyl.clear();
-}
+    BasicRecStore *rs;
+    fileofs ofs;
+    int node;
+};
 
 void RecCache::writeLazily() {
-    int sleep = 0;
-    int k;
     {
         boostlock lk(rcmutex);
-        Timer t;
-        set<DiskLoc>::iterator i = dirtyl.end();
-        for( k = 0; k < 100; k++ ) {
-            if( i == dirtyl.begin() ) { 
-                // we're not very far behind
-                sleep = k < 20 ? 2000 : 1000;
-                break;
+        if( queue.size() < WriteBatch ) {
+            boost::xtime xt;
+            boost::xtime_get(&xt, boost::TIME_UTC);
+            xt.sec += 1;
+            queuedCond.timed_wait(lk, xt);
+        }
+    }
+
+    /* stores can't be closed or dropped while we hold this, so the pointers in the batch stay good */
+    boostlock wl(writeMutex);
+    vector<PageWrite> batch;
+    {
+        boostlock lk(rcmutex);
+        while( !queue.empty() && batch.size() < WriteBatch ) {
+            int i = queue.front();
+            queue.pop_front();
+            Node& n = node(i);
+            n.inQueue = false;
+            if( !n.inUse || n.state != Queued )
+                continue; // dirtied again, it will be queued again
+            BasicRecStore *rs = openStore(n.loc);
+            if( !rs ) {
+                n.state = Clean;
+                continue;
             }
-            i--;
+            batch.push_back( PageWrite(rs, fileOfs(n.loc), i) );
         }
-        writeDirty(i);
-        if( sleep == 0 ) {
-            sleep = t.millis() * 4 + 10;
+        if( batch.empty() )
+            return;
+
+        /* copy out in file order so neighbouring pages are contiguous in writeBuf too.  the
+           pages stay unevictable (Writing) until they are on disk. */
+        sort(batch.begin(), batch.end());
+        if( writeBuf == 0 ) {
+            writeBuf = (char *) malloc(WriteBatch * recsize);
+            massert( 13015 , "out of memory allocating RecCache write buffer", writeBuf );
+        }
+        for( unsigned k = 0; k < batch.size(); k++ ) {
+            Node& n = node(batch[k].node);
+            memcpy(writeBuf + k * recsize, n.data, recsize);
+            n.state = Writing;
+        }
+    }
+
+    unsigned calls = 0;
+    try {
+        for( unsigned k = 0; k < batch.size(); ) {
+            unsigned e = k + 1;
+            while( e < batch.size() && batch[e].rs == batch[k].rs &&
+                   batch[e].ofs == batch[e-1].ofs + recsize )
+                e++;
+            batch[k].rs->update(batch[k].ofs, writeBuf + k * recsize, (e - k) * recsize);
+            calls++;
+            k = e;
         }
     }
+    catch(...) {
+        log() << "Problem: bad() in RecCache::writeLazily, file io error" << endl;
+    }
 
-    OCCASIONALLY cout << "writeLazily " << k << " sleep:" << sleep << '\n';
-    sleepmillis(sleep);
+    boostlock lk(rcmutex);
+    for( unsigned k = 0; k < batch.size(); k++ ) {
+        Node& n = node(batch[k].node);
+        if( n.state == Writing )
+            n.state = Clean;
+    }
+    pagesWritten += batch.size();
+    writeCalls += calls;
+    writeBatches++;
+    writtenCond.notify_all();
 }
 
 void RecCache::_ejectOld() { 
     boostlock lk(rcmutex);
-    if( nnodes <= MAXNODES )
-        return;
-    Node *n = oldest;
-    while( 1 ) {
-        if( nnodes <= MAXNODES - 4 ) { 
-            n->older = 0;
-            oldest = n;
-            assert( oldest ) ;
-            break;
-        }
-        nnodes--;
-        assert(n);
-        Node *nxt = n->newer;
-        writeIfDirty(n);
-        m.erase(n->loc);
-        delete n;
-        n = nxt;
+    queuePending();
+    evict();
+
+    /* the writer is behind and nearly everything left is dirty: wait for it rather than grow
+       without bound.  we hold the db write lock, which the writer doesn't need. */
+    unsigned hardLimit = MAXNODES + MAXNODES / 8 + SlabNodes;
+    while( nnodes > hardLimit && !queue.empty() ) {
+        stalls++;
+        queuedCond.notify_one();
+        writtenCond.wait(lk);
+        evict();
     }
 }
 
-void RecCache::dump() { 
-    Node *n = oldest;
-    Node *last = 0;
-    while( n ) { 
-        assert( n->older == last );
-        last = n;
-//        cout << n << ' ' << n->older << ' ' << n->newer << '\n';
-        n=n->newer;
-    }
-    assert( newest == last );
-//    cout << endl;
+void RecCache::appendStats(BSONObjBuilder& b) {
+    boostlock lk(rcmutex);
+    b.append("maxPages", (int) MAXNODES);
+    b.append("pages", (int) nnodes);
+    b.appendIntOrLL("allocatedMB", (long long) nslots * recsize / (1024 * 1024));
+    b.appendIntOrLL("hits", hits);
+    b.appendIntOrLL("misses", misses);
+    b.append("hitRatio", hits + misses ? (double) hits / (hits + misses) : 0.0);
+    b.appendIntOrLL("evictions", evictions);
+    b.append("dirtyPending", (int) pending.size());
+    b.append("writeQueue", (int) queue.size());
+    b.appendIntOrLL("pagesWritten", pagesWritten);
+    b.appendIntOrLL("writeCalls", writeCalls);
+    b.appendIntOrLL("writeBatches", writeBatches);
+    b.appendIntOrLL("writerStalls", stalls);
 }
 
 /* cleans up everything EXCEPT storesByNsKey.
    note this function is slow should not be invoked often
+   caller holds writeMutex and rcmutex.
 */
 void RecCache::closeStore(BasicRecStore *rs) { 
     int n = rs->fileNumber + Base;
-    for( set<DiskLoc>::iterator i = dirtyl.begin(); i != dirtyl.end(); ) { 
-        DiskLoc k = *i++;
-        if( k.a() == n )
-            dirtyl.erase(k);
+    for( int i = 0; i < nslots; i++ ) {
+        Node& nd = node(i);
+        if( nd.inUse && nd.loc.a() == n )
+            freeNode(i);
     }
-
-    for( map<DiskLoc,Node*>::iterator i = m.begin(); i != m.end(); ) { 
-        DiskLoc k = i->first;
-        i++;
-        if( k.a() == n )
-            m.erase(k);
+    /* freed pages left in pending or queue are skipped there, but could be reused for
+       another page before they are reached -- drop them now */
+    vector<int> p;
+    for( vector<int>::iterator i = pending.begin(); i != pending.end(); i++ )
+        if( node(*i).inUse )
+            p.push_back(*i);
+    pending.swap(p);
+    deque<int> q;
+    for( deque<int>::iterator i = queue.begin(); i != queue.end(); i++ ) {
+        if( node(*i).inUse )
+            q.push_back(*i);
+        else
+            node(*i).inQueue = false;
     }
+    queue.swap(q);
 
     assert( stores[rs->fileNumber] != 0 );
     stores[rs->fileNumber] = 0;
-/*
-    for( unsigned i = 0; i < stores.size(); i++ ) { 
-        if( stores[i] == rs ) { 
-            stores[i] = 0;
-            break;
-        }
-    }*/
     delete rs; // closes file
 }
 
 void RecCache::drop(const char *_ns) { 
     // todo: test with a non clean shutdown file
+    boostlock wl(writeMutex);
     boostlock lk(rcmutex);
 
     map<string, BasicRecStore*>::iterator it = storesByNsKey.find(mknskey(_ns));
@@ -3,12 +3,24 @@
 /* CachedBasicRecStore
    This is our store which implements a traditional page-cache type of storage
    (not memory mapped files).
+
+   pages live in slabs of SlabNodes pages allocated as the cache grows and never freed, so a
+   pointer from get() stays good until the page is evicted.  lookup is a chained hash on the
+   DiskLoc.  eviction is clock (second chance), done only from dbunlocking_write() when no
+   operation can be holding a page pointer, and never picks a dirty page.
+
+   dirty pages are written behind by the writer thread: pages dirtied during a write lock are
+   queued when it is released (the modification may come after the dirty() call, see reci.h),
+   and the writer takes them off the queue in batches, sorted by file and offset, with
+   adjacent pages written in one call.  if the cache gets too far over size because the writer
+   is behind, releasing the write lock waits for it.
 */
 
 /* LOCK HIERARCHY
-     
+
      dblock
-       RecCache::rcmutex
+       RecCache::writeMutex  (writer thread, while a batch is in flight; closing or dropping a store)
+         RecCache::rcmutex
 
      i.e. always lock dblock first if you lock both
 
@@ -22,23 +34,39 @@
 namespace mongo { 
 
 class RecCache {
+    enum State { Clean, Pending, Queued, Writing };
     struct Node { 
-        Node(void* _data) : data((char *) _data) { dirty = false; newer = 0; }
-        ~Node() { 
-            free(data);
-            data = 0;
-        }
+        Node() : data(0), next(-1), state(Clean), referenced(false), inUse(false), inQueue(false) { }
         char *data;
         DiskLoc loc;
-        bool dirty;
-        Node *older, *newer; // lru
+        int next;          // hash chain, or free list
+        char state;
+        bool referenced;   // clock
+        bool inUse;
+        bool inQueue;
     };
+    enum { SlabNodes = 1024, WriteBatch = 256 };
     boost::mutex &rcmutex; // mainly to coordinate with the lazy writer thread
+    boost::mutex &writeMutex;
+    boost::condition &queuedCond;  // writer waits here for a batch
+    boost::condition &writtenCond; // unlocking threads wait here when the writer is behind
     unsigned recsize;
-    map<DiskLoc, Node*> m; // the cache
-    Node *newest, *oldest;
-    unsigned nnodes;
-    set<DiskLoc> dirtyl;
+
+    vector<Node*> nodeSlabs;
+    vector<char*> dataSlabs;
+    int nslots;            // nodes allocated so far, SlabNodes per slab
+    int freeList;
+    unsigned nnodes;       // in use
+    vector<int> table;     // hash heads
+    unsigned tableMask;
+    int clockHand;
+    vector<int> pending;   // dirtied under the current write lock
+    deque<int> queue;      // waiting for the writer
+    char *writeBuf;
+
+    /* stats */
+    unsigned long long hits, misses, evictions, pagesWritten, writeCalls, writeBatches, stalls;
+
     vector<BasicRecStore*> stores; // DiskLoc::a() indicates the index into this vector
     map<string, BasicRecStore*> storesByNsKey; // nskey -> BasicRecStore*
 public:
@@ -76,77 +104,85 @@ private:
         initStoreByNs(ns, nskey);
         return *rs;
     }
+    /* the writer has no database context to open files with */
+    BasicRecStore* openStore(const DiskLoc& d) const {
+        int n = d.a() - Base;
+        return n < (int) stores.size() ? stores[n] : 0;
+    }
 
-    void writeDirty( set<DiskLoc>::iterator i, bool rawLog = false );
-    void writeIfDirty(Node *n);
-    void touch(Node* n) { 
-        if( n == newest )
-            return;
-        if( n == oldest ) {
-            oldest = oldest->newer;
-            assert( oldest || nnodes == 1 );
-        }
-        if( n->older ) 
-            n->older->newer = n->newer;
-        if( n->newer ) 
-            n->newer->older = n->older;
-        n->newer = 0;        
-        n->older = newest;
-        newest->newer = n;
-        newest = n;
-    }
-    Node* mkNode() { 
-        Node *n = new Node(calloc(recsize,1)); // calloc is TEMP for testing.  change to malloc
-        n->older = newest;
-        if( newest )
-            newest->newer = n;
-        else {
-            assert( oldest == 0 );
-            oldest = n;
+    Node& node(int i) {
+        return nodeSlabs[i / SlabNodes][i % SlabNodes];
+    }
+    unsigned hash(const DiskLoc& d) const {
+        unsigned h = (unsigned) d.a() * 2654435761U ^ (unsigned) d.getOfs() * 40503U;
+        return ( h ^ ( h >> 15 ) ) & tableMask;
+    }
+    int find(const DiskLoc& d) {
+        if( table.empty() )
+            return -1;
+        for( int i = table[hash(d)]; i >= 0; ) {
+            Node& n = node(i);
+            if( n.loc == d )
+                return i;
+            i = n.next;
         }
-        newest = n;
-        nnodes++;
-        return n;
+        return -1;
     }
+    int mkNode(const DiskLoc& d);
+    void freeNode(int i);
+    void growTable();
+    int clockVictim();
+    void queuePending();
+    void evict();
+    void writeNode(Node& n);
+    void flushAll(bool rawLog);
+
     fileofs fileOfs(DiskLoc d) { 
         return ((fileofs) d.getOfs()) * recsize;
     }
 
-    void dump();
     void _ejectOld();
 
 public:
     /* all public functions (except constructor) should use the mutex */
 
-    RecCache(unsigned recsz) : rcmutex( *( new boost::mutex() ) ), recsize(recsz) { 
+    RecCache(unsigned recsz) :
+        rcmutex( *( new boost::mutex() ) ), writeMutex( *( new boost::mutex() ) ),
+        queuedCond( *( new boost::condition() ) ), writtenCond( *( new boost::condition() ) ),
+        recsize(recsz) {
+        nslots = 0;
+        freeList = -1;
         nnodes = 0;
-        newest = oldest = 0;
+        tableMask = 0;
+        clockHand = 0;
+        writeBuf = 0;
+        hits = misses = evictions = pagesWritten = writeCalls = writeBatches = stalls = 0;
     }
 
     /* call this after doing some work, after you are sure you are done with modifications.
        we call it from dbunlocking().
     */
     void ejectOld() { 
-        if( nnodes > MAXNODES ) // just enough here to be inlineable for speed reasons.  _ejectOld does the real work
+        if( nnodes > MAXNODES || !pending.empty() ) // just enough here to be inlineable for speed reasons.  _ejectOld does the real work
             _ejectOld();
     }
 
-    /* bg writer thread invokes this */
+    /* bg writer thread invokes this: waits for a batch of dirty pages (or a second) and writes it */
     void writeLazily();
 
     /* Note that this may be called BEFORE the actual writing to the node 
-       takes place.  We do flushing later on a dbunlocking() call, which happens 
+       takes place.  We queue the page for the writer on the dbunlocking() call, which happens
        after the writing.
     */
     void dirty(DiskLoc d) {
         assert( d.a() >= Base );
         boostlock lk(rcmutex);
-        map<DiskLoc, Node*>::iterator i = m.find(d);
-        if( i != m.end() ) {
-            Node *n = i->second;
-            if( !n->dirty ) { 
-                n->dirty = true;
-                dirtyl.insert(n->loc);
+        int i = find(d);
+        if( i >= 0 ) {
+            Node& n = node(i);
+            if( n.state != Pending ) {
+                n.state = Pending;
+                pending.push_back(i);
             }
         }
     }
@@ -156,17 +192,24 @@ public:
         assert( len == recsize );
 
         boostlock lk(rcmutex);
-        map<DiskLoc, Node*>::iterator i = m.find(d);
-        if( i != m.end() ) {
-            touch(i->second);
-            return i->second->data;
+        int i = find(d);
+        if( i >= 0 ) {
+            hits++;
+            Node& n = node(i);
+            n.referenced = true;
+            return n.data;
         }
 
-        Node *n = mkNode();
-        n->loc = d;
-        store(d).get(fileOfs(d), n->data, recsize); // could throw exception
-        m.insert( pair<DiskLoc, Node*>(d, n) );
-        return n->data;
+        misses++;
+        i = mkNode(d);
+        try {
+            store(d).get(fileOfs(d), node(i).data, recsize);
+        }
+        catch( ... ) {
+            freeNode(i);
+            throw;
+        }
+        return node(i).data;
     }
 
     void drop(const char *ns);
@@ -178,11 +221,9 @@ public:
         assert( o % recsize == 0 );
         fileofs recnum = o / recsize;
         massert( 10377 ,  "RecCache file too large?", recnum <= 0x7fffffff );
-        Node *n = mkNode();
-        memcpy(n->data, obuf, len);
         DiskLoc d(rs.fileNumber + Base, (int) recnum);
-        n->loc = d;
-        m[d] = n;
+        int i = mkNode(d);
+        memcpy(node(i).data, obuf, len);
         return d;
     }
 
@@ -190,6 +231,9 @@ public:
 
     // at termination: write dirty pages and close all files
     void closing();
+
+    // hit rate, write-behind queue depth etc. for serverStatus
+    void appendStats(BSONObjBuilder& b);
 };
 
 extern RecCache theRecCache;
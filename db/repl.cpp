@@ -299,6 +299,7 @@ namespace mongo {
             
 			bool authed = cc().getAuthenticationInfo()->isAuthorizedReads("admin");
             appendReplicationInfo( result , authed );
+            result.append( "wireCompression" , "lz" ); // see MessagingPort::startCompressing()
             return true;
         }
     } cmdismaster;
@@ -548,7 +549,7 @@ namespace mongo {
         BSONObj pattern = b.done();
 
         BSONObj o = jsobj();
-        log( 1 ) << "Saving repl source: " << o << endl;
+        log( 1 , LogRepl ) << "Saving repl source: " << o << endl;
 
         {
             OpDebug debug;
@@ -766,7 +767,7 @@ namespace mongo {
     }
 
     void ReplSource::applyOperation(const BSONObj& op) {
-        log( 6 ) << "applying op: " << op << endl;
+        log( 6 , LogRepl ) << "applying op: " << op << endl;
         OpDebug debug;
         BSONObj o = op.getObjectField("o");
         const char *ns = op.getStringField("ns");
@@ -836,7 +837,7 @@ namespace mongo {
        see logOp() comments.
     */
     void ReplSource::sync_pullOpLog_applyOperation(BSONObj& op, OpTime *localLogTail) {
-        log( 6 ) << "processing op: " << op << endl;
+        log( 6 , LogRepl ) << "processing op: " << op << endl;
         // skip no-op
         if ( op.getStringField( "op" )[ 0 ] == 'n' )
             return;
@@ -876,7 +877,7 @@ namespace mongo {
         bool empty = ctx.db()->isEmpty();
         bool incompleteClone = incompleteCloneDbs.count( clientName ) != 0;
 
-        log( 6 ) << "ns: " << ns << ", justCreated: " << ctx.justCreated() << ", empty: " << empty << ", incompleteClone: " << incompleteClone << endl;
+        log( 6 , LogRepl ) << "ns: " << ns << ", justCreated: " << ctx.justCreated() << ", empty: " << empty << ", incompleteClone: " << incompleteClone << endl;
         
         // always apply admin command command
         // this is a bit hacky -- the semantics of replication/commands aren't well specified
@@ -914,12 +915,12 @@ namespace mongo {
                 if ( !idTracker.haveId( ns, id ) ) {
                     applyOperation( op );    
                 } else if ( idTracker.haveModId( ns, id ) ) {
-                    log( 6 ) << "skipping operation matching mod id object " << op << endl;
+                    log( 6 , LogRepl ) << "skipping operation matching mod id object " << op << endl;
                     BSONObj existing;
                     if ( Helpers::findOne( ns, id, existing ) )
                         logOp( "i", ns, existing );
                 } else {
-                    log( 6 ) << "skipping operation matching changed id object " << op << endl;
+                    log( 6 , LogRepl ) << "skipping operation matching changed id object " << op << endl;
                 }
             } else {
                 applyOperation( op );
@@ -997,7 +998,7 @@ namespace mongo {
     
     void ReplSource::setLastSavedLocalTs( const OpTime &nextLocalTs ) {
         _lastSavedLocalTs = nextLocalTs;
-        log( 3 ) << "updated _lastSavedLocalTs to: " << _lastSavedLocalTs << endl;
+        log( 3 , LogRepl ) << "updated _lastSavedLocalTs to: " << _lastSavedLocalTs << endl;
     }
     
     void ReplSource::resetSlave() {
@@ -1048,7 +1049,7 @@ namespace mongo {
     */
     bool ReplSource::sync_pullOpLog(int& nApplied) {
         string ns = string("local.oplog.$") + sourceName();
-        log(2) << "repl: sync_pullOpLog " << ns << " syncedTo:" << syncedTo.toStringLong() << '\n';
+        log(2 , LogRepl) << "repl: sync_pullOpLog " << ns << " syncedTo:" << syncedTo.toStringLong() << '\n';
 
         bool tailing = true;
         DBClientCursor *c = cursor.get();
@@ -1081,7 +1082,7 @@ namespace mongo {
                     if ( !e.embeddedObject().getBoolField( "empty" ) ) {
                         if ( name != "local" ) {
                             if ( only.empty() || only == name ) {
-                                log( 2 ) << "adding to 'addDbNextPass': " << name << endl;
+                                log( 2 , LogRepl ) << "adding to 'addDbNextPass': " << name << endl;
                                 addDbNextPass.insert( name );
                             }
                         }
@@ -1102,7 +1103,7 @@ namespace mongo {
             BSONObj queryObj = query.done();
             // queryObj = { ts: { $gte: syncedTo } }
 
-            log(2) << "repl: " << ns << ".find(" << queryObj.toString() << ')' << '\n';
+            log(2 , LogRepl) << "repl: " << ns << ".find(" << queryObj.toString() << ')' << '\n';
             cursor = conn->query( ns.c_str(), queryObj, 0, 0, 0, 
                                   QueryOption_CursorTailable | QueryOption_SlaveOk | QueryOption_OplogReplay |
                                   QueryOption_AwaitData
@@ -1111,7 +1112,7 @@ namespace mongo {
             tailing = false;
         }
         else {
-            log(2) << "repl: tailing=true\n";
+            log(2 , LogRepl) << "repl: tailing=true\n";
         }
 
         if ( c == 0 ) {
@@ -1134,7 +1135,7 @@ namespace mongo {
 
         if ( !c->more() ) {
             if ( tailing ) {
-                log(2) << "repl: tailing & no new activity\n";
+                log(2 , LogRepl) << "repl: tailing & no new activity\n";
             } else {
                 log() << "repl:   " << ns << " oplog is empty\n";
             }
@@ -1181,10 +1182,10 @@ namespace mongo {
         }
         
         OpTime nextOpTime( ts.date() );
-        log(2) << "repl: first op time received: " << nextOpTime.toString() << '\n';
+        log(2 , LogRepl) << "repl: first op time received: " << nextOpTime.toString() << '\n';
         if ( tailing || initial ) {
             if ( initial )
-                log(1) << "repl:   initial run\n";
+                log(1 , LogRepl) << "repl:   initial run\n";
             else
                 assert( syncedTo < nextOpTime );
             sync_pullOpLog_applyOperation(op, &localLogTail);
@@ -1449,11 +1450,11 @@ namespace mongo {
                 localOplogMainDetails = nsdetails(logNS);
             }
             Client::Context ctx( "" , localOplogDB );
-            r = theDataFileMgr.fast_oplog_insert(localOplogMainDetails, logNS, len);
+            r = theDataFileMgr.fast_oplog_insert(localOplogMainDetails, logNS, len, ts.asDate());
         } else {
             Client::Context ctx( logNS );
             assert( nsdetails( logNS ) );
-            r = theDataFileMgr.fast_oplog_insert( nsdetails( logNS ), logNS, len);
+            r = theDataFileMgr.fast_oplog_insert( nsdetails( logNS ), logNS, len, ts.asDate());
         }
 
         char *p = r->data;
@@ -1469,7 +1470,7 @@ namespace mongo {
         
         if ( logLevel >= 6 ) {
             BSONObj temp(r);
-            log( 6 ) << "logging op:" << temp << endl;
+            log( 6 , LogRepl ) << "logging op:" << temp << endl;
         }
     }
 
@@ -1690,7 +1691,7 @@ namespace mongo {
         if ( replSettings.slave || replPair ) {
             if ( replSettings.slave ) {
 				assert( replSettings.slave == SimpleSlave );
-                log(1) << "slave=true" << endl;
+                log(1 , LogRepl) << "slave=true" << endl;
 			}
 			else
 				replSettings.slave = ReplPairSlave;
@@ -1699,7 +1700,7 @@ namespace mongo {
 
         if ( replSettings.master || replPair ) {
             if ( replSettings.master )
-                log(1) << "master=true" << endl;
+                log(1 , LogRepl) << "master=true" << endl;
             replSettings.master = true;
             createOplog();
         }
@@ -32,10 +32,12 @@ namespace mongo {
     class KeyType : boost::noncopyable {
     public:
         BSONObj pattern; // e.g., { ts : -1 }
+        Ordering ordering; // of pattern
     public:
         KeyType(BSONObj _keyPattern) {
             pattern = _keyPattern;
             assert( !pattern.isEmpty() );
+            ordering = Ordering::make( pattern );
         }
 
         // returns the key value for o
@@ -86,7 +88,7 @@ namespace mongo {
 
         void _addIfBetter(BSONObj& k, BSONObj o, BestMap::iterator i) {
             const BSONObj& worstBestKey = i->first;
-            int c = worstBestKey.woCompare(k, order.pattern);
+            int c = worstBestKey.woCompare(k, order.ordering);
             if ( c > 0 ) {
                 // k is better, 'upgrade'
                 best.erase(i);
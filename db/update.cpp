@@ -495,6 +495,12 @@ namespace mongo {
         return b.obj();
     }
 
+    BSONObj ModSetState::createNewFromMods( Arena& arena ) {
+        BSONObjBuilder b( arena , (int)(_obj.objsize() * 1.1) );
+        createNewFromMods( "" , b , _obj );
+        return b.obj();
+    }
+
     BSONObj ModSet::createNewFromQuery( const BSONObj& query ){
         BSONObj newObj;
 
@@ -629,6 +635,20 @@ namespace mongo {
     };
 
     
+    /* bit i is set if mods may change index i's keys.  updateRecord() leaves the other indexes'
+       keys alone, or on a move just repoints their entries. */
+    static unsigned long long keysMayChange( NamespaceDetails *d, const ModSet& mods ) {
+        unsigned long long bits = 0;
+        int z = d->nIndexesBeingBuilt();
+        for ( int i = 0; i < z; i++ ) {
+            set<string> fields;
+            d->idx(i).keyPattern().getFieldNames(fields);
+            if ( mods.touches( fields ) )
+                bits |= ((unsigned long long) 1) << i;
+        }
+        return bits;
+    }
+
     UpdateResult updateObjects(const char *ns, const BSONObj& updateobj, BSONObj patternOrig, bool upsert, bool multi, bool logop , OpDebug& debug ) {
         int profile = cc().database()->profile;
         StringBuilder& ss = debug.str;
@@ -648,6 +668,7 @@ namespace mongo {
         auto_ptr<ModSet> mods;
         bool isOperatorUpdate = updateobj.firstElement().fieldName()[0] == '$';
         int modsIsIndexed = false; // really the # of indexes
+        unsigned long long idxKeysMayChange = ~0ULL;
         if ( isOperatorUpdate ){
             if( d && d->backgroundIndexBuildInProgress ) { 
                 set<string> bgKeys;
@@ -658,6 +679,8 @@ namespace mongo {
                 mods.reset( new ModSet(updateobj, nsdt->indexKeys()) );
             }
             modsIsIndexed = mods->isIndexed();
+            if( d )
+                idxKeysMayChange = keysMayChange( d, *mods );
         }
 
         set<DiskLoc> seenObjects;
@@ -667,6 +690,8 @@ namespace mongo {
         shared_ptr< UpdateOp > u = qps.runOp( original );
         massert( 10401 ,  u->exceptionMessage(), u->complete() );
         shared_ptr< Cursor > c = u->c();
+        if ( profile )
+            debug.plan = c->toString();
         int numModded = 0;
         while ( c->ok() ) {
             if ( numModded > 0 && ! u->curMatches() ){
@@ -701,8 +726,10 @@ namespace mongo {
                 }
             }
             
-            if ( profile )
+            if ( profile ) {
                 ss << " nscanned:" << u->nscanned();
+                debug.nscanned = u->nscanned();
+            }
             
             /* look for $inc etc.  note as listed here, all fields to inc must be this type, you can't set some
                regular ones at the moment. */
@@ -733,9 +760,13 @@ namespace mongo {
                     }
                 } 
                 else {
-                    BSONObj newObj = mss->createNewFromMods();
+                    // the new object is copied into the record, so build it in op scratch space
+                    Arena& arena = cc().curop()->arena();
+                    Arena::Mark scratch = arena.mark();
+                    BSONObj newObj = mss->createNewFromMods( arena );
                     uassert( 12522 , "$ operator made object too large" , newObj.isValid() );
-                    DiskLoc newLoc = theDataFileMgr.updateRecord(ns, d, nsdt, r, loc , newObj.objdata(), newObj.objsize(), debug);
+                    DiskLoc newLoc = theDataFileMgr.updateRecord(ns, d, nsdt, r, loc , newObj.objdata(), newObj.objsize(), debug, idxKeysMayChange);
+                    arena.rewind( scratch );
                     if ( newLoc != loc || modsIsIndexed ) {
                         // object moved, need to make sure we don' get again
                         seenObjects.insert( newLoc );
@@ -780,8 +811,10 @@ namespace mongo {
             return UpdateResult( 1 , 1 , numModded );
 
         
-        if ( profile )
+        if ( profile ) {
             ss << " nscanned:" << u->nscanned();
+            debug.nscanned = u->nscanned();
+        }
         
         if ( upsert ) {
             if ( updateobj.firstElement().fieldName()[0] == '$' ) {
@@ -100,11 +100,38 @@ namespace mongo {
         }
         
         bool isIndexed( const set<string>& idxKeys ) const {
+            string fullName = fieldName;
+            if ( isIndexed( fullName, idxKeys ) )
+                return true;
+            // a.0.b may be the b of an element of array a: check it as a.b too
+            string generic = withoutPositions( fullName );
+            return generic != fullName && isIndexed( generic, idxKeys );
+        }
+
+        /* fullName with its all digit components left out, e.g. a.0.b -> a.b */
+        static string withoutPositions( const string& fullName ) {
+            string out;
+            size_t start = 0;
+            while ( start <= fullName.size() ) {
+                size_t dot = fullName.find( '.', start );
+                if ( dot == string::npos )
+                    dot = fullName.size();
+                string part = fullName.substr( start, dot - start );
+                if ( part.empty() || part.find_first_not_of( "0123456789" ) != string::npos ) {
+                    if ( !out.empty() )
+                        out += '.';
+                    out += part;
+                }
+                start = dot + 1;
+            }
+            return out;
+        }
+
+        static bool isIndexed( const string& fullName, const set<string>& idxKeys ) {
             // check if there is an index key that is a parent of mod
-            for( const char *dot = strchr( fieldName, '.' ); dot; dot = strchr( dot + 1, '.' ) )
-                if ( idxKeys.count( string( fieldName, dot - fieldName ) ) )
+            for( size_t dot = fullName.find( '.' ); dot != string::npos; dot = fullName.find( '.', dot + 1 ) )
+                if ( idxKeys.count( fullName.substr( 0, dot ) ) )
                     return true;
-            string fullName = fieldName;
             // check if there is an index key equal to mod
             if ( idxKeys.count(fullName) )
                 return true;
@@ -262,6 +289,14 @@ namespace mongo {
 
         unsigned size() const { return _mods.size(); }
 
+        /* true if a mod may change the value of one of fields, e.g. an index's key fields */
+        bool touches( const set<string>& fields ) const {
+            for ( ModHolder::const_iterator i = _mods.begin(); i != _mods.end(); i++ )
+                if ( i->second.isIndexed( fields ) )
+                    return true;
+            return false;
+        }
+
         bool haveModForField( const char *fieldName ) const {
             return _mods.find( fieldName ) != _mods.end();
         }
@@ -451,6 +486,9 @@ namespace mongo {
 
         BSONObj createNewFromMods();
 
+        /* as above, but built in arena: only valid until the arena is rewound/released */
+        BSONObj createNewFromMods( Arena& arena );
+
         // re-writing for oplog
 
         bool needOpLogRewrite() const {
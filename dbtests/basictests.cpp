@@ -21,6 +21,9 @@
 
 #include "dbtests.h"
 #include "../util/base64.h"
+#include "../util/compress.h"
+#include "../util/histogram.h"
+#include "../db/introspect.h"
 
 namespace BasicTests {
 
@@ -183,6 +186,146 @@ namespace BasicTests {
 
     }
 
+    class ArenaTests {
+    public:
+        void run(){
+            Arena a;
+            Arena::Mark start = a.mark();
+            {
+                BSONObjBuilder b( a , 16 );
+                for ( int i = 0; i < 1000; i++ )
+                    b.append( b.numStr( i ).c_str() , i );
+                BSONObj o = b.obj();
+                ASSERT_EQUALS( 1000 , o.nFields() );
+                ASSERT_EQUALS( 999 , o["999"].numberInt() );
+            }
+            char *big = (char *) a.alloc( Arena::ChunkSize * 2 );
+            memset( big , 1 , Arena::ChunkSize * 2 );
+            a.rewind( start );
+            char *p = (char *) a.alloc( 10 );
+            p = (char *) a.grow( p , 10 , 100 );
+            memset( p , 2 , 100 );
+            a.release();
+        }
+    };
+
+    class CompressTests {
+    public:
+        void run(){
+            roundTrip( "" );
+            roundTrip( "abc" );
+            string s;
+            for ( int i = 0; i < 20000; i++ )
+                s += BSONObjBuilder::numStr( i % 100 );
+            int n = roundTrip( s );
+            ASSERT( n < (int) s.size() / 4 );
+
+            // random bytes don't shrink, but still come back
+            string r;
+            for ( int i = 0; i < 5000; i++ )
+                r += (char) rand();
+            roundTrip( r );
+            char small[ 10 ];
+            ASSERT_EQUALS( 0 , lzCompress( r.data() , r.size() , small , sizeof( small ) ) );
+
+            // damaged input is refused, not overrun
+            vector<char> c( lzCompressBound( s.size() ) );
+            n = lzCompress( s.data() , s.size() , &c[0] , c.size() );
+            vector<char> out( s.size() );
+            ASSERT( !lzDecompress( &c[0] , n - 1 , &out[0] , out.size() ) );
+            ASSERT( !lzDecompress( &c[0] , n , &out[0] , out.size() - 1 ) );
+        }
+    private:
+        int roundTrip( const string& s ){
+            vector<char> c( lzCompressBound( s.size() ) );
+            int n = lzCompress( s.data() , s.size() , &c[0] , c.size() );
+            ASSERT( n > 0 );
+            vector<char> out( s.size() + 1 );
+            ASSERT( lzDecompress( &c[0] , n , &out[0] , s.size() ) );
+            ASSERT( string( &out[0] , s.size() ) == s );
+            return n;
+        }
+    };
+
+    class HistogramTests {
+    public:
+        void run(){
+            LatencyHistogram h;
+            ASSERT_EQUALS( 0ULL , h.percentile( 99 ) );
+
+            for ( unsigned long long v = 1; v <= 100000; v++ )
+                h.record( v );
+            ASSERT_EQUALS( 100000ULL , h.count() );
+            ASSERT_EQUALS( 1ULL , h.minValue() );
+            ASSERT_EQUALS( 100000ULL , h.maxValue() );
+            ASSERT_EQUALS( 50000ULL , h.mean() );
+            within( 50000 , h.percentile( 50 ) );
+            within( 90000 , h.percentile( 90 ) );
+            within( 99000 , h.percentile( 99 ) );
+            ASSERT_EQUALS( 100000ULL , h.percentile( 100 ) );
+
+            // exact for small values
+            LatencyHistogram s;
+            for ( int i = 0; i < 10; i++ )
+                s.record( i );
+            ASSERT_EQUALS( 4ULL , s.percentile( 50 ) );
+
+            LatencyHistogram big;
+            big.record( ~0ULL );
+            s.merge( big );
+            ASSERT_EQUALS( 11ULL , s.count() );
+            ASSERT_EQUALS( ~0ULL , s.percentile( 100 ) );
+            ASSERT_EQUALS( 9ULL , s.percentile( 90 ) );
+        }
+    private:
+        // buckets are good to about 3%
+        void within( unsigned long long expected , unsigned long long v ){
+            ASSERT( v >= expected );
+            ASSERT( v <= expected + expected / 32 );
+        }
+    };
+
+    class ProfileRingTests {
+    public:
+        void run(){
+            ProfileRing ring;
+            ring.init( 4 , true );
+            for ( int i = 0; i < 6; i++ ){
+                ProfileRing::Record r;
+                r.ns = i % 2 ? "a.foo" : "b.foo";
+                r.millis = i;
+                ring.add( r );
+            }
+
+            vector<ProfileRing::Record> v;
+            ring.get( "" , 100 , v );
+            ASSERT_EQUALS( 4U , v.size() );
+            ASSERT_EQUALS( 5 , v[0].millis );
+            ASSERT_EQUALS( 2 , v[3].millis );
+
+            v.clear();
+            ring.get( "a" , 100 , v );
+            ASSERT_EQUALS( 2U , v.size() );
+            ASSERT_EQUALS( 5 , v[0].millis );
+            ASSERT_EQUALS( 3 , v[1].millis );
+
+            // 6 added to a ring of 4: the first 2 were overwritten before a flush
+            v.clear();
+            ring.takeUnflushed( v );
+            ASSERT_EQUALS( 4U , v.size() );
+            ASSERT_EQUALS( 2 , v[0].millis );
+            v.clear();
+            ring.takeUnflushed( v );
+            ASSERT_EQUALS( 0U , v.size() );
+
+            BSONObjBuilder b;
+            ring.appendStats( b );
+            BSONObj o = b.obj();
+            ASSERT_EQUALS( 2 , o["lost"].numberInt() );
+            ASSERT_EQUALS( 0 , o["pending"].numberInt() );
+        }
+    };
+
     class sleeptest {
     public:
         void run(){
@@ -242,6 +385,11 @@ namespace BasicTests {
             add< stringbuildertests::reset1 >();
             add< stringbuildertests::reset2 >();
 
+            add< ArenaTests >();
+            add< CompressTests >();
+            add< HistogramTests >();
+            add< ProfileRingTests >();
+
             add< sleeptest >();
             add< AssertTests >();
         }
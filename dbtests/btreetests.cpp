@@ -28,7 +28,7 @@ namespace BtreeTests {
 
     class Base {
     public:
-        Base() : 
+        Base( bool counted = false ) : 
             _context( ns() ) {
             
             {
@@ -39,6 +39,8 @@ namespace BtreeTests {
             BSONObjBuilder builder;
             builder.append( "ns", ns() );
             builder.append( "name", "testIndex" );
+            if ( counted )
+                builder.appendBool( "counted", true );
             BSONObj bobj = builder.done();
             idx_.info =
                 theDataFileMgr.insert( ns(), bobj.objdata(), bobj.objsize() );
@@ -95,8 +97,8 @@ namespace BtreeTests {
             ASSERT( location == expectedLocation );
             ASSERT_EQUALS( expectedPos, pos );
         }
-        BSONObj order() const {
-            return idx_.keyPattern();
+        Ordering order() const {
+            return Ordering::make( idx_.keyPattern() );
         }
     private:
         dblock lk_;
@@ -221,6 +223,94 @@ namespace BtreeTests {
         }
     };
 
+    class Counted : public Base {
+    public:
+        Counted() : Base( true ) {}
+        void run() {
+            ASSERT( bt()->isCounted() );
+            // big keys so that we split a few levels deep
+            string pad( 700, 'x' );
+            for ( int i = 0; i < 300; ++i ) {
+                BSONObj k = key( ( i * 7 ) % 300, pad );
+                insert( k );
+            }
+            checkCounts( 300, pad );
+
+            for ( int i = 0; i < 300; i += 2 ) {
+                BSONObj k = key( i, pad );
+                unindex( k );
+            }
+            // the odd keys are left; key 2j+1 has rank j
+            ASSERT_EQUALS( 150, bt()->fullValidate( dl(), order() ) );
+            ASSERT_EQUALS( 150, BtreeBucket::subtreeKeys( dl() ) );
+            for ( int j = 0; j < 150; ++j ) {
+                BSONObj k = key( 2 * j + 1, pad );
+                ASSERT_EQUALS( j, bt()->keysBefore( id(), dl(), k, order(), minDiskLoc ) );
+                int pos;
+                DiskLoc b = bt()->keyAtRank( dl(), j, pos );
+                ASSERT( !b.isNull() );
+                ASSERT_EQUALS( 2 * j + 1, b.btree()->keyAt( pos )[ "a" ].numberInt() );
+            }
+        }
+    private:
+        static BSONObj key( int i, const string& pad ) {
+            return BSON( "a" << i << "b" << pad );
+        }
+        void checkCounts( int nKeys, const string& pad ) {
+            ASSERT_EQUALS( nKeys, bt()->fullValidate( dl(), order() ) );
+            ASSERT_EQUALS( nKeys, BtreeBucket::subtreeKeys( dl() ) );
+            for ( int i = 0; i < nKeys; ++i ) {
+                BSONObj k = key( i, pad );
+                ASSERT_EQUALS( i, bt()->keysBefore( id(), dl(), k, order(), minDiskLoc ) );
+                ASSERT_EQUALS( i + 1, bt()->keysBefore( id(), dl(), k, order(), maxDiskLoc ) );
+            }
+            int pos;
+            ASSERT( bt()->keyAtRank( dl(), nKeys, pos ).isNull() );
+        }
+    };
+
+    class Repoint : public Base {
+    public:
+        void run() {
+            BSONObj a = simpleKey( 'a' );
+            BSONObj b = simpleKey( 'b' );
+            insertAt( a, 2 );
+            insertAt( a, 10 );
+            insertAt( a, 20 );
+            insertAt( b, 2 );
+            checkValid( 4 );
+
+            // still between its equal neighbours: rewritten in place
+            ASSERT( bt()->repoint( dl(), id(), a, DiskLoc( 0, 10 ), DiskLoc( 0, 14 ) ) );
+            ASSERT( !found( a, 10 ) );
+            ASSERT( found( a, 14 ) );
+
+            // would pass ( 0, 20 ): left alone
+            ASSERT( !bt()->repoint( dl(), id(), a, DiskLoc( 0, 14 ), DiskLoc( 0, 30 ) ) );
+            ASSERT( found( a, 14 ) );
+            ASSERT( !bt()->repoint( dl(), id(), a, DiskLoc( 0, 2 ), DiskLoc( 0, 16 ) ) );
+            ASSERT( found( a, 2 ) );
+
+            // no equal neighbours
+            ASSERT( bt()->repoint( dl(), id(), b, DiskLoc( 0, 2 ), DiskLoc( 0, 100 ) ) );
+            ASSERT( found( b, 100 ) );
+
+            // not there
+            ASSERT( !bt()->repoint( dl(), id(), b, DiskLoc( 0, 2 ), DiskLoc( 0, 4 ) ) );
+            checkValid( 4 );
+        }
+    private:
+        void insertAt( BSONObj &key, int ofs ) {
+            bt()->bt_insert( dl(), DiskLoc( 0, ofs ), key, order(), true, id(), true );
+        }
+        bool found( BSONObj &key, int ofs ) {
+            int pos;
+            bool f;
+            bt()->locate( id(), dl(), key, order(), pos, f, DiskLoc( 0, ofs ) );
+            return f;
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "btree" ){
@@ -233,6 +323,8 @@ namespace BtreeTests {
             add< SplitLeftHeavyBucket >();
             add< MissingLocate >();
             add< MissingLocateMultiBucket >();
+            add< Counted >();
+            add< Repoint >();
         }
     } myall;
 }
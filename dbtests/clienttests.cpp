@@ -2,6 +2,8 @@
 
 #include "stdafx.h"
 #include "../client/dbclient.h"
+#include "../client/gridfs.h"
+#include "../util/md5.hpp"
 #include "dbtests.h"
 #include "../db/concurrency.h"
  
@@ -97,6 +99,56 @@ namespace ClientTests {
     };
     
 
+    class GridFSRoundTrip : public Base {
+    public:
+        GridFSRoundTrip() : Base( "gridfs.files" ) {}
+        ~GridFSRoundTrip() {
+            db.dropCollection( "test.gridfs.chunks" );
+        }
+        void run() {
+            string data( 600000, 'x' );
+            for( unsigned i = 0; i < data.size(); ++i )
+                data[ i ] = (char)( i * 7 + i / 1000 );
+
+            GridFS grid( db, "test", "gridfs" );
+            BSONObj file = grid.storeFile( data.c_str(), data.size(), "roundtrip" );
+            ASSERT_EQUALS( 600000, file[ "length" ].number() );
+
+            md5digest d;
+            md5( data.c_str(), data.size(), d );
+            ASSERT_EQUALS( digestToString( d ), file[ "md5" ].str() );
+            BSONObj res;
+            ASSERT( db.runCommand( "test", BSON( "filemd5" << file[ "_id" ] << "root" << "gridfs" ), res ) );
+            ASSERT_EQUALS( res[ "md5" ].str(), file[ "md5" ].str() );
+
+            GridFile f = grid.findFile( "roundtrip" );
+            ASSERT( f.exists() );
+            ASSERT_EQUALS( 3, f.getNumChunks() );
+            {
+                stringstream ss;
+                ASSERT_EQUALS( 600000U, f.write( ss ) );
+                ASSERT( data == ss.str() );
+            }
+            {
+                // spans the first chunk boundary
+                stringstream ss;
+                ASSERT_EQUALS( 200U, f.write( ss, 262100, 200 ) );
+                ASSERT( data.substr( 262100, 200 ) == ss.str() );
+            }
+            {
+                // runs off the end
+                stringstream ss;
+                ASSERT_EQUALS( 10U, f.write( ss, 599990, 100 ) );
+                ASSERT( data.substr( 599990 ) == ss.str() );
+            }
+            {
+                stringstream ss;
+                ASSERT_EQUALS( 0U, f.write( ss, 600000, 100 ) );
+                ASSERT( ss.str().empty() );
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "client" ){
@@ -107,6 +159,7 @@ namespace ClientTests {
             add<ReIndex>();
             add<ReIndex2>();
             add<CS_10>();
+            add<GridFSRoundTrip>();
         }
         
     } all;
@@ -131,6 +131,63 @@ namespace JsobjTests {
             }
         };
 
+        class WoCompareOrdering : public Base {
+        public:
+            void run() {
+                Ordering o = Ordering::make( BSON( "a" << 1 << "b" << -1 << "c" << "2d" ) );
+                ASSERT_EQUALS( 3, o.nFields() );
+                ASSERT_EQUALS( 1, o.get( 0 ) );
+                ASSERT_EQUALS( -1, o.get( 1 ) );
+                ASSERT_EQUALS( 1, o.get( 2 ) );
+                ASSERT_EQUALS( 1, o.get( 3 ) );
+
+                // the precomputed compare agrees with the key pattern one, across the
+                // types it compares in place and the ones it hands off
+                OID oid;
+                oid.init();
+                double inf = numeric_limits< double >::infinity();
+                vector< BSONObj > v;
+                v.push_back( BSON( "" << 1 << "" << 2 ) );
+                v.push_back( BSON( "" << 1 << "" << 3 ) );
+                v.push_back( BSON( "" << 1.5 << "" << "x" ) );
+                v.push_back( BSON( "" << inf << "" << 1 ) );
+                v.push_back( BSON( "" << -inf << "" << 1 ) );
+                v.push_back( BSON( "" << numeric_limits< double >::quiet_NaN() << "" << 1 ) );
+                v.push_back( BSON( "" << 4LL << "" << 2 ) );
+                v.push_back( BSON( "" << 5LL << "" << 2.0 ) );
+                v.push_back( BSON( "" << "abc" << "" << oid ) );
+                v.push_back( BSON( "" << "abd" << "" << oid ) );
+                v.push_back( BSON( "" << oid << "" << "abc" ) );
+                v.push_back( BSON( "" << Date_t( 1000 ) << "" << 1 ) );
+                v.push_back( BSON( "" << Date_t( 2000 ) << "" << 1 ) );
+                v.push_back( BSON( "" << BSON( "x" << 1 ) << "" << 1 ) );
+                v.push_back( fromjson( "{'':null,'':1}" ) );
+                v.push_back( BSON( "" << 1 ) );
+                v.push_back( BSON( "a" << 1 << "b" << 2 ) );
+
+                vector< BSONObj > patterns;
+                patterns.push_back( BSONObj() );
+                patterns.push_back( BSON( "a" << 1 ) );
+                patterns.push_back( BSON( "a" << -1 ) );
+                patterns.push_back( BSON( "a" << 1 << "b" << -1 ) );
+                patterns.push_back( BSON( "a" << -1 << "b" << -1 ) );
+                for ( unsigned p = 0; p < patterns.size(); p++ ) {
+                    Ordering ord = Ordering::make( patterns[ p ] );
+                    for ( unsigned i = 0; i < v.size(); i++ )
+                        for ( unsigned j = 0; j < v.size(); j++ ) {
+                            ASSERT_EQUALS( sign( v[ i ].woCompare( v[ j ], patterns[ p ] ) ),
+                                           sign( v[ i ].woCompare( v[ j ], ord ) ) );
+                            ASSERT_EQUALS( sign( v[ i ].woCompare( v[ j ], patterns[ p ], false ) ),
+                                           sign( v[ i ].woCompare( v[ j ], ord, false ) ) );
+                        }
+                }
+            }
+        private:
+            static int sign( int i ) {
+                return i < 0 ? -1 : ( i > 0 ? 1 : 0 );
+            }
+        };
+
         class WoCompareDifferentLength : public Base {
         public:
             void run() {
@@ -1400,6 +1457,7 @@ namespace JsobjTests {
             add< BSONObjTests::WoCompareEmbeddedObject >();
             add< BSONObjTests::WoCompareEmbeddedArray >();
             add< BSONObjTests::WoCompareOrdered >();
+            add< BSONObjTests::WoCompareOrdering >();
             add< BSONObjTests::WoCompareDifferentLength >();
             add< BSONObjTests::WoSortOrder >();
             add< BSONObjTests::MultiKeySortOrder > ();
@@ -1021,6 +1021,58 @@ namespace JsonTests {
                 return "{ \"time.valid\" : { $gt : new Date(1257829200000) , $lt : new Date( 1257829200100 ) } }";
             }
         };
+
+        class LongArray : public Base {
+            virtual BSONObj bson() const {
+                BSONObjBuilder b;
+                BSONArrayBuilder a;
+                for ( int i = 0; i < 150; i++ )
+                    a.append( i );
+                b.appendArray( "a", a.arr() );
+                return b.obj();
+            }
+            virtual string json() const {
+                stringstream ss;
+                ss << "{ \"a\" : [ ";
+                for ( int i = 0; i < 150; i++ )
+                    ss << ( i ? ", " : "" ) << i;
+                ss << " ] }";
+                return ss.str();
+            }
+        };
+
+        class TrailingWhitespace : public Base {
+            virtual BSONObj bson() const {
+                return BSON( "a" << 1 );
+            }
+            virtual string json() const {
+                return " { \"a\" : 1 } \r\n";
+            }
+        };
+
+        class TrailingGarbage : public Bad {
+            virtual string json() const {
+                return "{ \"a\" : 1 } x";
+            }
+        };
+
+        class ControlCharacter : public Bad {
+            virtual string json() const {
+                return "{ \"a\" : \"\x01\" }";
+            }
+        };
+
+        class IntegerTooLong : public Bad {
+            virtual string json() const {
+                return "{ \"a\" : 12345678901234567890 }";
+            }
+        };
+
+        class DateOverflow : public Bad {
+            virtual string json() const {
+                return "{ \"a\" : { \"$date\" : 18446744073709551616 } }";
+            }
+        };
         
 
     } // namespace FromJsonTests
@@ -1110,6 +1162,12 @@ namespace JsonTests {
             add< FromJsonTests::EmbeddedDatesFormat1 >();
             add< FromJsonTests::EmbeddedDatesFormat2 >();
             add< FromJsonTests::EmbeddedDatesFormat3 >();
+            add< FromJsonTests::LongArray >();
+            add< FromJsonTests::TrailingWhitespace >();
+            add< FromJsonTests::TrailingGarbage >();
+            add< FromJsonTests::ControlCharacter >();
+            add< FromJsonTests::IntegerTooLong >();
+            add< FromJsonTests::DateOverflow >();
         }
     } myall;
 
@@ -108,6 +108,28 @@ namespace MatcherTests {
         }        
     };
     
+    class MultipleFields {
+    public:
+        void run() {
+            Matcher m( fromjson( "{a:1,'b.c':{$gt:2},'b.d':'x',e:{$exists:false}}" ) );
+            ASSERT( m.matches( fromjson( "{z:0,b:{c:3,d:'x'},a:1}" ) ) );
+            ASSERT( m.matches( fromjson( "{a:1,b:[{c:1},{c:5,d:'x'}]}" ) ) );
+            ASSERT( !m.matches( fromjson( "{a:1,b:{c:2,d:'x'}}" ) ) );
+            ASSERT( !m.matches( fromjson( "{a:1,b:{c:3,d:'x'},e:null}" ) ) );
+            ASSERT( !m.matches( fromjson( "{a:1,b:3}" ) ) );
+            ASSERT( !m.matches( fromjson( "{b:{c:3,d:'x'}}" ) ) );
+        }
+    };
+
+    class MixedTypeGt {
+    public:
+        void run() {
+            Matcher m( fromjson( "{a:{$gt:4},b:{$lt:'m'}}" ) );
+            ASSERT( m.matches( fromjson( "{a:5.5,b:'c'}" ) ) );
+            ASSERT( !m.matches( fromjson( "{a:'5',b:'c'}" ) ) );
+            ASSERT( !m.matches( fromjson( "{a:5,b:1}" ) ) );
+        }
+    };
 
     class All : public Suite {
     public:
@@ -121,6 +143,8 @@ namespace MatcherTests {
             add< MixedNumericGt >();
             add< MixedNumericIN >();
             add< Size >();
+            add< MultipleFields >();
+            add< MixedTypeGt >();
         }
     } dball;
     
@@ -729,6 +729,33 @@ namespace NamespaceTests {
             }
         };
 
+        class SizeClasses : public Base {
+        public:
+            void run() {
+                create();
+                ASSERT( nsd()->sizeClasses() );
+                BSONObj o = bigObj();
+                DiskLoc l[ 3 ];
+                for ( int i = 0; i < 3; ++i ) {
+                    l[ i ] = theDataFileMgr.insert( ns(), o.objdata(), o.objsize() );
+                    ASSERT_EQUALS( 256, l[ i ].rec()->lengthWithHeaders );
+                }
+                // the freed record is the head of the list its class allocates from
+                theDataFileMgr.deleteRecord( ns(), l[ 1 ].rec(), l[ 1 ] );
+                BSONObj smaller = BSON( "a" << string( 150, 'a' ) );
+                ASSERT( theDataFileMgr.insert( ns(), smaller.objdata(), smaller.objsize() ) == l[ 1 ] );
+                ASSERT_EQUALS( 3, nRecords() );
+
+                ASSERT_EQUALS( 32, NamespaceDetails::sizeClassFor( 17 ) );
+                ASSERT_EQUALS( 512, NamespaceDetails::sizeClassFor( 257 ) );
+                ASSERT_EQUALS( 0x400001, NamespaceDetails::sizeClassFor( 0x400001 ) );
+            }
+        private:
+            virtual string spec() const {
+                return "{\"sizeClasses\":true}";
+            }
+        };
+
         // This isn't a particularly useful test, and because it doesn't clean up
         // after itself, /tmp/unittest needs to be cleared after running.
         //        class BigCollection : public Base {
@@ -789,6 +816,7 @@ namespace NamespaceTests {
             add< NamespaceDetailsTests::Realloc >();
             add< NamespaceDetailsTests::TwoExtent >();
             add< NamespaceDetailsTests::Migrate >();
+            add< NamespaceDetailsTests::SizeClasses >();
             //            add< NamespaceDetailsTests::BigCollection >();
             add< NamespaceDetailsTests::Size >();
         }
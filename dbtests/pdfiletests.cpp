@@ -22,6 +22,8 @@
 
 #include "../db/db.h"
 #include "../db/json.h"
+#include "../db/dbhelpers.h"
+#include "../db/query.h"
 
 #include "dbtests.h"
 
@@ -301,6 +303,221 @@ namespace PdfileTests {
             }
         };
     } // namespace Insert
+
+    /* a collection spread over a few small extents, for the tests that work an extent at a time */
+    class ExtentsBase {
+    public:
+        ExtentsBase( const char *ns ) : ns_( ns ), _context( ns ){
+        }
+        virtual ~ExtentsBase() {
+            if ( !nsd() )
+                return;
+            string n( ns_ );
+            dropNS( n );
+        }
+    protected:
+        const char *ns() const {
+            return ns_.c_str();
+        }
+        NamespaceDetails *nsd() const {
+            return nsdetails( ns() );
+        }
+        int nExtents() const {
+            int n = 0;
+            for ( DiskLoc i = nsd()->firstExtent; !i.isNull(); i = i.ext()->xnext )
+                ++n;
+            return n;
+        }
+        void insert( int i ) const {
+            BSONObj o = BSON( "_id" << i << "s" << string( 100, 'x' ) );
+            theDataFileMgr.insert( ns(), o );
+        }
+        /* 200 records of ~130 bytes across 4 extents */
+        void fill() const {
+            string err;
+            ASSERT( userCreateNS( ns(), fromjson( "{size:10000,$nExtents:4}" ), err, false ) );
+            for ( int i = 0; i < 200; ++i )
+                insert( i );
+            ASSERT_EQUALS( 4, nExtents() );
+        }
+    private:
+        string ns_;
+        dblock lk_;
+        Client::Context _context;
+    };
+
+    namespace Compact {
+        class Base : public ExtentsBase {
+        public:
+            Base() : ExtentsBase( "unittests.pdfiletests.Compact" ){
+            }
+        };
+
+        class FreesTailExtents : public Base {
+        public:
+            void run() {
+                fill();
+                for ( int i = 0; i < 200; i += 2 )
+                    deleteObjects( ns(), BSON( "_id" << i ), true );
+
+                string err;
+                BSONObjBuilder result;
+                ASSERT( compactCollection( ns(), 7, err, result ) );
+                BSONObj res = result.done();
+                ASSERT( res[ "moved" ].number() > 0 );
+                ASSERT( res[ "extentsFreed" ].number() > 0 );
+                ASSERT_EQUALS( 4 - res[ "extentsFreed" ].numberInt(), nExtents() );
+
+                ASSERT_EQUALS( 100, nsd()->nrecords );
+                int n = 0;
+                for ( auto_ptr< Cursor > c = theDataFileMgr.findAll( ns() ); c->ok(); c->advance() )
+                    ++n;
+                ASSERT_EQUALS( 100, n );
+                for ( int i = 1; i < 200; i += 2 ) {
+                    BSONObj o;
+                    ASSERT( Helpers::findOne( ns(), BSON( "_id" << i ), o, true ) );
+                    ASSERT_EQUALS( i, o[ "_id" ].numberInt() );
+                }
+                // the space is reusable
+                for ( int i = 0; i < 200; i += 2 )
+                    insert( i );
+                ASSERT_EQUALS( 200, nsd()->nrecords );
+            }
+        };
+
+        class CappedFails : public Base {
+        public:
+            void run() {
+                string err;
+                ASSERT( userCreateNS( ns(), fromjson( "{capped:true,size:2000}" ), err, false ) );
+                BSONObjBuilder result;
+                ASSERT( !compactCollection( ns(), 0, err, result ) );
+            }
+        };
+    } // namespace Compact
+
+    namespace Readahead {
+        class Base : public ExtentsBase {
+        public:
+            Base() : ExtentsBase( "unittests.pdfiletests.Readahead" ){
+            }
+        };
+
+        /* a forward scan hints each extent as it enters it, and still sees every record */
+        class ScanAcrossExtents : public Base {
+        public:
+            void run() {
+                fill();
+                int used = 0;
+                DiskLoc lastRecord;
+                for ( DiskLoc i = nsd()->firstExtent; !i.isNull(); i = i.ext()->xnext ) {
+                    if ( i.ext()->firstRecord.isNull() )
+                        continue;
+                    ++used;
+                    lastRecord = i.ext()->lastRecord;
+                }
+                ASSERT( used > 1 );
+
+                auto_ptr< Cursor > cursor = theDataFileMgr.findAll( ns() );
+                BasicCursor &c = dynamic_cast< BasicCursor& >( *cursor );
+                ASSERT( c.hintedExtent().isNull() );
+                int n = 0;
+                int hinted = 0;
+                DiskLoc last;
+                for ( ; c.ok(); c.advance() ) {
+                    if ( n++ == 0 )
+                        continue; // nothing is hinted until the scan advances
+                    DiskLoc e( c.currLoc().a(), c._current()->extentOfs );
+                    ASSERT( c.hintedExtent() == e );
+                    if ( !( e == last ) )
+                        ++hinted;
+                    last = e;
+                }
+                ASSERT_EQUALS( 200, n );
+                ASSERT_EQUALS( used, hinted );
+
+                ReverseCursor r( lastRecord );
+                while ( r.advance() )
+                    ;
+                ASSERT( r.hintedExtent().isNull() );
+
+                for ( DiskLoc e = nsd()->firstExtent; !e.isNull(); e = e.ext()->xnext ) {
+                    DataFileMgr::adviseExtent( e, MemoryMappedFile::WillNeed, 4096 );
+                    DataFileMgr::adviseExtent( e, MemoryMappedFile::Default );
+                }
+            }
+        };
+
+        class Stats : public Base {
+        public:
+            void run() {
+                fill();
+                BSONObjBuilder b;
+                MemoryMappedFile::appendStats( b );
+                BSONObj o = b.done();
+                ASSERT( o[ "mapped" ].numberLong() > 0 );
+                ASSERT( o[ "resident" ].numberLong() <= o[ "mapped" ].numberLong() );
+                bool found = false;
+                BSONObjIterator i( o[ "files" ].embeddedObject() );
+                while ( i.more() ) {
+                    BSONObj f = i.next().embeddedObject();
+                    ASSERT( f[ "resident" ].numberLong() <= f[ "mapped" ].numberLong() );
+                    ASSERT( f[ "faulted" ].numberLong() >= 0 );
+                    if ( string( f[ "file" ].valuestr() ).find( "unittests.0" ) != string::npos )
+                        found = true;
+                }
+                ASSERT( found );
+            }
+        };
+    } // namespace Readahead
+
+    namespace Touch {
+        class Base : public ExtentsBase {
+        public:
+            Base() : ExtentsBase( "unittests.pdfiletests.Touch" ){
+            }
+        protected:
+            static long long extentBytes( const char *ns ) {
+                long long n = 0;
+                for ( DiskLoc i = nsdetails( ns )->firstExtent; !i.isNull(); i = i.ext()->xnext )
+                    n += i.ext()->length;
+                return n;
+            }
+        };
+
+        class DataAndIndexes : public Base {
+        public:
+            void run() {
+                fill();
+                string err;
+                BSONObjBuilder result;
+                BSONObj all = BSON( "index" << true );
+                ASSERT( touchCollection( ns(), true, all.firstElement(), 2, err, result ) );
+                BSONObj res = result.done();
+                long long data = extentBytes( ns() );
+                long long id = extentBytes( nsd()->idx( 0 ).indexNamespace().c_str() );
+                ASSERT_EQUALS( data, res[ "data" ].numberLong() );
+                ASSERT_EQUALS( id, res[ "indexes" ].embeddedObject()[ "_id_" ].numberLong() );
+                ASSERT_EQUALS( data + id, res[ "bytes" ].numberLong() );
+            }
+        };
+
+        class SelectedIndexes : public Base {
+        public:
+            void run() {
+                fill();
+                string err;
+                BSONObj none = fromjson( "{index:[]}" );
+                BSONObjBuilder result;
+                ASSERT( touchCollection( ns(), false, none.firstElement(), 1, err, result ) );
+                ASSERT_EQUALS( 0, result.done()[ "bytes" ].numberLong() );
+
+                BSONObj missing = fromjson( "{index:['nosuchindex']}" );
+                BSONObjBuilder result2;
+                ASSERT( !touchCollection( ns(), true, missing.firstElement(), 1, err, result2 ) );
+            }
+        };
+    } // namespace Touch
     
     class All : public Suite {
     public:
@@ -321,6 +538,12 @@ namespace PdfileTests {
             add< ScanCapped::FirstInExtent >();
             add< ScanCapped::LastInExtent >();
             add< Insert::UpdateDate >();
+            add< Compact::FreesTailExtents >();
+            add< Compact::CappedFails >();
+            add< Readahead::ScanAcrossExtents >();
+            add< Readahead::Stats >();
+            add< Touch::DataAndIndexes >();
+            add< Touch::SelectedIndexes >();
         }
     } myall;
 
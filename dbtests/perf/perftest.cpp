@@ -24,9 +24,12 @@
 #include "../../db/query.h"
 #include "../../db/queryoptimizer.h"
 #include "../../util/file_allocator.h"
+#include "../../util/atomic_int.h"
+#include "../../util/histogram.h"
 
 #include "../framework.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind.hpp>
 
 namespace mongo {
     extern string dbpath;
@@ -310,6 +313,15 @@ namespace BSON {
         }
     };
 
+    // what mongoimport feeds it: many small documents
+    class ParseSmall {
+    public:
+        void run() {
+            for( int i = 0; i < 100000; ++i )
+                fromjson( "{ _id : 12345, name : 'Margaret Walker', tags : [ 'a', 'b', 'c' ], price : 10.99, seen : true }" );
+        }
+    };
+
     class Json {
     public:
         Json() : o_( fromjson( sample ) ) {}
@@ -336,6 +348,7 @@ namespace BSON {
         void setupTests(){
             add< Parse >();
             add< ShopwikiParse >();
+            add< ParseSmall >();
             add< Json >();
             add< ShopwikiJson >();
         }
@@ -343,6 +356,102 @@ namespace BSON {
 
 } // namespace BSON
 
+namespace KeyCompare {
+
+    // Compares neighbouring index keys, as a btree descent or a sort does.  The *Pattern tests
+    // walk the key pattern on every compare; the *Ordering tests use it precomputed.
+    class Base {
+    public:
+        Base( const BSONObj &pattern ) : pattern_( pattern ), ordering_( Ordering::make( pattern ) ) {}
+    protected:
+        void comparePattern() {
+            int n = 0;
+            for( int j = 0; j < 20; ++j )
+                for( unsigned i = 1; i < keys_.size(); ++i )
+                    if ( keys_[ i - 1 ].woCompare( keys_[ i ], pattern_ ) < 0 )
+                        ++n;
+            ASSERT( n > 0 );
+        }
+        void compareOrdering() {
+            int n = 0;
+            for( int j = 0; j < 20; ++j )
+                for( unsigned i = 1; i < keys_.size(); ++i )
+                    if ( keys_[ i - 1 ].woCompare( keys_[ i ], ordering_ ) < 0 )
+                        ++n;
+            ASSERT( n > 0 );
+        }
+        BSONObj pattern_;
+        Ordering ordering_;
+        vector< BSONObj > keys_;
+    };
+
+    class Int : public Base {
+    public:
+        Int() : Base( BSON( "a" << 1 ) ) {
+            for( int i = 0; i < 100000; ++i )
+                keys_.push_back( BSON( "" << ( i * 7919 ) % 100000 ) );
+        }
+    };
+
+    class String : public Base {
+    public:
+        String() : Base( BSON( "a" << 1 ) ) {
+            for( int i = 0; i < 100000; ++i ) {
+                stringstream ss;
+                ss << "key" << ( i * 7919 ) % 100000;
+                keys_.push_back( BSON( "" << ss.str() ) );
+            }
+        }
+    };
+
+    class ObjectId : public Base {
+    public:
+        ObjectId() : Base( BSON( "a" << 1 ) ) {
+            OID id;
+            for( int i = 0; i < 100000; ++i ) {
+                id.init();
+                keys_.push_back( BSON( "" << id ) );
+            }
+        }
+    };
+
+    class Compound : public Base {
+    public:
+        Compound() : Base( BSON( "a" << 1 << "b" << -1 << "c" << 1 ) ) {
+            for( int i = 0; i < 100000; ++i ) {
+                stringstream ss;
+                ss << i % 7;
+                keys_.push_back( BSON( "" << i % 10 << "" << ss.str() << "" << i * 1.5 ) );
+            }
+        }
+    };
+
+    class IntPattern : public Int { public: void run() { comparePattern(); } };
+    class IntOrdering : public Int { public: void run() { compareOrdering(); } };
+    class StringPattern : public String { public: void run() { comparePattern(); } };
+    class StringOrdering : public String { public: void run() { compareOrdering(); } };
+    class ObjectIdPattern : public ObjectId { public: void run() { comparePattern(); } };
+    class ObjectIdOrdering : public ObjectId { public: void run() { compareOrdering(); } };
+    class CompoundPattern : public Compound { public: void run() { comparePattern(); } };
+    class CompoundOrdering : public Compound { public: void run() { compareOrdering(); } };
+
+    class All : public RunnerSuite {
+    public:
+        All() : RunnerSuite( "keycompare" ){}
+        void setupTests(){
+            add< IntPattern >();
+            add< IntOrdering >();
+            add< StringPattern >();
+            add< StringOrdering >();
+            add< ObjectIdPattern >();
+            add< ObjectIdOrdering >();
+            add< CompoundPattern >();
+            add< CompoundOrdering >();
+        }
+    } all;
+
+} // namespace KeyCompare
+
 namespace Index {
 
     class Int {
@@ -687,6 +796,183 @@ namespace Plan {
 
 } // namespace Plan
 
+namespace Mixed {
+
+    /* what a Base run does: each of threads threads runs opsPerThread operations, picking a find
+       by _id, an insert or an $inc update at random in the given percentages.  the collection
+       starts with docs documents, each padded to about docBytes.
+    */
+    struct Mix {
+        int threads;
+        int opsPerThread;
+        int readPct;
+        int insertPct;
+        int updatePct;
+        int docBytes;
+        int docs;
+    };
+
+    /* several threads working one collection at once through the shared client_.  every
+       operation is timed, and after the elapsed time line run() prints a JSON document with
+       throughput and latency percentiles by operation type, for comparing tail latency between
+       builds rather than just the mean.
+    */
+    class Base {
+    public:
+        enum Op { Read, Insert, Update, NOps };
+
+        Base( const string &ns, const Mix &mix ) : ns_( ns ), mix_( mix ), nextId_( mix.docs ) {
+            assert( mix_.readPct + mix_.insertPct + mix_.updatePct == 100 );
+            pad_ = string( mix_.docBytes > 30 ? mix_.docBytes - 30 : 0, 'x' );
+            for( int i = 0; i < mix_.docs; ++i )
+                client_->insert( ns_.c_str(), doc( i ) );
+        }
+        void run() {
+            vector< LatencyHistogram > latencies( mix_.threads * NOps );
+            unsigned long long start = curTimeMicros64();
+            vector< boost::thread* > threads;
+            for( int i = 0; i < mix_.threads; ++i )
+                threads.push_back( new boost::thread( boost::bind( &Base::worker, this, i, &latencies[ i * NOps ] ) ) );
+            for( int i = 0; i < mix_.threads; ++i ) {
+                threads[ i ]->join();
+                delete threads[ i ];
+            }
+            unsigned long long micros = curTimeMicros64() - start;
+
+            LatencyHistogram total[ NOps ];
+            for( int i = 0; i < mix_.threads; ++i )
+                for( int j = 0; j < NOps; ++j )
+                    total[ j ].merge( latencies[ i * NOps + j ] );
+            cout << report( micros, total ).jsonString() << endl;
+        }
+    private:
+        BSONObj doc( int id ) const {
+            return BSON( "_id" << id << "n" << 0 << "pad" << pad_ );
+        }
+        void worker( int thread, LatencyHistogram *latency ) {
+            Client::initThread( "perftest" );
+            unsigned r = 1234567 + thread * 7919;
+            for( int i = 0; i < mix_.opsPerThread; ++i ) {
+                r = r * 1103515245 + 12345;
+                int pick = ( r >> 16 ) % 100;
+                r = r * 1103515245 + 12345;
+                int id = ( r >> 8 ) % mix_.docs;
+                unsigned long long t = curTimeMicros64();
+                if ( pick < mix_.readPct ) {
+                    client_->findOne( ns_.c_str(), QUERY( "_id" << id ) );
+                    latency[ Read ].record( curTimeMicros64() - t );
+                }
+                else if ( pick < mix_.readPct + mix_.insertPct ) {
+                    client_->insert( ns_.c_str(), doc( nextId_++ ) );
+                    latency[ Insert ].record( curTimeMicros64() - t );
+                }
+                else {
+                    client_->update( ns_.c_str(), QUERY( "_id" << id ), BSON( "$inc" << BSON( "n" << 1 ) ) );
+                    latency[ Update ].record( curTimeMicros64() - t );
+                }
+            }
+            cc().shutdown();
+        }
+        BSONObj report( unsigned long long micros, const LatencyHistogram *total ) const {
+            static const char *names[] = { "read", "insert", "update" };
+            long long ops = 0;
+            BSONObjBuilder latency;
+            for( int j = 0; j < NOps; ++j ) {
+                const LatencyHistogram &h = total[ j ];
+                if ( h.count() == 0 )
+                    continue;
+                ops += h.count();
+                BSONObjBuilder b;
+                b.append( "count", (long long) h.count() );
+                b.append( "mean", (long long) h.mean() );
+                b.append( "p50", (long long) h.percentile( 50 ) );
+                b.append( "p90", (long long) h.percentile( 90 ) );
+                b.append( "p99", (long long) h.percentile( 99 ) );
+                b.append( "p999", (long long) h.percentile( 99.9 ) );
+                b.append( "max", (long long) h.maxValue() );
+                latency.append( names[ j ], b.obj() );
+            }
+            BSONObjBuilder b;
+            b.append( "test", ns_.substr( 0, ns_.find( '.' ) ) );
+            b.append( "threads", mix_.threads );
+            b.append( "docBytes", mix_.docBytes );
+            b.append( "mix", BSON( "read" << mix_.readPct << "insert" << mix_.insertPct << "update" << mix_.updatePct ) );
+            b.append( "ops", ops );
+            b.append( "micros", (long long) micros );
+            b.append( "opsPerSec", micros ? ops * 1000000.0 / micros : 0.0 );
+            b.append( "latencyMicros", latency.obj() );
+            return b.obj();
+        }
+
+        string ns_;
+        Mix mix_;
+        string pad_;
+        AtomicUInt nextId_;
+    };
+
+    Mix mix( int threads, int readPct, int insertPct, int updatePct, int docBytes ) {
+        Mix m;
+        m.threads = threads;
+        m.opsPerThread = 160000 / threads;
+        m.readPct = readPct;
+        m.insertPct = insertPct;
+        m.updatePct = updatePct;
+        m.docBytes = docBytes;
+        m.docs = 10000;
+        return m;
+    }
+
+    class ReadMostly1 : public Base {
+    public:
+        ReadMostly1() : Base( testNs( this ), mix( 1, 90, 5, 5, 100 ) ) {}
+    };
+
+    class ReadMostly8 : public Base {
+    public:
+        ReadMostly8() : Base( testNs( this ), mix( 8, 90, 5, 5, 100 ) ) {}
+    };
+
+    class Balanced1 : public Base {
+    public:
+        Balanced1() : Base( testNs( this ), mix( 1, 50, 25, 25, 100 ) ) {}
+    };
+
+    class Balanced8 : public Base {
+    public:
+        Balanced8() : Base( testNs( this ), mix( 8, 50, 25, 25, 100 ) ) {}
+    };
+
+    class WriteHeavy1 : public Base {
+    public:
+        WriteHeavy1() : Base( testNs( this ), mix( 1, 10, 45, 45, 100 ) ) {}
+    };
+
+    class WriteHeavy8 : public Base {
+    public:
+        WriteHeavy8() : Base( testNs( this ), mix( 8, 10, 45, 45, 100 ) ) {}
+    };
+
+    class WriteHeavyLarge8 : public Base {
+    public:
+        WriteHeavyLarge8() : Base( testNs( this ), mix( 8, 10, 45, 45, 4096 ) ) {}
+    };
+
+    class All : public RunnerSuite {
+    public:
+        All() : RunnerSuite( "mixed" ){}
+        void setupTests(){
+            add< ReadMostly1 >();
+            add< ReadMostly8 >();
+            add< Balanced1 >();
+            add< Balanced8 >();
+            add< WriteHeavy1 >();
+            add< WriteHeavy8 >();
+            add< WriteHeavyLarge8 >();
+        }
+    } all;
+
+} // namespace Mixed
+
 int main( int argc, char **argv ) {
     logLevel = -1;
     client_ = new DBDirectClient();
@@ -1118,8 +1118,134 @@ namespace QueryOptimizerTests {
             }
         };
 
+        class PruneOnStats : public Base {
+        public:
+            void run() {
+                Helpers::ensureIndex( ns(), BSON( "a" << 1 ), false, "a_1" );
+                Helpers::ensureIndex( ns(), BSON( "b" << 1 ), false, "b_1" );
+                for( int i = 0; i < 1000; ++i ) {
+                    BSONObj temp = BSON( "a" << i << "b" << i % 2 );
+                    theDataFileMgr.insert( ns(), temp );
+                }
+                {
+                    QueryPlanSet s( ns(), BSON( "a" << 5 << "b" << 1 ), BSONObj() );
+                    ASSERT_EQUALS( 3, s.nPlans() );
+                }
+                string err;
+                BSONObjBuilder result;
+                ASSERT( analyzeCollection( ns(), 0, err, result ) );
+
+                QueryPlanSet s( ns(), BSON( "a" << 5 << "b" << 1 ), BSONObj() );
+                ASSERT_EQUALS( 1, s.nPlans() );
+                ASSERT_EQUALS( 2U, s.prunedPlans().size() );
+                BSONObj plan = s.explain()[ "allPlans" ].embeddedObject().firstElement().embeddedObject();
+                ASSERT_EQUALS( 1, plan[ "estimatedKeys" ].number() );
+                ASSERT_EQUALS( 1000, plan[ "indexStats" ].embeddedObject()[ "keys" ].number() );
+
+                // b_1 returns the order without a sort, so it is raced whatever its estimate
+                QueryPlanSet o( ns(), BSON( "a" << 5 << "b" << 1 ), BSON( "b" << 1 ) );
+                ASSERT_EQUALS( 2, o.nPlans() );
+            }
+        };
+
+        class StatsDroppedWithCollection : public Base {
+        public:
+            void run() {
+                Helpers::ensureIndex( ns(), BSON( "a" << 1 ), false, "a_1" );
+                for( int i = 0; i < 10; ++i ) {
+                    BSONObj temp = BSON( "a" << i );
+                    theDataFileMgr.insert( ns(), temp );
+                }
+                string err;
+                BSONObjBuilder result;
+                ASSERT( analyzeCollection( ns(), 0, err, result ) );
+                BSONObj o;
+                ASSERT( Helpers::findOne( "unittests.system.indexstats", BSON( "_id" << ns() ), o ) );
+                string s( ns() );
+                dropCollection( s, err, result );
+                ASSERT( !Helpers::findOne( "unittests.system.indexstats", BSON( "_id" << ns() ), o ) );
+            }
+        };
+
     } // namespace QueryPlanSetTests
     
+    namespace IndexStatsTests {
+
+        class Base {
+        protected:
+            /* { a : i / 10, b : i } for i in [ 0, 1000 ) */
+            void build( IndexStats &s, int nBuckets ) {
+                IndexStatsBuilder b( "a_1_b_1", BSON( "a" << 1 << "b" << 1 ), nBuckets );
+                for( int i = 0; i < 1000; ++i )
+                    b.add( BSON( "" << i / 10 << "" << i ) );
+                b.finish( s );
+            }
+            static BoundList bounds( const BSONObj &start, const BSONObj &end ) {
+                BoundList b;
+                b.push_back( make_pair( start, end ) );
+                return b;
+            }
+        };
+
+        class Counts : public Base {
+        public:
+            void run() {
+                IndexStats s;
+                build( s, 4 );
+                ASSERT_EQUALS( 1000, s.keys );
+                ASSERT_EQUALS( 2U, s.distinct.size() );
+                ASSERT_EQUALS( 100, s.distinct[ 0 ] );
+                ASSERT_EQUALS( 1000, s.distinct[ 1 ] );
+                ASSERT( s.bounds.size() >= 4 && s.bounds.size() <= 9 );
+                ASSERT_EQUALS( s.bounds.size(), s.cumulative.size() );
+                ASSERT_EQUALS( 1000, s.cumulative.back() );
+                ASSERT_EQUALS( BSON( "a" << 99 << "b" << 999 ), s.bounds.back() );
+            }
+        };
+
+        class RoundTrip : public Base {
+        public:
+            void run() {
+                IndexStats s;
+                build( s, 4 );
+                IndexStats t;
+                ASSERT( IndexStats::fromBSON( s.toBSON(), t ) );
+                ASSERT_EQUALS( s.toBSON(), t.toBSON() );
+                ASSERT( !IndexStats::fromBSON( BSON( "name" << "a_1" ), t ) );
+            }
+        };
+
+        class Estimates : public Base {
+        public:
+            void run() {
+                IndexStats s;
+                build( s, 8 );
+                BSONObjBuilder min;
+                min.appendMinKey( "a" );
+                min.appendMinKey( "b" );
+                BSONObjBuilder max;
+                max.appendMaxKey( "a" );
+                max.appendMaxKey( "b" );
+                BSONObj lo = min.obj();
+                BSONObj hi = max.obj();
+                // whole index, to within a bucket (at most 1000 / 8 keys)
+                long long all = s.estimateKeys( bounds( lo, hi ), 0 );
+                ASSERT( all >= 1000 - 125 && all <= 1000 );
+                // a == 5: ten keys per value of a
+                ASSERT_EQUALS( 10, s.estimateKeys( bounds( BSON( "a" << 5 << "b" << lo[ "b" ] ), BSON( "a" << 5 << "b" << hi[ "b" ] ) ), 1 ) );
+                // a == 5, b == 52: unique
+                ASSERT_EQUALS( 1, s.estimateKeys( bounds( BSON( "a" << 5 << "b" << 52 ), BSON( "a" << 5 << "b" << 52 ) ), 2 ) );
+                // a < 50, within a bucket of the truth; a reverse scan's bounds give the same
+                long long half = s.estimateKeys( bounds( lo, BSON( "a" << 50 << "b" << lo[ "b" ] ) ), 0 );
+                ASSERT( half >= 500 - 125 && half <= 500 + 125 );
+                ASSERT_EQUALS( half, s.estimateKeys( bounds( BSON( "a" << 50 << "b" << lo[ "b" ] ), lo ), 0 ) );
+                // past the last key
+                ASSERT_EQUALS( 0, s.estimateKeys( bounds( BSON( "a" << 200 << "b" << lo[ "b" ] ), hi ), 0 ) );
+            }
+        };
+
+    } // namespace IndexStatsTests
+    
     class All : public Suite {
     public:
         All() : Suite( "queryoptimizer" ){}
@@ -1185,6 +1311,11 @@ namespace QueryOptimizerTests {
             add< QueryPlanSetTests::InQueryIntervals >();
             add< QueryPlanSetTests::EqualityThenIn >();
             add< QueryPlanSetTests::NotEqualityThenIn >();
+            add< QueryPlanSetTests::PruneOnStats >();
+            add< QueryPlanSetTests::StatsDroppedWithCollection >();
+            add< IndexStatsTests::Counts >();
+            add< IndexStatsTests::RoundTrip >();
+            add< IndexStatsTests::Estimates >();
         }
     } myall;
     
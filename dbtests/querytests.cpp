@@ -874,6 +874,49 @@ namespace QueryTests {
         }
     };
 
+    class ClientCursorPartitions : public CollectionBase {
+    public:
+        ClientCursorPartitions() : CollectionBase( "clientcursorpartitions" ) {}
+        ~ClientCursorPartitions() {
+            client().dropCollection( other() );
+        }
+        void run() {
+            writelock lk( "" );
+            Client::Context ctx( "unittests" );
+            for( int i = 0; i < 3; ++i ) {
+                insert( ns(), BSON( "_id" << i ) );
+                insert( other(), BSON( "_id" << i ) );
+            }
+
+            auto_ptr< Cursor > c = theDataFileMgr.findAll( ns() );
+            DiskLoc first = c->currLoc();
+            ClientCursor *cc = new ClientCursor( c, ns(), false );
+            cc->updateLocation();
+            CursorId id = cc->cursorid;
+            auto_ptr< Cursor > c2 = theDataFileMgr.findAll( other() );
+            ClientCursor *cc2 = new ClientCursor( c2, other(), false );
+            cc2->updateLocation();
+            CursorId id2 = cc2->cursorid;
+            ASSERT( cc == ClientCursor::find( id, false ) );
+            ASSERT( cc2 == ClientCursor::find( id2, false ) );
+
+            // deleting the record cc is on advances cc and only cc
+            DiskLoc otherFirst = cc2->lastLoc();
+            theDataFileMgr.deleteRecord( ns(), first.rec(), first );
+            ASSERT( cc->lastLoc() != first );
+            ASSERT_EQUALS( 1, cc->c->current()[ "_id" ].number() );
+            ASSERT( cc2->lastLoc() == otherFirst );
+
+            ClientCursor::invalidate( ns() );
+            ASSERT( 0 == ClientCursor::find( id, false ) );
+            ASSERT( cc2 == ClientCursor::find( id2, false ) );
+            ASSERT( ClientCursor::erase( id2 ) );
+            ASSERT( 0 == ClientCursor::find( id2, false ) );
+        }
+    private:
+        const char *other() const { return "unittests.querytests.otherclientcursorpartitions"; }
+    };
+
     class FindingStart : public CollectionBase {
     public:
         FindingStart() : CollectionBase( "findingstart" ), _old( _findingStartInitialTimeout ) {
@@ -907,6 +950,64 @@ namespace QueryTests {
         int _old;
     };
     
+    class FindingStartSampled : public CollectionBase {
+    public:
+        FindingStartSampled() : CollectionBase( "findingstartsampled" ), _old( _findingStartInitialTimeout ) {
+            _findingStartInitialTimeout = 0;
+        }
+        ~FindingStartSampled() {
+            _findingStartInitialTimeout = _old;
+        }
+        
+        void run() {
+            BSONObj info;
+            ASSERT( client().runCommand( "unittests", BSON( "create" << "querytests.findingstartsampled" << "capped" << true << "size" << 1000 << "$nExtents" << 5 << "autoIndexId" << false ), info ) );
+            
+            int i = 1;
+            for( int oldCount = -1;
+                count() != oldCount;
+                oldCount = count(), insertTs( i++ ) );
+            sample();
+
+            // later inserts reuse the oldest extents, so some samples are stale
+            for( int k = 0; k < 10; ++k ) {
+                insertTs( i++ );
+                int min = client().query( ns(), Query().sort( BSON( "$natural" << 1 ) ) )->next()[ "ts" ].date();
+                for( int j = 0; j < i; ++j ) {
+                    auto_ptr< DBClientCursor > c = client().query( ns(), tsGte( j ), 0, 0, 0, QueryOption_OplogReplay );
+                    ASSERT( c->more() );
+                    ASSERT_EQUALS( ( j > min ? j : min ), (int) c->next()[ "ts" ].date() );
+                }
+            }
+        }
+        
+    private:
+        void insertTs( int i ) {
+            BSONObjBuilder b;
+            b.appendTimestamp( "ts", (unsigned long long) i );
+            client().insert( ns(), b.obj() );
+        }
+        static BSONObj tsGte( int i ) {
+            BSONObjBuilder b;
+            BSONObjBuilder g( b.subobjStart( "ts" ) );
+            g.appendTimestamp( "$gte", (unsigned long long) i );
+            g.done();
+            return b.obj();
+        }
+        // what fast_oplog_insert() would have recorded, one sample per op
+        void sample() {
+            dblock lk;
+            Client::Context ctx( ns() );
+            NamespaceDetailsTransient &t = NamespaceDetailsTransient::get_w( ns() );
+            t.clearOplogSamples();
+            for( auto_ptr< Cursor > c = theDataFileMgr.findAll( ns() ); c->ok(); c->advance() ) {
+                DiskLoc loc = c->currLoc();
+                t.sampleOplog( c->current()[ "ts" ].date(), loc.rec()->myExtent( loc )->myLoc );
+            }
+        }
+        int _old;
+    };
+    
     class All : public Suite {
     public:
         All() : Suite( "query" ) {
@@ -949,7 +1050,9 @@ namespace QueryTests {
             add< TailableCappedRaceCondition >();
             add< HelperTest >();
             add< HelperByIdTest >();
+            add< ClientCursorPartitions >();
             add< FindingStart >();
+            add< FindingStartSampled >();
         }
     } myall;
     
@@ -491,6 +491,24 @@ namespace UpdateTests {
         }
     };
 
+    /* a.0.b is a.b's key for the first element of a: the index on a.b has to be updated */
+    class IndexModSetPositional : public SetBase {
+    public:
+        void run() {
+            client().ensureIndex( ns(), BSON( "a.b" << 1 ) );
+            client().insert( ns(), fromjson( "{'_id':0,a:[{b:3},{b:5}]}" ) );
+            client().update( ns(), Query(), fromjson( "{$set:{'a.0.b':'a string long enough that the object has to move'}}" ) );
+            client().update( ns(), Query(), fromjson( "{$inc:{'a.1.b':1}}" ) );
+            BSONObj expected = fromjson( "{'_id':0,a:[{b:'a string long enough that the object has to move'},{b:6}]}" );
+            ASSERT_EQUALS( expected , client().findOne( ns(), Query() ) );
+            BSONObj hint = BSON( "a.b" << 1 );
+            ASSERT_EQUALS( expected , client().findOne( ns(), Query( fromjson( "{'a.b':'a string long enough that the object has to move'}" ) ).hint( hint ) ) );
+            ASSERT_EQUALS( expected , client().findOne( ns(), Query( fromjson( "{'a.b':6}" ) ).hint( hint ) ) );
+            ASSERT( client().findOne( ns(), Query( fromjson( "{'a.b':3}" ) ).hint( hint ) ).isEmpty() );
+            ASSERT( client().findOne( ns(), Query( fromjson( "{'a.b':5}" ) ).hint( hint ) ).isEmpty() );
+        }
+    };
+
 
     class PreserveIdWithIndex : public SetBase { // Not using $set, but base class is still useful
     public:
@@ -763,6 +781,7 @@ namespace UpdateTests {
             add< InsertInEmpty >();
             add< IndexParentOfMod >();
             add< IndexModSet >();
+            add< IndexModSetPositional >();
             add< PreserveIdWithIndex >();
             add< CheckNoMods >();
             add< UpdateMissingToNull >();
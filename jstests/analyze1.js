@@ -0,0 +1,35 @@
+// analyze gathers index statistics, and the optimizer prunes plans on them
+
+t = db.jstests_analyze1;
+t.drop();
+
+t.ensureIndex( { a: 1 } );
+t.ensureIndex( { b: 1 } );
+for( i = 0; i < 1000; ++i )
+    t.save( { a: i, b: i % 2 } );
+
+assert.eq( 3, t.find( { a: 5, b: 1 } ).explain().allPlans.length );
+
+r = db.runCommand( { analyze: "jstests_analyze1" } );
+assert( r.ok, tojson( r ) );
+assert.eq( 3, r.indexes.length );
+for( i in r.indexes ) {
+    assert.eq( 1000, r.indexes[ i ].keys );
+    if ( r.indexes[ i ].name == "b_1" )
+        assert.eq( 2, r.indexes[ i ].distinct[ 0 ] );
+}
+assert.eq( 1, db.system.indexstats.count( { _id: t.getFullName() } ) );
+
+e = t.find( { a: 5, b: 1 } ).explain();
+assert.eq( "BtreeCursor a_1", e.cursor );
+assert.eq( 1, e.allPlans.length );
+assert.eq( 2, e.prunedPlans.length );
+assert.eq( 1000, e.allPlans[ 0 ].indexStats.keys );
+assert.eq( 1, t.find( { a: 5, b: 1 } ).count() );
+
+// a plan that returns the requested order is never pruned
+assert.eq( 2, t.find( { a: 5, b: 1 } ).sort( { b: 1 } ).explain().allPlans.length );
+
+// stats go with the collection
+t.drop();
+assert.eq( 0, db.system.indexstats.count( { _id: t.getFullName() } ) );
@@ -0,0 +1,35 @@
+// Test cloneDatabase copying several collections in parallel, with indexes built after the data
+
+var baseName = "jstests_clonedatabase";
+
+ports = allocatePorts( 2 );
+
+f = startMongod( "--port", ports[ 0 ], "--dbpath", "/data/db/" + baseName + "_from", "--nohttpinterface", "--bind_ip", "127.0.0.1" ).getDB( baseName );
+t = startMongod( "--port", ports[ 1 ], "--dbpath", "/data/db/" + baseName + "_to", "--nohttpinterface", "--bind_ip", "127.0.0.1", "--cloneConnections", "3" ).getDB( baseName );
+
+for( c = 0; c < 5; ++c ) {
+    for( i = 0; i < 2000; ++i ) {
+        f[ "c" + c ].save( { i: i, s: "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" } );
+    }
+}
+f.c0.ensureIndex( { i: 1 }, { background: true } );
+f.createCollection( "capped", { capped: true, size: 10000 } );
+f.capped.save( { x: 1 } );
+
+assert.commandWorked( t.runCommand( { clone: "localhost:" + ports[ 0 ] } ) );
+
+for( c = 0; c < 5; ++c ) {
+    assert.eq( 2000, t[ "c" + c ].find().count(), "c" + c );
+    assert.eq( 1, t.system.indexes.find( { ns: t[ "c" + c ].getFullName(), name: "_id_" } ).count(), "_id index c" + c );
+    assert( t[ "c" + c ].validate().valid, "validate c" + c );
+}
+
+// the secondary index was built with the bulk builder, and works
+assert.eq( 2, t.system.indexes.find( { ns: t.c0.getFullName() } ).count() );
+assert.eq( 1, t.c0.find( { i: 50 } ).hint( { i: 1 } ).toArray().length );
+assert.eq( 1000, t.c0.find( { i: { $lt: 1000 } } ).hint( { i: 1 } ).count() );
+
+// capped collections still get no _id index
+assert( t.capped.isCapped() );
+assert.eq( 1, t.capped.find().count() );
+assert.eq( 0, t.system.indexes.find( { ns: t.capped.getFullName() } ).count() );
@@ -0,0 +1,27 @@
+// compact moves records out of the tail extents and frees them
+
+t = db.compact1;
+t.drop();
+
+db.createCollection( "compact1", { size: 100000, $nExtents: 5 } );
+t.ensureIndex( { x: 1 } );
+for( i = 0; i < 2000; ++i ) {
+    t.save( { _id: i, x: i % 17, s: "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" } );
+}
+t.remove( { _id: { $gte: 500 } } );
+t.remove( { x: 3 } );
+var before = t.stats().numExtents;
+var n = t.count();
+
+res = db.runCommand( { compact: "compact1", batch: 50 } );
+assert( res.ok, tojson( res ) );
+assert( res.extentsFreed > 0, tojson( res ) );
+assert.eq( before - res.extentsFreed, t.stats().numExtents );
+
+assert.eq( n, t.count() );
+assert.eq( n, t.find().itcount() );
+assert.eq( n - t.find( { x: 5 } ).count(), t.find( { x: { $ne: 5 } } ).hint( { x: 1 } ).itcount() );
+assert.eq( 1, t.find( { _id: 7 } ).hint( { _id: 1 } ).itcount() );
+assert( t.validate().valid );
+
+assert( !db.runCommand( { compact: "compact1_notthere" } ).ok );
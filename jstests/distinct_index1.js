@@ -0,0 +1,36 @@
+
+t = db.distinct_index1;
+t.drop();
+
+function d( k , q ){
+    return t.distinct( k , q ).toString();
+}
+
+for ( i=0; i<1000; i++ ){
+    o = { a : i % 10 , b : i % 7 };
+    if ( i % 50 == 0 )
+        o.c = null;
+    else if ( i % 3 == 0 )
+        o.c = "x" + ( i % 4 );
+    t.save( o );
+}
+
+before = [ d( "a" ) , d( "b" ) , d( "c" ) , d( "a" , { b : 2 } ) ];
+
+t.ensureIndex( { a : 1 } );
+t.ensureIndex( { b : -1 , a : 1 } );
+t.ensureIndex( { c : 1 } );
+
+assert.eq( before[0] , d( "a" ) , "A1" );
+assert.eq( before[1] , d( "b" ) , "A2" );
+assert.eq( before[2] , d( "c" ) , "A3" );
+assert.eq( before[3] , d( "a" , { b : 2 } ) , "A4" );
+
+t.drop();
+t.save( { a : 1 } );
+t.save( { a : 2 } );
+t.save( { b : 1 } );
+t.ensureIndex( { a : 1 } );
+assert.eq( "1,2" , d( "a" ) , "B1" );
+t.save( { a : null } );
+assert.eq( 3 , t.distinct( "a" ).length , "B2" );
@@ -0,0 +1,40 @@
+// counted indexes: count, skip and medianKey answered from subtree counts
+
+t = db.jstests_index_counted1;
+t.drop();
+
+function check( tag ){
+    assert.eq( 100 , t.find( { a : 3 } ).count() , tag + " count" );
+    assert.eq( 90 , t.find( { a : 3 } ).skip( 10 ).count( true ) , tag + " count skip" );
+    assert.eq( 5 , t.find( { a : 3 } ).skip( 10 ).limit( 5 ).count( true ) , tag + " count skip limit" );
+    assert.eq( 0 , t.find( { a : 3 } ).skip( 200 ).count( true ) , tag + " count skip all" );
+
+    assert.eq( 7 , t.find().sort( { a : 1 } ).skip( 700 )[ 0 ].a , tag + " skip" );
+    assert.eq( 2 , t.find().sort( { a : -1 } ).skip( 750 )[ 0 ].a , tag + " reverse skip" );
+    assert.eq( 0 , t.find().sort( { a : 1 } ).skip( 1000 ).itcount() , tag + " skip past end" );
+    assert.eq( 100 , t.find( { a : 5 } ).skip( 100 ).itcount() + t.find( { a : 5 } ).limit( 100 ).itcount() , tag + " exact skip" );
+
+    var m = db.runCommand( { medianKey : t.getFullName() , keyPattern : { a : 1 } , min : { a : 0 } , max : { a : 10 } } );
+    assert( m.ok , tag + " median ok" );
+    assert.eq( 5 , m.median.a , tag + " median" );
+
+    assert( t.validate().valid , tag + " valid" );
+}
+
+// built incrementally
+t.ensureIndex( { a : 1 } , { counted : true } );
+for ( i = 0; i < 1000; i++ )
+    t.save( { a : i % 10 , b : i } );
+check( "A" );
+
+// removes leave the counts right
+t.remove( { b : { $gte : 1000 } } );
+for ( i = 1000; i < 1100; i++ )
+    t.save( { a : 11 , b : i } );
+t.remove( { a : 11 } );
+check( "B" );
+
+// bulk built
+t.dropIndexes();
+t.ensureIndex( { a : 1 } , { counted : true } );
+check( "C" );
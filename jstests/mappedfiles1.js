@@ -0,0 +1,24 @@
+// serverStatus reports mapped, resident and faulted bytes per data file
+
+t = db.jstests_mappedfiles1;
+t.drop();
+
+for( i = 0; i < 1000; ++i )
+    t.save( { a: i, s: "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" } );
+assert.eq( 1000, t.find().itcount() );
+t.ensureIndex( { a: 1 } );
+
+m = db.serverStatus().mappedFiles;
+assert( m, "no mappedFiles section" );
+assert( m.mapped > 0 );
+assert( m.resident <= m.mapped );
+
+found = false;
+for( i in m.files ) {
+    f = m.files[ i ];
+    assert( f.resident <= f.mapped, tojson( f ) );
+    assert( f.faulted >= 0, tojson( f ) );
+    if ( f.file.match( db.getName() + "\\.0$" ) )
+        found = true;
+}
+assert( found, "data file not listed" );
@@ -0,0 +1,27 @@
+// connpool1.js - mongos reuses its connections to the shards and reports on them
+
+s = new ShardingTest( "connpool1" , 2 );
+
+db = s.getDB( "test" );
+for ( i = 0; i < 20; i++ )
+    db.foo.save( { _id : i } );
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.foo" , key : { _id : 1 } } );
+s.adminCommand( { split : "test.foo" , middle : { _id : 10 } } );
+
+before = s.admin.runCommand( { connPoolStats : 1 } );
+assert( before.ok , tojson( before ) );
+
+for ( i = 0; i < 50; i++ )
+    assert.eq( 20 , db.foo.find().itcount() , "itcount " + i );
+
+after = s.admin.runCommand( { connPoolStats : 1 } );
+printjson( after );
+reused = ( after.hits + after.threadCacheHits ) - ( before.hits + before.threadCacheHits );
+assert.lt( after.created - before.created , reused , "connections should mostly be reused" );
+assert.eq( "object" , typeof( after.idleShared ) );
+
+s.adminCommand( "connpoolsync" );
+
+s.stop();
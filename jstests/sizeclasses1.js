@@ -0,0 +1,29 @@
+// records of a sizeClasses collection reuse freed space without growing the collection
+
+t = db.sizeclasses1;
+t.drop();
+db.createCollection( "sizeclasses1", { sizeClasses: true } );
+assert( db.system.namespaces.findOne( { name: t.getFullName() } ).options.sizeClasses );
+
+function fill( len ) {
+    var s = "";
+    while( s.length < len )
+        s += "a";
+    for( i = 0; i < 1000; ++i )
+        t.save( { _id: i, s: s } );
+}
+
+fill( 100 );
+var extents = t.stats().numExtents;
+for( round = 0; round < 5; ++round ) {
+    t.remove();
+    fill( 80 + round * 10 );
+    assert.eq( 1000, t.count() );
+    assert.eq( extents, t.stats().numExtents, "round " + round );
+}
+
+// growing within the size class updates in place
+t.update( { _id: 5 }, { $set: { s: t.findOne( { _id: 5 } ).s + "bbbbbbbbbb" } } );
+assert.eq( 1000, t.find().itcount() );
+assert.eq( 1, t.find( { s: /b$/ } ).itcount() );
+assert( t.validate().valid );
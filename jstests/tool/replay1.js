@@ -0,0 +1,34 @@
+// capture a workload through mongobridge --record and play it back with mongoreplay
+
+baseName = "jstests_tool_replay1";
+externalPath = "/data/db/" + baseName + "_external/";
+captureFile = externalPath + "capture";
+
+ports = allocatePorts( 3 );
+resetDbpath( externalPath );
+
+m = startMongod( "--port", ports[ 0 ], "--dbpath", "/data/db/" + baseName, "--nohttpinterface", "--bind_ip", "127.0.0.1" );
+target = startMongod( "--port", ports[ 1 ], "--dbpath", "/data/db/" + baseName + "_target", "--nohttpinterface", "--bind_ip", "127.0.0.1" );
+bridge = startMongoProgram( "mongobridge", "--port", ports[ 2 ], "--dest", "127.0.0.1:" + ports[ 0 ], "--record", captureFile );
+
+c = bridge.getDB( baseName ).getCollection( baseName );
+for( i = 0; i < 300; ++i )
+    c.save( { _id: i, a: i % 10 } );
+c.update( { a: 3 }, { $set: { b: 1 } }, false, true );
+c.remove( { a: 9 } );
+// more than one batch, so the replay has to map the cursor id of the getmore
+assert.eq( 270, c.find().toArray().length );
+assert.eq( 30, c.count( { b: 1 } ) );
+
+stopMongoProgram( ports[ 2 ] );
+
+assert.eq( 0, runMongoProgram( "mongoreplay", "--file", captureFile, "--dest", "127.0.0.1:" + ports[ 1 ], "--speed", "0" ) );
+
+t = target.getDB( baseName ).getCollection( baseName );
+assert.eq( 270, t.count() );
+assert.eq( 30, t.count( { b: 1 } ) );
+assert.eq( 0, t.count( { a: 9 } ) );
+
+stopMongod( ports[ 0 ] );
+stopMongod( ports[ 1 ] );
+resetDbpath( externalPath );
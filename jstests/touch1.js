@@ -0,0 +1,24 @@
+// touch reads a collection's extents and its indexes' into memory
+
+t = db.jstests_touch1;
+t.drop();
+
+t.ensureIndex( { a: 1 } );
+for( i = 0; i < 1000; ++i )
+    t.save( { a: i, s: "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" } );
+
+r = db.runCommand( { touch: "jstests_touch1" } );
+assert( r.ok, tojson( r ) );
+assert( r.data > 0, tojson( r ) );
+assert( r.indexes._id_ > 0, tojson( r ) );
+assert( r.indexes.a_1 > 0, tojson( r ) );
+assert.eq( r.data + r.indexes._id_ + r.indexes.a_1, r.bytes, tojson( r ) );
+
+r = db.runCommand( { touch: "jstests_touch1", data: false, index: [ "a_1" ], threads: 2 } );
+assert( r.ok, tojson( r ) );
+assert.isnull( r.data );
+assert.isnull( r.indexes._id_ );
+assert.eq( r.indexes.a_1, r.bytes );
+
+assert( !db.runCommand( { touch: "jstests_touch1", index: [ "nosuchindex" ] } ).ok );
+assert( !db.runCommand( { touch: "jstests_touch1_missing" } ).ok );
@@ -0,0 +1,43 @@
+// an in place update that violates a later unique index leaves every index as it was
+
+t = db.jstests_unique3;
+t.drop();
+
+t.ensureIndex( { a: 1 }, true );
+t.ensureIndex( { b: 1 }, true );
+t.ensureIndex( { c: 1 }, true );
+t.save( { _id: 1, a: 1, b: 1, c: 1 } );
+t.save( { _id: 2, a: 2, b: 2, c: 2 } );
+
+function check() {
+    assert.eq( 2, t.count() );
+    for( var i = 1; i <= 2; ++i ) {
+        assert.eq( i, t.find( { a: i } ).hint( { a: 1 } ).next()._id );
+        assert.eq( i, t.find( { b: i } ).hint( { b: 1 } ).next()._id );
+        assert.eq( i, t.find( { c: i } ).hint( { c: 1 } ).next()._id );
+    }
+    assert.eq( 0, t.find( { a: 5 } ).hint( { a: 1 } ).itcount() );
+    assert.eq( 0, t.find( { b: 5 } ).hint( { b: 1 } ).itcount() );
+    assert( t.validate().valid );
+}
+
+// a and b change, c collides: the new a and b keys are taken back out
+t.update( { _id: 1 }, { $set: { a: 5, b: 5, c: 2 } } );
+assert.eq( 11000, db.getLastErrorObj().code );
+check();
+
+// the collision is on the first index
+t.update( { _id: 1 }, { $set: { a: 2, b: 5 } } );
+assert.eq( 11000, db.getLastErrorObj().code );
+check();
+
+// no collision
+t.update( { _id: 1 }, { $set: { a: 5, b: 5 } } );
+assert( !db.getLastError() );
+assert.eq( 1, t.find( { a: 5 } ).hint( { a: 1 } ).next()._id );
+assert.eq( 0, t.find( { a: 1 } ).hint( { a: 1 } ).itcount() );
+
+// setting a key to the value it already has is not a duplicate of itself
+t.update( { _id: 2 }, { _id: 2, a: 2, b: 2, c: 2, d: 1 } );
+assert( !db.getLastError() );
+assert.eq( 1, t.findOne( { _id: 2 } ).d );
@@ -0,0 +1,44 @@
+// updates that move records keep every index pointing at them
+
+t = db.jstests_updated;
+t.drop();
+
+var fields = [ "a", "b", "c", "d", "e", "f", "g" ];
+for( var i in fields ) {
+    var k = {};
+    k[ fields[ i ] ] = 1;
+    t.ensureIndex( k, fields[ i ] == "a" );
+}
+
+for( var i = 0; i < 100; ++i )
+    t.save( { _id: i, a: i, b: i % 2, c: i % 5, d: "x", e: [ i, i + 1 ], f: { g: i }, g: i, n: 0, s: "" } );
+
+function check( nE51 ) {
+    assert.eq( 100, t.count() );
+    for( var i in fields ) {
+        var k = {};
+        k[ fields[ i ] ] = 1;
+        assert.eq( 100, t.find().hint( k ).itcount(), "index " + fields[ i ] );
+    }
+    assert.eq( 50, t.find( { b: 1 } ).hint( { b: 1 } ).itcount() );
+    assert.eq( 20, t.find( { c: 3 } ).hint( { c: 1 } ).itcount() );
+    assert.eq( nE51, t.find( { e: 51 } ).hint( { e: 1 } ).itcount() );
+    assert.eq( 7, t.find( { a: 7 } ).hint( { a: 1 } ).next().g );
+    assert( t.validate().valid );
+}
+
+// no index touched, records grow and move
+var s = "";
+for( var j = 0; j < 5; ++j ) {
+    s += "0123456789012345678901234567890123456789";
+    t.update( {}, { $inc: { n: 1 }, $set: { s: s } }, false, true );
+    assert( !db.getLastError() );
+}
+check( 2 );
+assert.eq( 100, t.find( { n: 5 } ).itcount() );
+
+// an indexed field changes while the record moves
+s += s;
+t.update( {}, { $set: { s: s }, $pull: { e: 51 } }, false, true );
+assert( !db.getLastError() );
+check( 0 );
@@ -105,7 +105,7 @@ namespace mongo {
     Chunk * Chunk::split( const BSONObj& m ){
         uassert( 10165 ,  "can't split as shard that doesn't have a manager" , _manager );
         
-        log(1) << " before split on: "  << m << "\n"
+        log(1 , LogSharding) << " before split on: "  << m << "\n"
                << "\t self  : " << toString() << endl;
 
         uassert( 10166 ,  "locking namespace on server failed" , lockNamespaceOnServer( getShard() , _ns ) );
@@ -123,7 +123,7 @@ namespace mongo {
         
         setMax(m.getOwned());
         
-        log(1) << " after split:\n" 
+        log(1 , LogSharding) << " after split:\n" 
                << "\t left : " << toString() << "\n" 
                << "\t right: "<< s->toString() << endl;
         
@@ -246,7 +246,7 @@ namespace mongo {
             toMove = this;
         }
         else {
-            log(1) << "don't know how to decide if i should move inner shard" << endl;
+            log(1 , LogSharding) << "don't know how to decide if i should move inner shard" << endl;
         }
 
         if ( ! toMove )
@@ -255,7 +255,7 @@ namespace mongo {
         string newLocation = grid.pickShardForNewDB();
         if ( newLocation == getShard() ){
             // if this is the best server, then we shouldn't do anything!
-            log(1) << "not moving chunk: " << toString() << " b/c would move to same place  " << newLocation << " -> " << getShard() << endl;
+            log(1 , LogSharding) << "not moving chunk: " << toString() << " b/c would move to same place  " << newLocation << " -> " << getShard() << endl;
             return 0;
         }
 
@@ -363,8 +363,8 @@ namespace mongo {
             string b = toString();
             BSONObj q = _id.copy();
             massert( 10414 ,  "how could load fail?" , load( q ) );
-            log(2) << "before: " << q << "\t" << b << endl;
-            log(2) << "after : " << _id << "\t" << toString() << endl;
+            log(2 , LogSharding) << "before: " << q << "\t" << b << endl;
+            log(2 , LogSharding) << "after : " << _id << "\t" << toString() << endl;
             massert( 10415 ,  "chunk reload changed content!" , b == toString() );
             massert( 10416 ,  "id changed!" , q["_id"] == _id["_id"] );
         }
@@ -496,7 +496,7 @@ namespace mongo {
         
         map<string,ShardChunkVersion> seen;
         
-        log(1) << "ChunkManager::drop : " << _ns << endl;
+        log(1 , LogSharding) << "ChunkManager::drop : " << _ns << endl;
 
         // lock all shards so no one can do a split/migrate
         for ( vector<Chunk*>::const_iterator i=_chunks.begin(); i!=_chunks.end(); i++ ){
@@ -512,7 +512,7 @@ namespace mongo {
             uassert( 10175 ,  "don't know how to rollback locks b/c drop can't lock all shards" , 0 );
         }
         
-        log(1) << "ChunkManager::drop : " << _ns << "\t all locked" << endl;        
+        log(1 , LogSharding) << "ChunkManager::drop : " << _ns << "\t all locked" << endl;        
 
         // wipe my meta-data
         _chunks.clear();
@@ -526,7 +526,7 @@ namespace mongo {
             conn.done();
         }
         
-        log(1) << "ChunkManager::drop : " << _ns << "\t removed shard data" << endl;        
+        log(1 , LogSharding) << "ChunkManager::drop : " << _ns << "\t removed shard data" << endl;        
 
         // clean up database meta-data
         uassert( 10176 ,  "no sharding data?" , _config->removeSharding( _ns ) );
@@ -538,7 +538,7 @@ namespace mongo {
         ScopedDbConnection conn( temp.modelServer() );
         conn->remove( temp.getNS() , BSON( "ns" << _ns ) );
         conn.done();
-        log(1) << "ChunkManager::drop : " << _ns << "\t removed chunk data" << endl;                
+        log(1 , LogSharding) << "ChunkManager::drop : " << _ns << "\t removed chunk data" << endl;                
         
         for ( map<string,ShardChunkVersion>::iterator i=seen.begin(); i!=seen.end(); i++ ){
             ScopedDbConnection conn( i->first );
@@ -549,7 +549,7 @@ namespace mongo {
         }
 
 
-        log(1) << "ChunkManager::drop : " << _ns << "\t DONE" << endl;        
+        log(1 , LogSharding) << "ChunkManager::drop : " << _ns << "\t DONE" << endl;        
     }
     
     void ChunkManager::save(){
@@ -620,7 +620,7 @@ namespace mongo {
         
         void run(){
             runShard();
-            log(1) << "shardObjTest passed" << endl;
+            log(1 , LogSharding) << "shardObjTest passed" << endl;
         }
     } shardObjTest;
 
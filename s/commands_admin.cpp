@@ -609,6 +609,7 @@ namespace mongo {
             virtual bool run(const char *ns, BSONObj& cmdObj, string& errmsg, BSONObjBuilder& result, bool) {
                 result.append("ismaster", 1.0 );
                 result.append("msg", "isdbgrid");
+                result.append("wireCompression", "lz"); // see MessagingPort::startCompressing()
                 return true;
             }
         } ismaster;
@@ -124,7 +124,7 @@ namespace mongo {
                 log() << "DROP DATABASE: " << dbName << endl;
 
                 if ( ! conf || ! conf->isShardingEnabled() ){
-                    log(1) << "  passing though drop database for: " << dbName << endl;
+                    log(1 , LogSharding) << "  passing though drop database for: " << dbName << endl;
                     return passthrough( conf , cmdObj , result );
                 }
                 
@@ -178,7 +178,7 @@ namespace mongo {
         
         // 1
         if ( ! configServer.allUp( errmsg ) ){
-            log(1) << "\t DBConfig::dropDatabase not all up" << endl;
+            log(1 , LogSharding) << "\t DBConfig::dropDatabase not all up" << endl;
             return 0;
         }
         
@@ -189,7 +189,7 @@ namespace mongo {
             log() << "error removing from config server even after checking!" << endl;
             return 0;
         }
-        log(1) << "\t removed entry from config server for: " << _name << endl;
+        log(1 , LogSharding) << "\t removed entry from config server for: " << _name << endl;
         
         set<string> allServers;
 
@@ -226,7 +226,7 @@ namespace mongo {
             conn.done();            
         }
         
-        log(1) << "\t dropped primary db for: " << _name << endl;
+        log(1 , LogSharding) << "\t dropped primary db for: " << _name << endl;
 
         return true;
     }
@@ -246,14 +246,14 @@ namespace mongo {
             }
 
             seen.insert( i->first );
-            log(1) << "\t dropping sharded collection: " << i->first << endl;
+            log(1 , LogSharding) << "\t dropping sharded collection: " << i->first << endl;
 
             i->second->getAllServers( allServers );
             i->second->drop();
             
             num++;
             uassert( 10184 ,  "_dropShardedCollections too many collections - bailing" , num < 100000 );
-            log(2) << "\t\t dropped " << num << " so far" << endl;
+            log(2 , LogSharding) << "\t\t dropped " << num << " so far" << endl;
         }
         return true;
     }
@@ -96,7 +96,7 @@ namespace mongo {
                 clientQueues[id.str()] = new BlockingQueue<BSONObj>();
 
             BSONObj z = clientQueues[id.str()]->blockingPop();
-            log(1) << "WriteBackCommand got : " << z << endl;
+            log(1 , LogSharding) << "WriteBackCommand got : " << z << endl;
             
             result.append( "data" , z );
             
@@ -172,7 +172,7 @@ namespace mongo {
             NSVersions * versions = clientShardVersions.get();
             
             if ( ! versions ){
-                log(1) << "entering shard mode for connection" << endl;
+                log(1 , LogSharding) << "entering shard mode for connection" << endl;
                 versions = new NSVersions();
                 clientShardVersions.reset( versions );
             }
@@ -52,6 +52,7 @@ namespace mongo {
         out() << argv[0] << " usage:\n\n";
         out() << " -v+  verbose\n";
         out() << " --port <portno>\n";
+        out() << " --wireCompression  compress large messages to the shards\n";
         out() << " --configdb <configdbname> [<configdbname>...]\n";
         out() << endl;
     }
@@ -72,7 +73,7 @@ namespace mongo {
         virtual void process( Message& m , AbstractMessagingPort* p ){
             Request r( m , p );
             if ( logLevel > 5 ){
-                log(5) << "client id: " << hex << r.getClientId() << "\t" << r.getns() << "\t" << dec << r.op() << endl;
+                log(5 , LogSharding) << "client id: " << hex << r.getClientId() << "\t" << r.getns() << "\t" << dec << r.op() << endl;
             }
             try {
                 setClientId( r.getClientId() );
@@ -129,6 +130,9 @@ int main(int argc, char* argv[], char *envp[] ) {
         if ( s == "--port" ) {
             cmdLine.port = atoi(argv[++i]);
         }
+        else if ( s == "--wireCompression" ) {
+            cmdLine.wireCompression = true;
+        }
         else if ( s == "--configdb" ) {
             
             while ( ++i < argc ) 
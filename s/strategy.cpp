@@ -89,7 +89,7 @@ namespace mongo {
 
                     }
                     
-                    log(1) << "writebacklisten result: " << result << endl;
+                    log(1 , LogSharding) << "writebacklisten result: " << result << endl;
                     
                     BSONObj data = result.getObjectField( "data" );
                     if ( data.getBoolField( "writeBack" ) ){
@@ -165,17 +165,17 @@ namespace mongo {
         if ( officialSequenceNumber == sequenceNumber )
             return;
         
-        log(2) << " have to set shard version for conn: " << &conn << " ns:" << ns << " my last seq: " << sequenceNumber << "  current: " << officialSequenceNumber << endl;
+        log(2 , LogSharding) << " have to set shard version for conn: " << &conn << " ns:" << ns << " my last seq: " << sequenceNumber << "  current: " << officialSequenceNumber << endl;
 
         BSONObj result;
         if ( setShardVersion( conn , ns , version , authoritative , result ) ){
             // success!
-            log(1) << "      setShardVersion success!" << endl;
+            log(1 , LogSharding) << "      setShardVersion success!" << endl;
             sequenceNumber = officialSequenceNumber;
             return;
         }
 
-        log(1) << "       setShardVersion failed!\n" << result << endl;
+        log(1 , LogSharding) << "       setShardVersion failed!\n" << result << endl;
 
         if ( result.getBoolField( "need_authoritative" ) )
             massert( 10428 ,  "need_authoritative set but in authoritative mode already" , ! authoritative );
@@ -185,7 +185,7 @@ namespace mongo {
             return;
         }
         
-        log(1) << "     setShardVersion failed: " << result << endl;
+        log(1 , LogSharding) << "     setShardVersion failed: " << result << endl;
         massert( 10429 ,  "setShardVersion failed!" , 0 );
     }
     
@@ -200,7 +200,7 @@ namespace mongo {
             cmdBuilder.appendBool( "authoritative" , 1 );
         BSONObj cmd = cmdBuilder.obj();
         
-        log(1) << "    setShardVersion  " << conn.getServerAddress() << "  " << ns << "  " << cmd << " " << &conn << endl;
+        log(1 , LogSharding) << "    setShardVersion  " << conn.getServerAddress() << "  " << ns << "  " << cmd << " " << &conn << endl;
         
         return conn.runCommand( "admin" , cmd , result );
     }
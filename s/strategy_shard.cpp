@@ -16,7 +16,7 @@ namespace mongo {
         virtual void queryOp( Request& r ){
             QueryMessage q( r.d() );
 
-            log(3) << "shard query: " << q.ns << "  " << q.query << endl;
+            log(3 , LogSharding) << "shard query: " << q.ns << "  " << q.query << endl;
             
             if ( q.ntoreturn == 1 && strstr(q.ns, ".$cmd") )
                 throw UserException( 8010 , "something is wrong, shouldn't see a command here" );
@@ -74,14 +74,14 @@ namespace mongo {
 
             assert( cursor );
             
-            log(5) << "   cursor type: " << cursor->type() << endl;
+            log(5 , LogSharding) << "   cursor type: " << cursor->type() << endl;
 
             ShardedClientCursor * cc = new ShardedClientCursor( q , cursor );
             if ( ! cc->sendNextBatch( r ) ){
                 delete( cursor );
                 return;
             }
-            log(6) << "storing cursor : " << cc->getId() << endl;
+            log(6 , LogSharding) << "storing cursor : " << cc->getId() << endl;
             cursorCache.store( cc );
         }
         
@@ -89,17 +89,17 @@ namespace mongo {
             int ntoreturn = r.d().pullInt();
             long long id = r.d().pullInt64();
 
-            log(6) << "want cursor : " << id << endl;
+            log(6 , LogSharding) << "want cursor : " << id << endl;
 
             ShardedClientCursor * cursor = cursorCache.get( id );
             if ( ! cursor ){
-                log(6) << "\t invalid cursor :(" << endl;
+                log(6 , LogSharding) << "\t invalid cursor :(" << endl;
                 replyToQuery( QueryResult::ResultFlag_CursorNotFound , r.p() , r.m() , 0 , 0 , 0 );
                 return;
             }
             
             if ( cursor->sendNextBatch( r , ntoreturn ) ){
-                log(6) << "\t cursor finished: " << id << endl;
+                log(6 , LogSharding) << "\t cursor finished: " << id << endl;
                 return;
             }
             
@@ -131,7 +131,7 @@ namespace mongo {
                 }
                 
                 Chunk& c = manager->findChunk( o );
-                log(4) << "  server:" << c.getShard() << " " << o << endl;
+                log(4 , LogSharding) << "  server:" << c.getShard() << " " << o << endl;
                 insert( c.getShard() , r.getns() , o );
                 
                 c.splitIfShould( o.objsize() );
@@ -233,7 +233,7 @@ namespace mongo {
         
         virtual void writeOp( int op , Request& r ){
             const char *ns = r.getns();
-            log(3) << "write: " << ns << endl;
+            log(3 , LogSharding) << "write: " << ns << endl;
             
             DbMessage& d = r.d();
             ChunkManager * info = r.getChunkManager();
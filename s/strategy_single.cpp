@@ -21,7 +21,7 @@ namespace mongo {
             
             bool lateAssert = false;
         
-            log(3) << "single query: " << q.ns << "  " << q.query << "  ntoreturn: " << q.ntoreturn << endl;
+            log(3 , LogSharding) << "single query: " << q.ns << "  " << q.query << "  ntoreturn: " << q.ntoreturn << endl;
             
             try {
                 if ( ( q.ntoreturn == -1 || q.ntoreturn == 1 ) && strstr(q.ns, ".$cmd") ) {
@@ -55,7 +55,7 @@ namespace mongo {
         virtual void getMore( Request& r ){
             const char *ns = r.getns();
         
-            log(3) << "single getmore: " << ns << endl;
+            log(3 , LogSharding) << "single getmore: " << ns << endl;
 
             ScopedDbConnection dbcon( r.singleServerName() );
             DBClientBase& _c = dbcon.conn();
@@ -115,12 +115,12 @@ namespace mongo {
             if ( r.isShardingEnabled() && 
                  strstr( ns , ".system.indexes" ) == strstr( ns , "." ) && 
                  strstr( ns , "." ) ){
-                log(1) << " .system.indexes write for: " << ns << endl;
+                log(1 , LogSharding) << " .system.indexes write for: " << ns << endl;
                 handleIndexWrite( op , r );
                 return;
             }
             
-            log(3) << "single write: " << ns << endl;
+            log(3 , LogSharding) << "single write: " << ns << endl;
             doWrite( op , r , r.singleServerName() );
         }
 
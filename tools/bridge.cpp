@@ -19,6 +19,8 @@
 #include "stdafx.h"
 #include "../util/message.h"
 #include "../client/dbclient.h"
+#include "../db/dbmessage.h"
+#include "capture.h"
 
 using namespace mongo;
 using namespace std;
@@ -26,6 +28,53 @@ using namespace std;
 int port = 0;
 string destUri;
 
+/* --record: every request the clients send, with when it arrived and on which connection, is
+   appended to a capture file that mongoreplay can play back.
+*/
+class CaptureLog {
+public:
+    CaptureLog() : _f( 0 ), _start( 0 ), _lastConn( 0 ) {
+    }
+    bool open( const char *file ) {
+        _f = fopen( file, "wb" );
+        if ( !_f )
+            return false;
+        CaptureFileHeader h;
+        initCaptureFileHeader( h );
+        fwrite( &h, sizeof( h ), 1, _f );
+        _start = curTimeMicros64();
+        return true;
+    }
+    bool active() const {
+        return _f != 0;
+    }
+    int newConnection() {
+        boostlock lk( _m );
+        return ++_lastConn;
+    }
+    unsigned long long now() const {
+        return curTimeMicros64() - _start;
+    }
+    void write( int conn, unsigned long long micros, long long cursorId, const Message &m ) {
+        CaptureRecord r;
+        r.micros = micros;
+        r.conn = conn;
+        r.cursorId = cursorId;
+        boostlock lk( _m );
+        fwrite( &r, sizeof( r ), 1, _f );
+        fwrite( m.data, m.data->len, 1, _f );
+    }
+    void flush() {
+        if ( _f )
+            fflush( _f );
+    }
+private:
+    FILE *_f;
+    unsigned long long _start;
+    int _lastConn;
+    boost::mutex _m;
+} capture;
+
 class Forwarder {
 public:
     Forwarder( MessagingPort &mp ) : mp_( mp ) {
@@ -35,21 +84,32 @@ public:
         string errmsg;
         while( !dest.connect( destUri, errmsg ) )
             sleepmillis( 500 );
+        int conn = capture.active() ? capture.newConnection() : 0;
         Message m;
         while( 1 ) {
             m.reset();
             if ( !mp_.recv( m ) ) {
                 cout << "end connection " << mp_.farEnd.toString() << endl;
+                capture.flush();
                 mp_.shutdown();
                 break;
             }
 
             int oldId = m.data->id;
+            unsigned long long arrived = conn ? capture.now() : 0;
             if ( m.data->operation() == dbQuery || m.data->operation() == dbMsg || m.data->operation() == dbGetMore ) {
                 Message response;
                 dest.port().call( m, response );
+                if ( conn ) {
+                    long long cursorId = 0;
+                    if ( m.data->operation() != dbMsg && response.data && response.data->len >= (int) sizeof( QueryResult ) )
+                        cursorId = ( (QueryResult *) response.data )->cursorId;
+                    capture.write( conn, arrived, cursorId, m );
+                }
                 mp_.reply( m, response, oldId );
             } else {
+                if ( conn )
+                    capture.write( conn, arrived, 0, m );
                 dest.port().say( m, oldId );
             }
         }
@@ -74,6 +134,7 @@ auto_ptr< MyListener > listener;
 
 #if !defined(_WIN32) 
 void cleanup( int sig ) {
+    capture.flush();
     close( listener->socket() );
     for ( set<MessagingPort*>::iterator i = ports.begin(); i != ports.end(); i++ )
         (*i)->shutdown();
@@ -94,9 +155,10 @@ inline void setupSignals() {}
 #endif
 
 void helpExit() {
-    cout << "usage mongobridge --port <port> --dest <destUri>" << endl;
+    cout << "usage mongobridge --port <port> --dest <destUri> [--record <file>]" << endl;
     cout << "    port: port to listen for mongo messages" << endl;
     cout << "    destUri: uri of remote mongod instance" << endl;
+    cout << "    file: write every client request to this capture file, for mongoreplay" << endl;
     ::exit( -1 );
 }
 
@@ -108,14 +170,20 @@ void check( bool b ) {
 int main( int argc, char **argv ) {
     setupSignals();
 
-    check( argc == 5 );
+    check( argc == 5 || argc == 7 );
 
-    for( int i = 1; i < 5; ++i ) {
+    for( int i = 1; i < argc; ++i ) {
         check( i % 2 != 0 );
         if ( strcmp( argv[ i ], "--port" ) == 0 ) {
             port = strtol( argv[ ++i ], 0, 10 );
         } else if ( strcmp( argv[ i ], "--dest" ) == 0 ) {
             destUri = argv[ ++i ];
+        } else if ( strcmp( argv[ i ], "--record" ) == 0 ) {
+            const char *file = argv[ ++i ];
+            if ( !capture.open( file ) ) {
+                cout << "can't open capture file " << file << endl;
+                ::exit( -1 );
+            }
         } else {
             check( false );
         }
@@ -0,0 +1,54 @@
+// capture.h
+
+/**
+ *    Copyright (C) 2008 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* workload capture files.  mongobridge --record writes one, mongoreplay plays it back.
+
+   the file is a CaptureFileHeader followed by one CaptureRecord per client request, each
+   followed by the request exactly as it came off the wire (MsgData::len bytes).  requests of
+   one connection appear in the order they were sent; connections are interleaved.
+*/
+
+#pragma once
+
+namespace mongo {
+
+#pragma pack(1)
+    struct CaptureFileHeader {
+        char magic[8];            // "MONGOCAP"
+        int version;
+    };
+
+    struct CaptureRecord {
+        long long micros;         // when the request arrived, since the capture started
+        int conn;                 // connections are numbered in the order they were accepted
+        long long cursorId;       // query / getmore: cursor id of the server's reply, else 0
+    };
+#pragma pack()
+
+    const int CaptureFileVersion = 1;
+
+    inline void initCaptureFileHeader( CaptureFileHeader& h ) {
+        memcpy( h.magic, "MONGOCAP", 8 );
+        h.version = CaptureFileVersion;
+    }
+
+    inline bool validCaptureFileHeader( const CaptureFileHeader& h ) {
+        return memcmp( h.magic, "MONGOCAP", 8 ) == 0 && h.version == CaptureFileVersion;
+    }
+
+} // namespace mongo
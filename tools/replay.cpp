@@ -0,0 +1,298 @@
+// replay.cpp
+
+/**
+ *    Copyright (C) 2008 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* mongoreplay: plays back a capture written by mongobridge --record against a mongod or mongos.
+
+   every captured connection gets its own connection and thread, and its requests go out with
+   the spacing they had in the capture, divided by --speed (0 = don't wait at all).  at the end
+   we print throughput and a latency histogram summary per operation type.
+*/
+
+#include "stdafx.h"
+#include "../util/message.h"
+#include "../client/dbclient.h"
+#include "../db/dbmessage.h"
+#include "../util/histogram.h"
+#include "capture.h"
+
+using namespace mongo;
+using namespace std;
+
+string destUri;
+string captureFile;
+double speed = 1;
+
+struct Request {
+    unsigned long long micros;
+    long long cursorId;
+    MsgData *data;
+};
+
+typedef map< int, LatencyHistogram > OpStats; // by operation
+
+/* cursor ids in the capture are the ones the original server handed out.  we map them to the
+   ones the target gives us so getmores and killcursors still refer to live cursors.  cursors can
+   be passed between connections, so the map is shared.
+*/
+map< long long, long long > cursorMap;
+boost::mutex cursorMapMutex;
+
+void noteCursor( long long captured, long long replayed ) {
+    if ( captured == 0 )
+        return;
+    boostlock lk( cursorMapMutex );
+    if ( replayed )
+        cursorMap[ captured ] = replayed;
+    else
+        cursorMap.erase( captured );
+}
+
+void mapCursor( long long &id ) {
+    boostlock lk( cursorMapMutex );
+    map< long long, long long >::iterator i = cursorMap.find( id );
+    if ( i != cursorMap.end() )
+        id = i->second;
+}
+
+/* point the cursor ids in a getmore or killcursors at the target's cursors */
+void mapCursors( MsgData *d ) {
+    char *p = d->_data + 4; // reserved int
+    char *end = (char *) d + d->len;
+    if ( d->operation() == dbGetMore ) {
+        int nsLen = mongo::strnlen( p, end - p );
+        if ( nsLen < 0 )
+            return;
+        p += nsLen + 1 + 4; // ns, nToReturn
+        if ( p + 8 <= end )
+            mapCursor( *(long long *) p );
+    }
+    else if ( d->operation() == dbKillCursors && p + 4 <= end ) {
+        int n = *(int *) p;
+        p += 4;
+        for( int i = 0; i < n && p + 8 <= end; ++i, p += 8 )
+            mapCursor( *(long long *) p );
+    }
+}
+
+class Player {
+public:
+    Player( int conn, const vector< Request > &requests ) :
+        _start( 0 ), _maxLag( 0 ), _errors( 0 ), _conn( conn ), _requests( requests ) {
+    }
+    bool connect( string &errmsg ) {
+        return _dest.connect( destUri, errmsg );
+    }
+    void run() {
+        try {
+            for( vector< Request >::const_iterator i = _requests.begin(); i != _requests.end(); ++i ) {
+                wait( *i );
+                if ( !play( *i ) )
+                    break;
+            }
+        } catch ( std::exception &e ) {
+            cout << "connection " << _conn << ": " << e.what() << endl;
+            _errors++;
+        }
+    }
+    unsigned long long _start;
+    unsigned long long _maxLag;
+    int _errors;
+    OpStats _stats;
+private:
+    /* sleep until the request is due */
+    void wait( const Request &r ) {
+        if ( speed <= 0 )
+            return;
+        unsigned long long due = _start + (unsigned long long) ( r.micros / speed );
+        unsigned long long now = curTimeMicros64();
+        if ( now >= due ) {
+            if ( now - due > _maxLag )
+                _maxLag = now - due;
+            return;
+        }
+        while( due - now > 1000000 ) {
+            sleepmicros( 1000000 );
+            now = curTimeMicros64();
+        }
+        if ( due > now )
+            sleepmicros( (int) ( due - now ) );
+    }
+    bool play( const Request &r ) {
+        int op = r.data->operation();
+        mapCursors( r.data );
+        Message m( r.data, false );
+        unsigned long long t = curTimeMicros64();
+        if ( doesOpGetAResponse( op ) ) {
+            Message response;
+            if ( !_dest.port().call( m, response ) ) {
+                cout << "connection " << _conn << ": lost connection to " << destUri << endl;
+                _errors++;
+                return false;
+            }
+            _stats[ op ].record( curTimeMicros64() - t );
+            if ( op != dbMsg && response.data->len >= (int) sizeof( QueryResult ) )
+                noteCursor( r.cursorId, ( (QueryResult *) response.data )->cursorId );
+        }
+        else {
+            _dest.port().say( m );
+            _stats[ op ].record( curTimeMicros64() - t );
+        }
+        return true;
+    }
+
+    int _conn;
+    const vector< Request > &_requests;
+    DBClientConnection _dest;
+};
+
+struct PlayerThread {
+    PlayerThread( Player *p ) : p_( p ) {}
+    void operator()() const {
+        p_->run();
+    }
+    Player *p_;
+};
+
+typedef map< int, vector< Request > > Workload; // by captured connection
+
+bool load( Workload &w ) {
+    FILE *f = fopen( captureFile.c_str(), "rb" );
+    if ( !f ) {
+        cout << "can't open " << captureFile << endl;
+        return false;
+    }
+    CaptureFileHeader h;
+    if ( fread( &h, sizeof( h ), 1, f ) != 1 || !validCaptureFileHeader( h ) ) {
+        cout << captureFile << " is not a mongobridge capture file" << endl;
+        fclose( f );
+        return false;
+    }
+    CaptureRecord r;
+    while( fread( &r, sizeof( r ), 1, f ) == 1 ) {
+        int len;
+        if ( fread( &len, 4, 1, f ) != 1 || len < MsgDataHeaderSize || len > 64 * 1024 * 1024 ) {
+            cout << "truncated or corrupt capture record, stopping there" << endl;
+            break;
+        }
+        MsgData *d = (MsgData *) malloc( len );
+        d->len = len;
+        if ( fread( (char *) d + 4, len - 4, 1, f ) != 1 ) {
+            free( d );
+            cout << "truncated capture record, stopping there" << endl;
+            break;
+        }
+        Request q;
+        q.micros = r.micros;
+        q.cursorId = r.cursorId;
+        q.data = d;
+        w[ r.conn ].push_back( q );
+    }
+    fclose( f );
+    return true;
+}
+
+void report( const OpStats &stats, unsigned long long micros, int connections, unsigned long long maxLag, int errors ) {
+    LatencyHistogram all;
+    for( OpStats::const_iterator i = stats.begin(); i != stats.end(); ++i )
+        all.merge( i->second );
+    double secs = micros / 1000000.0;
+    cout << "replayed " << all.count() << " requests on " << connections << " connections in " << secs << "s, "
+         << ( secs > 0 ? all.count() / secs : 0 ) << " ops/sec" << endl;
+    if ( speed > 0 )
+        cout << "fell behind the captured schedule by up to " << maxLag / 1000 << "ms" << endl;
+    if ( errors )
+        cout << errors << " connections ended early" << endl;
+    cout << endl << "latencies in microseconds" << endl;
+    cout << setw( 12 ) << "op" << setw( 10 ) << "count" << setw( 10 ) << "avg" << setw( 10 ) << "p50"
+         << setw( 10 ) << "p95" << setw( 10 ) << "p99" << setw( 10 ) << "p99.9" << setw( 10 ) << "max" << endl;
+    for( OpStats::const_iterator i = stats.begin(); i != stats.end(); ++i ) {
+        const LatencyHistogram &h = i->second;
+        cout << setw( 12 ) << opToString( i->first ) << setw( 10 ) << h.count() << setw( 10 ) << h.mean()
+             << setw( 10 ) << h.percentile( 50 ) << setw( 10 ) << h.percentile( 95 ) << setw( 10 ) << h.percentile( 99 )
+             << setw( 10 ) << h.percentile( 99.9 ) << setw( 10 ) << h.maxValue() << endl;
+    }
+}
+
+void helpExit() {
+    cout << "usage mongoreplay --file <capture> --dest <destUri> [--speed <x>]" << endl;
+    cout << "    capture: file written by mongobridge --record" << endl;
+    cout << "    destUri: uri of the mongod or mongos to replay against" << endl;
+    cout << "    x: 1 keeps the captured timing (default), 2 runs twice as fast, 0 doesn't wait between requests" << endl;
+    ::exit( -1 );
+}
+
+void check( bool b ) {
+    if ( !b )
+        helpExit();
+}
+
+int main( int argc, char **argv ) {
+    check( argc == 5 || argc == 7 );
+
+    for( int i = 1; i < argc; ++i ) {
+        check( i % 2 != 0 );
+        if ( strcmp( argv[ i ], "--file" ) == 0 ) {
+            captureFile = argv[ ++i ];
+        } else if ( strcmp( argv[ i ], "--dest" ) == 0 ) {
+            destUri = argv[ ++i ];
+        } else if ( strcmp( argv[ i ], "--speed" ) == 0 ) {
+            speed = strtod( argv[ ++i ], 0 );
+            check( speed >= 0 );
+        } else {
+            check( false );
+        }
+    }
+    check( !captureFile.empty() && !destUri.empty() );
+
+    Workload w;
+    if ( !load( w ) )
+        return -1;
+
+    vector< Player* > players;
+    for( Workload::iterator i = w.begin(); i != w.end(); ++i ) {
+        Player *p = new Player( i->first, i->second );
+        string errmsg;
+        if ( !p->connect( errmsg ) ) {
+            cout << "couldn't connect to " << destUri << ": " << errmsg << endl;
+            return -1;
+        }
+        players.push_back( p );
+    }
+
+    unsigned long long start = curTimeMicros64();
+    vector< boost::thread* > threads;
+    for( unsigned i = 0; i < players.size(); ++i ) {
+        players[ i ]->_start = start;
+        threads.push_back( new boost::thread( PlayerThread( players[ i ] ) ) );
+    }
+
+    OpStats stats;
+    unsigned long long maxLag = 0;
+    int errors = 0;
+    for( unsigned i = 0; i < players.size(); ++i ) {
+        threads[ i ]->join();
+        for( OpStats::iterator j = players[ i ]->_stats.begin(); j != players[ i ]->_stats.end(); ++j )
+            stats[ j->first ].merge( j->second );
+        if ( players[ i ]->_maxLag > maxLag )
+            maxLag = players[ i ]->_maxLag;
+        errors += players[ i ]->_errors;
+    }
+
+    report( stats, curTimeMicros64() - start, players.size(), maxLag, errors );
+    return 0;
+}
@@ -0,0 +1,123 @@
+// arena.h
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "../stdafx.h"
+
+namespace mongo {
+
+    /* bump allocator for memory that lives no longer than one operation (see CurOp::arena()).
+       individual allocations are never freed; release() gives everything back in one step.
+       not thread safe -- an arena belongs to the thread running the operation.
+    */
+    class Arena : boost::noncopyable {
+        struct Chunk {
+            Chunk *prev;
+            int size;   // bytes of data following the header
+            int used;
+            char *data() { return (char *) (this + 1); }
+        };
+
+    public:
+        enum { ChunkSize = 64 * 1024 };
+
+        /* a point to rewind() to.  lets a long operation (e.g. a multi update) recycle the
+           memory it used for each document. */
+        struct Mark {
+            Chunk *chunk;
+            int used;
+        };
+
+        Arena() : _cur(0) { }
+        ~Arena() {
+            release();
+            if ( _cur )
+                free( _cur );
+        }
+
+        void* alloc(int bytes) {
+            bytes = ( bytes + 7 ) & ~7;
+            if ( _cur == 0 || _cur->used + bytes > _cur->size )
+                newChunk( bytes );
+            char *p = _cur->data() + _cur->used;
+            _cur->used += bytes;
+            return p;
+        }
+
+        /* like realloc(), but the old block is simply abandoned if it can't be extended in place */
+        void* grow(void *p, int oldBytes, int newBytes) {
+            if ( p == 0 )
+                return alloc( newBytes );
+            oldBytes = ( oldBytes + 7 ) & ~7;
+            int extra = ( ( newBytes + 7 ) & ~7 ) - oldBytes;
+            if ( (char *) p + oldBytes == _cur->data() + _cur->used && _cur->used + extra <= _cur->size ) {
+                // last allocation in the current chunk: extend it
+                _cur->used += extra;
+                return p;
+            }
+            void *q = alloc( newBytes );
+            memcpy( q, p, oldBytes < newBytes ? oldBytes : newBytes );
+            return q;
+        }
+
+        Mark mark() const {
+            Mark m;
+            m.chunk = _cur;
+            m.used = _cur ? _cur->used : 0;
+            return m;
+        }
+
+        /* free everything allocated since m was taken */
+        void rewind(const Mark& m) {
+            while ( _cur && _cur != m.chunk ) {
+                if ( _cur->prev == 0 && m.chunk == 0 ) {
+                    // keep our first chunk around for the next operation
+                    _cur->used = 0;
+                    return;
+                }
+                Chunk *prev = _cur->prev;
+                free( _cur );
+                _cur = prev;
+            }
+            if ( _cur )
+                _cur->used = m.used;
+        }
+
+        /* free everything.  the first chunk is kept for reuse so an arena that is released
+           after every operation does not go back to malloc for small requests. */
+        void release() {
+            Mark start;
+            start.chunk = 0;
+            start.used = 0;
+            rewind( start );
+        }
+
+    private:
+        void newChunk(int bytes) {
+            int size = bytes > ChunkSize ? bytes : ChunkSize;
+            Chunk *c = (Chunk *) malloc( sizeof(Chunk) + size );
+            c->prev = _cur;
+            c->size = size;
+            c->used = 0;
+            _cur = c;
+        }
+
+        Chunk *_cur;
+    };
+
+} // namespace mongo
@@ -32,8 +32,10 @@ namespace mongo {
         us->state = Running;
         grab = 0;
         us->run();
+        // once we say Done the owner may destroy us, so don't look at us after that
+        bool deleteSelf = us->deleteSelf;
         us->state = Done;
-        if ( us->deleteSelf )
+        if ( deleteSelf )
             delete us;
     }
 
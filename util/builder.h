@@ -19,6 +19,7 @@
 
 #include "../stdafx.h"
 #include <string.h>
+#include "arena.h"
 
 namespace mongo {
 
@@ -26,7 +27,7 @@ namespace mongo {
 
     class BufBuilder {
     public:
-        BufBuilder(int initsize = 512) : size(initsize) {
+        BufBuilder(int initsize = 512) : size(initsize), arena(0) {
             if ( size > 0 ) {
                 data = (char *) malloc(size);
                 assert(data);
@@ -35,20 +36,27 @@ namespace mongo {
             }
             l = 0;
         }
+        /* build in an Arena rather than on the heap.  the buffer is valid until the arena is
+           released, and can't be decouple()d. */
+        BufBuilder(Arena& a, int initsize = 512) : size(initsize), arena(&a) {
+            data = size > 0 ? (char *) arena->alloc(size) : 0;
+            l = 0;
+        }
         ~BufBuilder() {
             kill();
         }
 
         void kill() {
             if ( data ) {
-                free(data);
+                if ( !arena )
+                    free(data);
                 data = 0;
             }
         }
 
         void reset( int maxSize = 0 ){
             l = 0;
-            if ( maxSize && size > maxSize ){
+            if ( maxSize && size > maxSize && !arena ){
                 free(data);
                 data = (char*)malloc(maxSize);
                 size = maxSize;
@@ -68,9 +76,12 @@ namespace mongo {
 
         /* assume ownership of the buffer - you must then free it */
         void decouple() {
+            assert( !arena );
             data = 0;
         }
 
+        bool inArena() const { return arena != 0; }
+
         template<class T> void append(T j) {
             *((T*)grow(sizeof(T))) = j;
         }
@@ -122,7 +133,10 @@ namespace mongo {
                 if ( l > a )
                     a = l + 16 * 1024;
                 assert( a < 64 * 1024 * 1024 );
-                data = (char *) realloc(data, a);
+                if ( arena )
+                    data = (char *) arena->grow(data, size, a);
+                else
+                    data = (char *) realloc(data, a);
                 size= a;
             }
             return data + oldlen;
@@ -131,6 +145,7 @@ namespace mongo {
         char *data;
         int l;
         int size;
+        Arena *arena;
 
         friend class StringBuilder;
     };
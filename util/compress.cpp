@@ -0,0 +1,172 @@
+// compress.cpp
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "stdafx.h"
+#include "compress.h"
+
+namespace mongo {
+
+    namespace {
+        const int MinMatch = 4;
+        const int HashBits = 12;
+        const int MaxOffset = 0xffff;
+
+        inline unsigned read32( const char *p ) {
+            unsigned v;
+            memcpy( &v, p, 4 );
+            return v;
+        }
+
+        inline int hash4( unsigned v ) {
+            return ( v * 2654435761U ) >> ( 32 - HashBits );
+        }
+
+        inline char* putLength( char *op, int len ) {
+            len -= 15;
+            while ( len >= 255 ) {
+                *op++ = (char) 255;
+                len -= 255;
+            }
+            *op++ = (char) len;
+            return op;
+        }
+
+        /* the bytes a sequence needs, at most */
+        inline int sequenceBound( int litLen, int matchLen ) {
+            return 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1;
+        }
+
+        /* @return false if the length runs past the input or is absurd */
+        inline bool getLength( const unsigned char *&ip, const unsigned char *iend, int& len, int max ) {
+            unsigned b;
+            do {
+                if ( ip >= iend )
+                    return false;
+                b = *ip++;
+                len += b;
+                if ( len > max )
+                    return false;
+            } while ( b == 255 );
+            return true;
+        }
+    }
+
+    int lzCompress( const char *in, int len, char *out, int outCap ) {
+        int table[ 1 << HashBits ];
+        for ( int i = 0; i < ( 1 << HashBits ); i++ )
+            table[i] = -1;
+
+        const char *ip = in;
+        const char *anchor = in;
+        const char *end = in + len;
+        const char *matchLimit = len > 5 ? end - 5 : in; // the last bytes are always literals
+        char *op = out;
+        char *oend = out + outCap;
+
+        while ( ip < matchLimit ) {
+            unsigned seq = read32( ip );
+            int h = hash4( seq );
+            int ref = table[h];
+            table[h] = ip - in;
+            if ( ref < 0 || ( ip - in ) - ref > MaxOffset || read32( in + ref ) != seq ) {
+                ip++;
+                continue;
+            }
+
+            const char *match = in + ref;
+            const char *mp = ip + MinMatch;
+            const char *mr = match + MinMatch;
+            while ( mp < matchLimit && *mp == *mr ) {
+                mp++;
+                mr++;
+            }
+
+            int litLen = ip - anchor;
+            int matchLen = ( mp - ip ) - MinMatch;
+            if ( sequenceBound( litLen, matchLen ) > oend - op )
+                return 0;
+
+            char *token = op++;
+            *token = (char) ( ( litLen >= 15 ? 15 : litLen ) << 4 | ( matchLen >= 15 ? 15 : matchLen ) );
+            if ( litLen >= 15 )
+                op = putLength( op, litLen );
+            memcpy( op, anchor, litLen );
+            op += litLen;
+            int offset = ip - match;
+            *op++ = (char) ( offset & 0xff );
+            *op++ = (char) ( offset >> 8 );
+            if ( matchLen >= 15 )
+                op = putLength( op, matchLen );
+
+            ip = mp;
+            anchor = ip;
+        }
+
+        int litLen = end - anchor;
+        if ( sequenceBound( litLen, 0 ) > oend - op )
+            return 0;
+        *op++ = (char) ( ( litLen >= 15 ? 15 : litLen ) << 4 );
+        if ( litLen >= 15 )
+            op = putLength( op, litLen );
+        memcpy( op, anchor, litLen );
+        op += litLen;
+        return op - out;
+    }
+
+    bool lzDecompress( const char *in, int len, char *out, int outLen ) {
+        const unsigned char *ip = (const unsigned char *) in;
+        const unsigned char *iend = ip + len;
+        char *op = out;
+        char *oend = out + outLen;
+
+        while ( ip < iend ) {
+            unsigned token = *ip++;
+
+            int litLen = token >> 4;
+            if ( litLen == 15 && !getLength( ip, iend, litLen, outLen ) )
+                return false;
+            if ( litLen > iend - ip || litLen > oend - op )
+                return false;
+            memcpy( op, ip, litLen );
+            op += litLen;
+            ip += litLen;
+            if ( ip == iend )
+                break; // the last sequence has no match
+
+            if ( iend - ip < 2 )
+                return false;
+            int offset = ip[0] | ( ip[1] << 8 );
+            ip += 2;
+            if ( offset == 0 || offset > op - out )
+                return false;
+
+            int matchLen = token & 15;
+            if ( matchLen == 15 && !getLength( ip, iend, matchLen, outLen ) )
+                return false;
+            matchLen += MinMatch;
+            if ( matchLen > oend - op )
+                return false;
+            // may overlap itself, so byte at a time
+            const char *m = op - offset;
+            for ( int i = 0; i < matchLen; i++ )
+                op[i] = m[i];
+            op += matchLen;
+        }
+        return op == oend;
+    }
+
+}
@@ -0,0 +1,39 @@
+// compress.h
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+namespace mongo {
+
+    /* a fast LZ77 block compressor, used for the wire protocol's dbCompressed messages.
+
+       a block is a series of sequences.  each is a token byte -- literal count in the high
+       nibble, match length - 4 in the low one, 15 meaning more length bytes follow (each added,
+       until one is < 255) -- then the literals, then a 2 byte little endian offset back into the
+       output and any match length bytes.  the last sequence is literals only.
+    */
+
+    /* @return the compressed size, or 0 if it would not fit in outCap bytes */
+    int lzCompress( const char *in, int len, char *out, int outCap );
+
+    /* most a block of len bytes can take */
+    inline int lzCompressBound( int len ) { return len + len / 255 + 16; }
+
+    /* @return false if in is not a valid block that decompresses to exactly outLen bytes */
+    bool lzDecompress( const char *in, int len, char *out, int outLen );
+
+}
@@ -78,19 +78,22 @@ public:
         else 
             _bad = false;
     }
+    /* positional, so threads may read and write the same File at once */
     void write(fileofs o, const char *data, unsigned len) {
-        LARGE_INTEGER li;
-        li.QuadPart = o;
-        SetFilePointerEx(fd, li, NULL, FILE_BEGIN);
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD) o;
+        ov.OffsetHigh = (DWORD) (o >> 32);
         DWORD written;
-        err( WriteFile(fd, data, len, &written, NULL) );
+        err( WriteFile(fd, data, len, &written, &ov) );
     }
     void read(fileofs o, char *data, unsigned len) {
         DWORD read;
-        LARGE_INTEGER li;
-        li.QuadPart = o;
-        SetFilePointerEx(fd, li, NULL, FILE_BEGIN);
-        int ok = ReadFile(fd, data, len, &read, 0);
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD) o;
+        ov.OffsetHigh = (DWORD) (o >> 32);
+        int ok = ReadFile(fd, data, len, &read, &ov);
         if( !ok ) 
             err(ok);
         else
@@ -134,6 +137,8 @@ public:
 #ifndef O_NOATIME
 #define O_NOATIME 0
 #define lseek64 lseek
+#define pread64 pread
+#define pwrite64 pwrite
 #endif
 
     void open(const char *filename, bool readOnly=false ) {
@@ -144,13 +149,12 @@ public:
         }
         _bad = false;
     }
+    /* positional, so threads may read and write the same File at once */
     void write(fileofs o, const char *data, unsigned len) {
-        lseek64(fd, o, SEEK_SET);
-        err( ::write(fd, data, len) == (int) len );
+        err( ::pwrite64(fd, data, len, o) == (int) len );
     }
     void read(fileofs o, char *data, unsigned len) {
-        lseek(fd, o, SEEK_SET);
-        err( ::read(fd, data, len) == (int) len );
+        err( ::pread64(fd, data, len, o) == (int) len );
     }
     bool bad() { return _bad; }
     bool is_open() { return fd > 0; }
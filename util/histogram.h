@@ -0,0 +1,125 @@
+// histogram.h
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "../stdafx.h"
+
+namespace mongo {
+
+    /* latency histogram in the style of HdrHistogram.  values are bucketed by power of two, and
+       each power of two is split into linear sub-buckets, so a percentile is known to within
+       about 3% of its value over the whole range of an unsigned long long, in a fixed 15KB.
+       exact below SubBuckets.
+
+       not thread safe -- give each thread its own and merge() them afterwards.
+    */
+    class LatencyHistogram {
+    public:
+        enum { SubBits = 6, SubBuckets = 1 << SubBits, HalfSubBuckets = SubBuckets / 2,
+               NBuckets = SubBuckets + ( 64 - SubBits ) * HalfSubBuckets };
+
+        LatencyHistogram() {
+            reset();
+        }
+
+        void reset() {
+            memset( _counts, 0, sizeof( _counts ) );
+            _n = 0;
+            _total = 0;
+            _min = 0;
+            _max = 0;
+        }
+
+        void record( unsigned long long v ) {
+            _counts[ bucket( v ) ]++;
+            if ( _n == 0 || v < _min )
+                _min = v;
+            if ( v > _max )
+                _max = v;
+            _n++;
+            _total += v;
+        }
+
+        void merge( const LatencyHistogram& o ) {
+            if ( o._n == 0 )
+                return;
+            for ( int i = 0; i < NBuckets; i++ )
+                _counts[ i ] += o._counts[ i ];
+            if ( _n == 0 || o._min < _min )
+                _min = o._min;
+            if ( o._max > _max )
+                _max = o._max;
+            _n += o._n;
+            _total += o._total;
+        }
+
+        unsigned long long count() const { return _n; }
+        unsigned long long minValue() const { return _min; }
+        unsigned long long maxValue() const { return _max; }
+        unsigned long long mean() const { return _n ? _total / _n : 0; }
+
+        /* the value pct percent of the recorded values are at or below, e.g. percentile( 99.9 ).
+           reported as the top of its bucket, but never more than the largest value recorded.
+        */
+        unsigned long long percentile( double pct ) const {
+            if ( _n == 0 )
+                return 0;
+            double x = _n * pct / 100;
+            unsigned long long want = (unsigned long long) x;
+            if ( want < x || want < 1 )
+                want++;
+            unsigned long long seen = 0;
+            for ( int i = 0; i < NBuckets; i++ ) {
+                seen += _counts[ i ];
+                if ( seen >= want ) {
+                    unsigned long long v = highestEquivalent( i );
+                    return v < _max ? v : _max;
+                }
+            }
+            return _max;
+        }
+
+    private:
+        static int bucket( unsigned long long v ) {
+            if ( v < SubBuckets )
+                return (int) v;
+            int msb = SubBits;
+            while ( ( v >> msb ) > 1 )
+                msb++;
+            int shift = msb - SubBits + 1;
+            int sub = (int) ( v >> shift ); // in [HalfSubBuckets, SubBuckets)
+            return SubBuckets + ( shift - 1 ) * HalfSubBuckets + ( sub - HalfSubBuckets );
+        }
+
+        static unsigned long long highestEquivalent( int i ) {
+            if ( i < SubBuckets )
+                return i;
+            int k = i - SubBuckets;
+            int shift = k / HalfSubBuckets + 1;
+            unsigned long long low = (unsigned long long) ( k % HalfSubBuckets + HalfSubBuckets ) << shift;
+            return low + ( ( 1ULL << shift ) - 1 );
+        }
+
+        unsigned long long _counts[ NBuckets ];
+        unsigned long long _n;
+        unsigned long long _total;
+        unsigned long long _min;
+        unsigned long long _max;
+    };
+
+} // namespace mongo
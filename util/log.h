@@ -117,6 +117,25 @@ namespace mongo {
     
 #define LOGIT { ss << x; return *this; }
 
+    /* when async logging is on (see startAsyncLogging()), Logstream::flush() hands each
+       line to a queue drained by a background writer thread, so logging threads never wait on
+       the console or log file.  LogQueueFull says what a logging thread does if it finds the
+       queue full: wait for the writer to catch up, or drop the line (it is counted).
+    */
+    enum LogQueueFull { LogQueueBlock , LogQueueDrop };
+
+    void startAsyncLogging( unsigned queueSize , LogQueueFull policy );
+
+    /* @return false if async logging is off, in which case the caller writes line itself.
+       line is consumed (swapped out) when true is returned. */
+    bool asyncLogEnqueue( string& line );
+
+    /* wait (up to msMax) for the writer to drain everything queued so far.  call before exit. */
+    void flushAsyncLog( int msMax = 5000 );
+
+    class BSONObjBuilder;
+    void appendAsyncLogStats( BSONObjBuilder& b );
+
     class Logstream : public Nullstream {
         static boost::mutex &mutex;
         static int doneSetup;
@@ -125,12 +144,19 @@ namespace mongo {
         static int magicNumber(){
             return 1717;
         }
+        /* writes s to the log output, serialized with other writers */
+        static void write( const string& s , bool flushNow = true ) {
+            boostlock lk(mutex);
+            cout << s;
+            if ( flushNow )
+                cout.flush();
+        }
         void flush() {
             // this ensures things are sane
             if ( doneSetup == 1717 ){
-                boostlock lk(mutex);
-                cout << ss.str();
-                cout.flush();
+                string s = ss.str();
+                if ( ! asyncLogEnqueue( s ) )
+                    write( s );
             }
             ss.str("");
         }
@@ -193,6 +219,20 @@ namespace mongo {
 
     extern int logLevel;
 
+    /* verbosity can be raised for one area of the server without turning it up everywhere,
+       e.g. log( 2 , LogRepl ).  a component's level is logLevel unless set explicitly.
+    */
+    enum LogComponent { LogDefault = 0 , LogOps , LogQuery , LogRepl , LogIndex , LogStorage , LogSharding , NumLogComponents };
+    extern int componentLogLevels[ NumLogComponents ]; // -1 means use logLevel
+
+    inline int logLevelFor( LogComponent c ) {
+        int l = componentLogLevels[ c ];
+        return l < 0 ? logLevel : l;
+    }
+
+    /* spec is a list like "repl=2,query=1".  @return false (and sets errmsg) if malformed */
+    bool setComponentLogLevels( const string& spec , string& errmsg );
+
     inline Nullstream& out( int level = 0 ) {
         if ( level > logLevel )
             return nullstream;
@@ -219,6 +259,12 @@ namespace mongo {
         return Logstream::get().prolog();
     }
 
+    inline Nullstream& log( int level , LogComponent c ) {
+        if ( level > logLevelFor( c ) )
+            return nullstream;
+        return Logstream::get().prolog();
+    }
+
     /* TODOCONCURRENCY */
     inline ostream& stdcout() {
         return cout;
@@ -26,6 +26,8 @@
 #include <fcntl.h>
 #include <errno.h>
 #include "../db/cmdline.h"
+#include "../db/jsobj.h"
+#include "compress.h"
 
 namespace mongo {
 
@@ -163,7 +165,7 @@ namespace mongo {
         ports.closeAll();
     }
 
-    MessagingPort::MessagingPort(int _sock, SockAddr& _far) : sock(_sock), piggyBackData(0), farEnd(_far) {
+    MessagingPort::MessagingPort(int _sock, SockAddr& _far) : sock(_sock), piggyBackData(0), _compress(false), _announceCompression(false), farEnd(_far) {
         ports.insert(this);
     }
 
@@ -171,6 +173,100 @@ namespace mongo {
         ports.insert(this);
         sock = -1;
         piggyBackData = 0;
+        _compress = false;
+        _announceCompression = false;
+    }
+
+    /* --- dbCompressed --- 
+       the header is the original message's (id and responseTo included) with the operation
+       changed to dbCompressed.  then: int original operation, int original len, lzCompress()ed
+       original data.
+    */
+
+    int wireCompressionThreshold = 1024;
+
+    static struct WireCompressionStats {
+        boost::mutex m;
+        long long compressed, bytesIn, bytesOut, compressMicros;
+        long long decompressed, decompressMicros;
+        WireCompressionStats() : compressed(0), bytesIn(0), bytesOut(0), compressMicros(0), decompressed(0), decompressMicros(0) { }
+    } wireCompressionStats;
+
+    const int CompressedHeaderSize = MsgDataHeaderSize + 8;
+
+    /* @return false if it didn't get smaller (when !force) */
+    static bool compressMessage( Message& in, Message& out, bool force ) {
+        unsigned long long start = curTimeMicros64();
+        int dataLen = in.data->dataLen();
+        int cap = force ? lzCompressBound( dataLen ) : dataLen - 9;
+        if ( cap <= 0 )
+            return false;
+        MsgData *md = (MsgData *) malloc( CompressedHeaderSize + cap );
+        int n = lzCompress( in.data->_data, dataLen, md->_data + 8, cap );
+        if ( n == 0 ) {
+            free( md );
+            return false;
+        }
+        md->len = CompressedHeaderSize + n;
+        md->id = in.data->id;
+        md->responseTo = in.data->responseTo;
+        md->setOperation( dbCompressed );
+        ((int *) md->_data)[0] = in.data->operation();
+        ((int *) md->_data)[1] = in.data->len;
+        out.setData( md, true );
+
+        boostlock lk( wireCompressionStats.m );
+        wireCompressionStats.compressed++;
+        wireCompressionStats.bytesIn += in.data->len;
+        wireCompressionStats.bytesOut += md->len;
+        wireCompressionStats.compressMicros += curTimeMicros64() - start;
+        return true;
+    }
+
+    /* replace the dbCompressed m with the original message.  @return false if it is bad. */
+    static bool decompressMessage( Message& m ) {
+        unsigned long long start = curTimeMicros64();
+        MsgData *cd = m.data;
+        if ( cd->len < CompressedHeaderSize )
+            return false;
+        int op = ((int *) cd->_data)[0];
+        int len = ((int *) cd->_data)[1];
+        if ( len < MsgDataHeaderSize || len > 16000000 || op == dbCompressed )
+            return false;
+
+        bool pooled = len <= MsgPoolBufSize;
+        MsgData *md = pooled ? allocPooledMsgBuffer() : (MsgData *) malloc( len );
+        if ( !lzDecompress( cd->_data + 8, cd->len - CompressedHeaderSize, md->_data, len - MsgDataHeaderSize ) ) {
+            if ( pooled )
+                freePooledMsgBuffer( md );
+            else
+                free( md );
+            return false;
+        }
+        md->len = len;
+        md->id = cd->id;
+        md->responseTo = cd->responseTo;
+        md->setOperation( op );
+        m.reset();
+        m.setData( md, true, pooled );
+
+        boostlock lk( wireCompressionStats.m );
+        wireCompressionStats.decompressed++;
+        wireCompressionStats.decompressMicros += curTimeMicros64() - start;
+        return true;
+    }
+
+    void appendWireCompressionStats( BSONObjBuilder& b ) {
+        boostlock lk( wireCompressionStats.m );
+        WireCompressionStats& s = wireCompressionStats;
+        b.append( "threshold" , wireCompressionThreshold );
+        b.append( "compressed" , s.compressed );
+        b.append( "bytesIn" , s.bytesIn );
+        b.append( "bytesOut" , s.bytesOut );
+        b.append( "ratio" , s.bytesOut ? (double) s.bytesIn / s.bytesOut : 0.0 );
+        b.append( "compressMicros" , s.compressMicros );
+        b.append( "decompressed" , s.decompressed );
+        b.append( "decompressMicros" , s.decompressMicros );
     }
 
     void MessagingPort::shutdown() {
@@ -308,16 +404,20 @@ again:
             return false;
         }
 
-        int z = (len+1023)&0xfffffc00;
-        assert(z>=len);
-        MsgData *md = (MsgData *) malloc(z);
-        md->len = len;
-
         if ( len <= 0 ) {
             out() << "got a length of " << len << ", something is wrong" << endl;
             return false;
         }
 
+        int z = (len+1023)&0xfffffc00;
+        assert(z>=len);
+        bool pooled = z <= MsgPoolBufSize;
+        MsgData *md = pooled ? allocPooledMsgBuffer() : (MsgData *) malloc(z);
+        // so the buffer is given back if we bail out below
+        m.reset();
+        m.setData(md, true, pooled);
+        md->len = len;
+
         char *p = (char *) &md->id;
         int left = len -4;
         while ( 1 ) {
@@ -338,10 +438,65 @@ again:
                 break;
         }
 
-        m.setData(md, true);
+        if ( md->operation() == dbCompressed ) {
+            if ( !decompressMessage( m ) ) {
+                log() << "MessagingPort recv() bad compressed message " << farEnd.toString() << endl;
+                m.reset();
+                return false;
+            }
+            // the peer reads them too
+            _compress = true;
+        }
+
         return true;
     }
 
+    /* --- per thread pool of recv() buffers --- */
+
+    class MsgBufferPool {
+    public:
+        enum { MaxFree = 8 };
+        ~MsgBufferPool() {
+            for ( unsigned i = 0; i < _free.size(); i++ )
+                free( _free[i] );
+        }
+        MsgData* get() {
+            if ( _free.empty() )
+                return (MsgData *) malloc( MsgPoolBufSize );
+            MsgData *d = _free.back();
+            _free.pop_back();
+            return d;
+        }
+        void put( MsgData *d ) {
+            if ( _free.size() >= MaxFree )
+                free( d );
+            else
+                _free.push_back( d );
+        }
+    private:
+        vector<MsgData*> _free;
+    };
+
+    boost::thread_specific_ptr<MsgBufferPool> msgBufferPool;
+
+    MsgData* allocPooledMsgBuffer() {
+        MsgBufferPool *p = msgBufferPool.get();
+        if ( p == 0 ) {
+            p = new MsgBufferPool();
+            msgBufferPool.reset( p );
+        }
+        return p->get();
+    }
+
+    void freePooledMsgBuffer( MsgData *d ) {
+        MsgBufferPool *p = msgBufferPool.get();
+        if ( p == 0 ) {
+            p = new MsgBufferPool();
+            msgBufferPool.reset( p );
+        }
+        p->put( d );
+    }
+
     void MessagingPort::reply(Message& received, Message& response) {
         say(/*received.from, */response, received.data->id);
     }
@@ -376,9 +531,22 @@ again:
     }
 
     void MessagingPort::say(Message& toSend, int responseTo) {
-        mmm( out() << "*  say() sock:" << this->sock << " thr:" << GetCurrentThreadId() << endl; )
         toSend.data->id = nextMessageId();
         toSend.data->responseTo = responseTo;
+        send(toSend);
+    }
+
+    void MessagingPort::send(Message& toSend) {
+        mmm( out() << "*  say() sock:" << this->sock << " thr:" << GetCurrentThreadId() << endl; )
+        if ( _compress && toSend.data->operation() != dbCompressed &&
+             ( _announceCompression || toSend.data->len >= wireCompressionThreshold ) ) {
+            Message c;
+            if ( compressMessage( toSend, c, _announceCompression ) ) {
+                _announceCompression = false;
+                send( c );
+                return;
+            }
+        }
 
         int x = -100;
 
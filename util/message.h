@@ -70,13 +70,29 @@ namespace mongo {
         void reply(Message& received, Message& response);
         bool call(Message& toSend, Message& response);
         void say(Message& toSend, int responseTo = -1);
+        /* like say(), but toSend's id and responseTo are already set.  lets a caller be ready for
+           the reply before it could arrive. */
+        void send(Message& toSend);
 
         void piggyBack( Message& toSend , int responseTo = -1 );
 
+        /* from now on send messages of wireCompressionThreshold bytes or more as dbCompressed.
+           only once the peer is known to read them: the next message goes compressed whatever
+           its size, which tells the peer's port to do the same.  recv() of a dbCompressed message
+           also turns this on.
+        */
+        void startCompressing() {
+            _compress = true;
+            _announceCompression = true;
+        }
+        bool compressing() const { return _compress; }
+
         virtual unsigned remotePort();
     private:
         int sock;
         PiggyBackData * piggyBackData;
+        bool _compress;
+        bool _announceCompression;
     public:
         SockAddr farEnd;
 
@@ -95,7 +111,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* another message, compressed.  see MessagingPort::startCompressing() */
     };
 
     bool doesOpGetAResponse( int op );
@@ -110,6 +127,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default: 
             assert(0); 
             return "";
@@ -150,15 +168,23 @@ namespace mongo {
 
 #pragma pack()
 
+    /* recv() buffers up to this size come from a per thread pool and are handed back to it
+       when their Message is reset, rather than going through malloc/free on every request. */
+    const int MsgPoolBufSize = 16 * 1024;
+    MsgData* allocPooledMsgBuffer();
+    void freePooledMsgBuffer( MsgData *d );
+
     class Message {
     public:
         Message() {
             data = 0;
             freeIt = false;
+            pooled = false;
         }
         Message( void * _data , bool _freeIt ) {
             data = (MsgData*)_data;
             freeIt = _freeIt;
+            pooled = false;
         };
         ~Message() {
             reset();
@@ -174,19 +200,28 @@ namespace mongo {
             r.freeIt = false;
             r.data = 0;
             freeIt = true;
+            pooled = r.pooled;
+            r.pooled = false;
             return *this;
         }
 
         void reset() {
-            if ( freeIt && data )
-                free(data);
+            if ( freeIt && data ) {
+                if ( pooled )
+                    freePooledMsgBuffer(data);
+                else
+                    free(data);
+            }
             data = 0;
             freeIt = false;
+            pooled = false;
         }
 
-        void setData(MsgData *d, bool _freeIt) {
+        /* @param _pooled d came from allocPooledMsgBuffer() */
+        void setData(MsgData *d, bool _freeIt, bool _pooled = false) {
             assert( data == 0 );
             freeIt = _freeIt;
+            pooled = _pooled;
             data = d;
         }
         void setData(int operation, const char *msgtxt) {
@@ -200,6 +235,7 @@ namespace mongo {
             d->len = fixEndian(dataLen);
             d->setOperation(operation);
             freeIt= true;
+            pooled = false;
             data = d;
         }
 
@@ -209,6 +245,7 @@ namespace mongo {
 
     private:
         bool freeIt;
+        bool pooled;
     };
 
     class SocketException : public DBException {
@@ -217,6 +254,13 @@ namespace mongo {
         virtual int getCode(){ return 9001; }
     };
 
+    /* messages smaller than this are sent as is on a compressing port */
+    extern int wireCompressionThreshold;
+
+    class BSONObjBuilder;
+    /* compression ratio and time, for serverStatus */
+    void appendWireCompressionStats( BSONObjBuilder& b );
+
     MSGID nextMessageId();
 
     void setClientId( int id );
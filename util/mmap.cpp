@@ -17,6 +17,7 @@
 
 #include "stdafx.h"
 #include "mmap.h"
+#include "../db/jsobj.h"
 
 namespace mongo {
 
@@ -76,6 +77,41 @@ namespace mongo {
     }
 
 
+    void MemoryMappedFile::appendStats( BSONObjBuilder &b ) {
+        long long mapped = 0, resident = 0, faulted = 0;
+        BSONArrayBuilder files;
+
+        boostlock lk( mmmutex );
+        for ( set<MemoryMappedFile*>::iterator i = mmfiles.begin(); i != mmfiles.end(); i++ ){
+            MemoryMappedFile *mmf = *i;
+            if ( mmf->view == 0 )
+                continue;
+            long long r = mmf->residentBytes();
+            files.append( BSON( "file" << mmf->_filename <<
+                                "mapped" << (long long) mmf->len <<
+                                "resident" << r <<
+                                "faulted" << mmf->_faulted ) );
+            mapped += mmf->len;
+            if ( r > 0 )
+                resident += r;
+            faulted += mmf->_faulted;
+        }
+        b.append( "mapped" , mapped );
+        b.append( "resident" , resident );
+        b.append( "faulted" , faulted );
+        b.appendArray( "files" , files.arr() );
+    }
+
+    void MemoryMappedFile::advise( void *p, long length, Advice a ) {
+        if ( view == 0 || length <= 0 )
+            return;
+        char *start = (char *) p;
+        char *end = start + length;
+        massert( 13016 , "advise: range outside of the mapped view" ,
+                 start >= (char *) view && end <= (char *) view + len );
+        _advise( start, length, a );
+    }
+
     void MemoryMappedFile::updateLength( const char *filename, long &length ) {
         if ( !boost::filesystem::exists( filename ) )
             return;
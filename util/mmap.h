@@ -19,11 +19,23 @@
 
 namespace mongo {
 
+    class BSONObjBuilder;
+
     class MemoryMappedFile {
     public:
 
         enum Options {
-            SEQUENTIAL = 1
+            SEQUENTIAL = 1,
+            RANDOM = 2      // little or no readahead: pages are touched in index / record lookup order
+        };
+
+        /* readahead hints for part of the view, on top of the policy the file was mapped with.
+           Default goes back to that policy.  a no-op where we have no madvise.
+        */
+        enum Advice {
+            Default,
+            Sequential,
+            WillNeed        // start reading the range in now
         };
 
         MemoryMappedFile();
@@ -40,6 +52,16 @@ namespace mongo {
 
         void flush(bool sync);
 
+        /* p must be within the view.  the range is widened to whole pages. */
+        void advise( void *p, long length, Advice a );
+
+        /* bytes of the view in memory right now, -1 if we can't tell */
+        long long residentBytes();
+
+        const string& filename() const {
+            return _filename;
+        }
+
         void* viewOfs() {
             return view;
         }
@@ -54,13 +76,22 @@ namespace mongo {
         static void closeAllFiles( stringstream &message );
         static int flushAll( bool sync );
 
+        /* { files : [ { file, mapped, resident, faulted } ], ... } for serverStatus */
+        static void appendStats( BSONObjBuilder &b );
+
     private:
         void created();
+        void _advise( void *p, long length, Advice a );
         
         HANDLE fd;
         HANDLE maphandle;
         void *view;
         long len;
+        string _filename;
+        int _options;
+        /* bytes found not in memory when they were hinted Sequential or WillNeed, i.e. read
+           from disk on behalf of a scan */
+        long long _faulted;
     };
     
 
@@ -32,6 +32,8 @@ namespace mongo {
         maphandle = 0;
         view = 0;
         len = 0;
+        _options = 0;
+        _faulted = 0;
         created();
     }
 
@@ -53,6 +55,8 @@ namespace mongo {
         // length may be updated by callee.
         theFileAllocator().allocateAsap( filename, length );
         len = length;
+        _filename = filename;
+        _options = options;
 
         massert( 10446 ,  (string)"mmap() can't map area of size 0 [" + filename + "]" , length > 0 );
 
@@ -83,14 +87,79 @@ namespace mongo {
 #if defined(__sunos__)
 #warning madvise not supported on solaris yet
 #else
-        if ( options & SEQUENTIAL ){
-            if ( madvise( view , length , MADV_SEQUENTIAL ) ){
+        if ( options & ( SEQUENTIAL | RANDOM ) ){
+            if ( madvise( view , length , options & SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM ) ){
                 out() << " madvise failed for " << filename << " " << OUTPUT_ERRNO << endl;
             }
         }
 #endif
         return view;
     }
+
+#if defined(__linux__)
+    typedef unsigned char mincore_t;
+#else
+    typedef char mincore_t;
+#endif
+
+    static long pageSize() {
+        static long ps = sysconf( _SC_PAGESIZE );
+        return ps;
+    }
+
+    /* bytes of [p, p + length) in memory, p page aligned.  -1 if mincore fails */
+    static long long residentIn( char *p, long length ) {
+        const long ps = pageSize();
+        const long Window = 16 * 1024; // pages per mincore call
+        mincore_t v[ Window ];
+        long long n = 0;
+        while ( length > 0 ) {
+            long pages = ( length + ps - 1 ) / ps;
+            if ( pages > Window )
+                pages = Window;
+            long l = length < pages * ps ? length : pages * ps;
+            if ( mincore( p , l , v ) )
+                return -1;
+            for ( long i = 0; i < pages; i++ )
+                if ( v[ i ] & 1 )
+                    n += ps;
+            p += l;
+            length -= l;
+        }
+        return n;
+    }
+
+    long long MemoryMappedFile::residentBytes() {
+        if ( view == 0 )
+            return 0;
+        long long r = residentIn( (char *) view , len );
+        return r > len ? len : r; // the last page may be partial
+    }
+
+    void MemoryMappedFile::_advise( void *p, long length, Advice a ) {
+#if !defined(__sunos__)
+        /* view is page aligned so this stays within it */
+        char *start = (char *) p - ( (size_t) p % pageSize() );
+        length += (char *) p - start;
+
+        if ( a != Default ) {
+            long long r = residentIn( start , length );
+            if ( r >= 0 && r < length )
+                _faulted += length - r;
+        }
+
+        int advice = MADV_NORMAL;
+        if ( a == Sequential || ( a == Default && ( _options & SEQUENTIAL ) ) )
+            advice = MADV_SEQUENTIAL;
+        else if ( a == WillNeed )
+            advice = MADV_WILLNEED;
+        else if ( _options & RANDOM )
+            advice = MADV_RANDOM;
+        if ( madvise( start , length , advice ) ) {
+            OCCASIONALLY out() << " madvise failed for " << _filename << " " << OUTPUT_ERRNO << endl;
+        }
+#endif
+    }
     
     void MemoryMappedFile::flush(bool sync) {
         if ( view == 0 || fd == 0 )
@@ -26,6 +26,8 @@ namespace mongo {
         maphandle = 0;
         view = 0;
         len = 0;
+        _options = 0;
+        _faulted = 0;
         created();
     }
 
@@ -72,6 +74,8 @@ namespace mongo {
         DWORD createOptions = FILE_ATTRIBUTE_NORMAL;
         if ( options & SEQUENTIAL )
             createOptions |= FILE_FLAG_SEQUENTIAL_SCAN;
+        else if ( options & RANDOM )
+            createOptions |= FILE_FLAG_RANDOM_ACCESS;
 
         fd = CreateFile(
                  filenamew.c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ,
@@ -96,10 +100,20 @@ namespace mongo {
             out() << endl;
         }
         len = length;
+        _filename = filename;
+        _options = options;
         return view;
     }
 
     void MemoryMappedFile::flush(bool) {
     }
 
+    /* no madvise / mincore equivalent we can use here */
+    void MemoryMappedFile::_advise( void *p, long length, Advice a ) {
+    }
+
+    long long MemoryMappedFile::residentBytes() {
+        return -1;
+    }
+
 } 
@@ -20,6 +20,9 @@
 #include "unittest.h"
 #include "file_allocator.h"
 #include "optime.h"
+#include "background.h"
+#include "atomic_int.h"
+#include "../db/jsobj.h"
 
 namespace mongo {
 
@@ -34,8 +37,161 @@ namespace mongo {
     const char * (*getcurns)() = default_getcurns;
 
     int logLevel = 0;
+    int componentLogLevels[ NumLogComponents ] = { -1 , -1 , -1 , -1 , -1 , -1 , -1 };
     boost::mutex &Logstream::mutex = *( new boost::mutex );
     int Logstream::doneSetup = Logstream::magicNumber();
+
+    static const char * componentNames[ NumLogComponents ] = { "default" , "ops" , "query" , "repl" , "index" , "storage" , "sharding" };
+
+    bool setComponentLogLevels( const string& spec , string& errmsg ) {
+        string rest = spec;
+        while ( ! rest.empty() ) {
+            string item = rest;
+            size_t comma = rest.find( ',' );
+            if ( comma == string::npos )
+                rest = "";
+            else {
+                item = rest.substr( 0 , comma );
+                rest = rest.substr( comma + 1 );
+            }
+
+            size_t eq = item.find( '=' );
+            int level = eq == string::npos ? -1 : atoi( item.c_str() + eq + 1 );
+            if ( eq == string::npos || level < 0 ) {
+                errmsg = "bad log component setting: " + item;
+                return false;
+            }
+
+            string name = item.substr( 0 , eq );
+            int c = 0;
+            while ( c < NumLogComponents && name != componentNames[ c ] )
+                c++;
+            if ( c == NumLogComponents ) {
+                errmsg = "unknown log component: " + name;
+                return false;
+            }
+            componentLogLevels[ c ] = level;
+        }
+        return true;
+    }
+
+    /* --- async logging ---
+
+       a bounded multi producer / single consumer ring.  a producer claims a ticket with an
+       atomic increment; slot (ticket % size) is free for that ticket once its seq == ticket,
+       and holds a line ready for the writer once seq == ticket + 1.  the writer hands the slot
+       to the next lap by setting seq = ticket + size.  size is a power of two so tickets can
+       wrap.
+    */
+
+    inline void logMemoryBarrier() {
+#if defined(_WIN32)
+        MemoryBarrier();
+#else
+        __sync_synchronize();
+#endif
+    }
+
+    class AsyncLogWriter : public BackgroundJob {
+    public:
+        AsyncLogWriter( unsigned size , LogQueueFull policy ) : _size( size ) , _policy( policy ) , _tail( 0 ) {
+            _cells = new Cell[ _size ];
+            for ( unsigned i = 0; i < _size; i++ )
+                _cells[ i ].seq = i;
+        }
+
+        void enqueue( string& line ) {
+            if ( _policy == LogQueueDrop && (unsigned) _head - _tail >= _size ) {
+                // approximate: a few lines may still wait below when several threads race here
+                _dropped++;
+                return;
+            }
+            unsigned t = _head++;
+            Cell& c = _cells[ t & ( _size - 1 ) ];
+            while ( c.seq != t )
+                sleepmicros( 100 ); // full: wait for the writer
+            c.line.swap( line );
+            logMemoryBarrier();
+            c.seq = t + 1;
+        }
+
+        /* wait until all lines queued before the call have been written */
+        void drain( int msMax ) {
+            unsigned target = _head;
+            Timer t;
+            while ( (int) ( target - _tail ) > 0 && t.millis() < msMax )
+                sleepmillis( 1 );
+        }
+
+        void append( BSONObjBuilder& b ) {
+            b.append( "queueSize" , (int) _size );
+            b.append( "queued" , (int) ( (unsigned) _head - _tail ) );
+            b.appendIntOrLL( "dropped" , (unsigned) _dropped );
+        }
+
+    protected:
+        void run() {
+            string line;
+            while ( 1 ) {
+                Cell& c = _cells[ _tail & ( _size - 1 ) ];
+                if ( c.seq != _tail + 1 ) {
+                    sleepmillis( 2 );
+                    continue;
+                }
+                logMemoryBarrier();
+                line.swap( c.line );
+                c.line.clear();
+                logMemoryBarrier();
+                c.seq = _tail + _size;
+                _tail++;
+
+                // flush once we have caught up, rather than after every line
+                Cell& next = _cells[ _tail & ( _size - 1 ) ];
+                Logstream::write( line , next.seq != _tail + 1 );
+            }
+        }
+
+    private:
+        struct Cell {
+            volatile unsigned seq;
+            string line;
+        };
+        Cell *_cells;
+        const unsigned _size;
+        const LogQueueFull _policy;
+        AtomicUInt _head;
+        volatile unsigned _tail;
+        AtomicUInt _dropped;
+    };
+
+    static AsyncLogWriter *asyncLogWriter = 0;
+
+    void startAsyncLogging( unsigned queueSize , LogQueueFull policy ) {
+        assert( asyncLogWriter == 0 );
+        unsigned size = 64;
+        while ( size < queueSize )
+            size *= 2;
+        AsyncLogWriter *w = new AsyncLogWriter( size , policy );
+        w->go();
+        asyncLogWriter = w;
+    }
+
+    bool asyncLogEnqueue( string& line ) {
+        if ( asyncLogWriter == 0 )
+            return false;
+        asyncLogWriter->enqueue( line );
+        return true;
+    }
+
+    void flushAsyncLog( int msMax ) {
+        if ( asyncLogWriter )
+            asyncLogWriter->drain( msMax );
+    }
+
+    void appendAsyncLogStats( BSONObjBuilder& b ) {
+        if ( asyncLogWriter )
+            asyncLogWriter->append( b );
+    }
     
     bool goingAway = false;
 